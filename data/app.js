@@ -706,27 +706,34 @@ class LittleGallery {
 
   async performDeleteSelectedImages() {
     const images = Array.from(this.selectedImages);
-    let successCount = 0;
 
     this.showLoading(true);
 
-    for (const image of images) {
-      try {
-        await this.performDeleteImage(image);
-        successCount++;
-      } catch (error) {
-        console.error(`删除 ${image} 失败:`, error);
+    // 一次请求删除全部选中图片，设备端只更新一次图片列表
+    try {
+      const response = await fetch("/api/batch", {
+        method: "POST",
+        headers: { "Content-Type": "application/json" },
+        body: JSON.stringify({
+          ops: images.map((name) => ({ op: "delete", name, all: true })),
+        }),
+      });
+      const data = await response.json();
+
+      if (data.status === "ok") {
+        this.showStatus(`成功删除 ${images.length} 张图片`, "success");
+      } else {
+        const failed = data.op !== undefined ? ` (${images[data.op]})` : "";
+        this.showStatus(`删除失败: ${data.message || "未知错误"}${failed}`, "error");
       }
+    } catch (error) {
+      console.error("批量删除失败:", error);
+      this.showStatus("删除图片失败", "error");
     }
 
     this.selectedImages.clear();
     this.showLoading(false);
     this.refreshImageList();
-
-    this.showStatus(
-      `成功删除 ${successCount}/${images.length} 张图片`,
-      "success"
-    );
   }
 
   updateSelectedImages() {
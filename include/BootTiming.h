@@ -0,0 +1,26 @@
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+namespace Boot
+{
+  // ==================== 启动阶段计时 ====================
+  // setup() 按阶段打点，记录从上电（micros() 起点）到各阶段完成的时间。
+  // 本地显示链路（设置 → 屏幕 → 文件系统 → 首张图片）在前，WiFi、mDNS
+  // 在后台完成后补记，串口输出汇总，/api/status 的 boot 字段返回同样的数据。
+
+  static const uint8_t BOOT_MAX_PHASES = 12;
+
+  // 记录一个阶段完成；阶段名须为字符串常量
+  void mark(const char* phase);
+
+  // 距上电的毫秒数，未记录时返回-1
+  int32_t phaseMillis(const char* phase);
+
+  void printSummary();
+  void addToJson(JsonObject obj);
+}
+
+#endif // BOOT_TIMING_H
@@ -0,0 +1,63 @@
+#ifndef COLOR_CONVERT_H
+#define COLOR_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==================== 颜色转换内核选择 ====================
+// 本模块不依赖Arduino，主机端工具和测试可以直接编译 ColorConvert.cpp。
+// 按目标指令集在编译期选择实现：x86 为 AVX2 或 SSE2（有SSSE3时24位像素用字节重排），ARM 为 NEON，
+// 其余（包括ESP32-C3，RV32IMC没有SIMD扩展）使用32位SWAR。
+// 在主机上定义 COLOR_CONVERT_FORCE_SWAR 可强制使用SWAR实现，用于对比和验证。
+
+#if defined(COLOR_CONVERT_FORCE_SWAR)
+#define COLOR_CONVERT_SWAR 1
+#elif defined(__AVX2__)
+#define COLOR_CONVERT_AVX2 1
+#elif defined(__SSE2__)
+#define COLOR_CONVERT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define COLOR_CONVERT_NEON 1
+#else
+#define COLOR_CONVERT_SWAR 1
+#endif
+
+namespace Color
+{
+  // 单个像素：取8位分量的高5/6/5位
+  inline uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b)
+  {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+  }
+
+  inline uint16_t swap16(uint16_t value)
+  {
+    return (uint16_t)((value >> 8) | (value << 8));
+  }
+
+  // ==================== 批量转换 ====================
+  // 输出为CPU字节序（小端）的RGB565。src/dst 没有对齐要求，内部先逐像素处理到
+  // 字边界再按字转换；除 swapBytes565 外 src 和 dst 不能重叠。
+
+  // 24位BGR（BMP行数据的存储顺序）→ RGB565
+  void bgr888ToRgb565(const uint8_t* src, uint16_t* dst, size_t count);
+
+  // 32位像素（0xAARRGGBB，内存中依次为 B,G,R,A）→ RGB565，忽略Alpha
+  void xrgb8888ToRgb565(const uint32_t* src, uint16_t* dst, size_t count);
+
+  // RGB565 字节序交换（CPU小端 ↔ 面板SPI的大端），允许 src == dst 原地交换
+  void swapBytes565(const uint16_t* src, uint16_t* dst, size_t count);
+
+  // 编译期选中的实现："avx2"、"ssse3"（SSE2加SSSE3字节重排）、"sse2"、"neon" 或 "swar32"
+  const char* kernelName();
+
+  // 逐像素参考实现，供基准测试对比和结果校验
+  namespace Scalar
+  {
+    void bgr888ToRgb565(const uint8_t* src, uint16_t* dst, size_t count);
+    void xrgb8888ToRgb565(const uint32_t* src, uint16_t* dst, size_t count);
+    void swapBytes565(const uint16_t* src, uint16_t* dst, size_t count);
+  }
+}
+
+#endif // COLOR_CONVERT_H
@@ -0,0 +1,110 @@
+#ifndef CONTENT_INDEX_H
+#define CONTENT_INDEX_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "StaticString.h"
+#include "secrets.h"
+
+// ==================== 内容去重配置 ====================
+
+// 别名上限：每个别名是一次重复上传，只占一条记录
+#ifndef DEDUP_MAX_ALIASES
+#define DEDUP_MAX_ALIASES 32
+#endif
+
+// 索引文件（以'.'开头，不出现在图片列表中）
+#define CONTENT_INDEX_PATH "/.content_index"
+
+namespace Dedup
+{
+  // 已存储的图片：上传内容的大小和CRC32
+  // （入库转码替换原图后仍保留上传时的内容哈希；原始字节已不在，不再作为查重的目标）
+  struct FileRecord
+  {
+    ImageName name;
+    uint32_t size;
+    uint32_t crc;
+  };
+
+  // 重复上传产生的别名，只记录指向的文件，不占用数据空间
+  struct AliasRecord
+  {
+    ImageName alias;
+    ImageName target;
+  };
+
+  enum class ReleaseResult : uint8_t {
+    NOT_FOUND,     // 既不是已知文件也不是别名
+    ALIAS_REMOVED, // 删除了一个引用，文件仍被其他名称引用
+    DELETE_FILE    // 最后一个引用，调用方应删除文件
+  };
+
+  // ==================== 内容索引 ====================
+  // 上传时流式计算CRC32；入库任务随后查重，大小和CRC都相同的候选再逐字节比较确认，
+  // 重复的上传删除数据，只保留一个别名；删除时按引用计数处理。
+  // 旧固件上传的文件没有记录，查重时只对大小相同的文件补算哈希。
+  // 索引保存在 CONTENT_INDEX_PATH，每次修改后先写临时文件再重命名。
+  // Web任务和入库转码任务都会调用，内部用互斥锁保护。
+
+  class ContentIndex
+  {
+  public:
+    void begin();
+
+    // 查找与 path（大小 size、CRC32 crc）内容相同的已存储文件，
+    // 找到时把文件名写入 target 并返回true（会读取整个文件，只在入库任务中调用）
+    bool findDuplicate(const char* path, uint32_t size, uint32_t crc, ImageName& target);
+
+    void addFile(const char* name, uint32_t size, uint32_t crc);
+    bool addAlias(const char* alias, const char* target);
+
+    // 已保存的文件 name 查重确认后改为指向 target 的别名，调用方随后删除文件数据
+    bool convertToAlias(const char* name, const char* target);
+
+    // 入库转码把文件改名后调用，内容哈希保持不变
+    void renameFile(const char* from, const char* to);
+
+    // 查询已存储文件的内容哈希（别名和未记录的文件返回false）
+    bool lookup(const char* name, uint32_t& size, uint32_t& crc);
+
+    // 是否还有文件的内容为 size/crc（入库转码据此清理无主的显示缓存）
+    bool hasContent(uint32_t size, uint32_t crc);
+
+    // 删除一个名称：别名直接移除；文件仍有别名时移除一个别名并保留文件
+    ReleaseResult release(const char* name);
+
+    // 删除文件及其全部别名的记录
+    void removeAll(const char* name);
+
+    // 引用计数 = 文件本身 + 指向它的别名数（未知文件返回0）
+    uint8_t refCount(const char* name);
+
+    uint16_t aliasCount();
+    uint32_t savedBytes();
+
+  private:
+    FileRecord files[MAX_IMAGES];
+    uint8_t fileCount = 0;
+    AliasRecord aliases[DEDUP_MAX_ALIASES];
+    uint8_t aliasTotal = 0;
+    SemaphoreHandle_t mutex = nullptr;
+
+    void lock();
+    void unlock();
+    bool load();
+    bool save();
+    int findFile(const char* name) const;
+    int findAlias(const char* alias) const;
+    void removeFileRecord(int index);
+    void removeAliasRecord(int index);
+    void indexUnknownFiles(uint32_t size);
+  };
+
+  extern ContentIndex contentIndex;
+
+  // 计算文件内容的CRC32（与 /api/image 的强ETag一致，会读取整个文件）
+  uint32_t computeFileCrc(File& file);
+}
+
+#endif // CONTENT_INDEX_H
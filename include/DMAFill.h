@@ -0,0 +1,91 @@
+#ifndef DMA_FILL_H
+#define DMA_FILL_H
+
+#include <Arduino.h>
+#include <driver/spi_master.h>
+
+// ==================== DMA填充配置 ====================
+
+// 是否启用DMA纯色填充（失败时自动回退到CPU路径）
+#ifndef TFT_DMA_FILL
+#define TFT_DMA_FILL true
+#endif
+
+// 常量缓冲区大小（像素），每个DMA事务重复发送这块缓冲区
+#ifndef DMA_FILL_PATTERN_PIXELS
+#define DMA_FILL_PATTERN_PIXELS 2048
+#endif
+
+// 同时排队的DMA事务数
+#ifndef DMA_FILL_QUEUE_DEPTH
+#define DMA_FILL_QUEUE_DEPTH 4
+#endif
+
+// 小于该像素数的填充走CPU路径（DMA建立事务的开销更大）
+#ifndef DMA_FILL_MIN_PIXELS
+#define DMA_FILL_MIN_PIXELS 1024
+#endif
+
+namespace Display
+{
+  // ==================== DMA纯色填充 ====================
+  // GPSPI2 由Arduino SPI HAL持有：Adafruit驱动负责CS/DC、地址窗口和其余所有写入。
+  // spi_master 只在 fill 内部借用总线，调用者必须已经 startWrite（持有Arduino的SPI锁）。
+  // 两个驱动各自的寄存器状态整组保存：fill 先取得spi_master的总线锁，换入spi_master
+  // 的设备上下文，DMA完成后存下它并整组换回Arduino的寄存器，逐个读回校验；
+  // 校验不一致时停用DMA填充，之后全部走CPU路径。
+
+  class SolidFillDMA
+  {
+  public:
+    SolidFillDMA();
+    ~SolidFillDMA();
+
+    bool begin(uint32_t frequency);
+    void end();
+    bool isAvailable() const { return device != nullptr; }
+
+    // SPI时钟变化时需要重新挂载设备
+    bool setFrequency(uint32_t frequency);
+
+    // 在调用者已设置好的地址窗口内填充 pixelCount 个像素，返回实际发出的像素数
+    // （不可用或提交失败时少于 pixelCount，剩余部分由调用者接着写）。
+    // 阻塞直到DMA完成，等待期间CPU让给其他FreeRTOS任务。
+    uint32_t fill(uint16_t color, uint32_t pixelCount);
+
+    // spi_master 会改写的全部GPSPI2配置寄存器
+    struct BusRegisters
+    {
+      uint32_t addr;
+      uint32_t ctrl;
+      uint32_t clock;
+      uint32_t user;
+      uint32_t user1;
+      uint32_t user2;
+      uint32_t msDlen;
+      uint32_t misc;
+      uint32_t dinMode;
+      uint32_t dinNum;
+      uint32_t doutMode;
+      uint32_t dmaConf;
+      uint32_t dmaIntEna;
+      uint32_t slave;
+      uint32_t slave1;
+      uint32_t clkGate;
+    };
+
+  private:
+    spi_device_handle_t device;
+    uint16_t *pattern;      // DMA可访问的常量缓冲区（已按大端序存放）
+    uint16_t patternColor;
+    bool patternValid;
+    BusRegisters deviceRegs;  // spi_master 上次用完总线时的寄存器
+    spi_transaction_t transactions[DMA_FILL_QUEUE_DEPTH];
+
+    bool addDevice(uint32_t frequency);
+    bool captureDeviceContext(const BusRegisters &arduinoRegs);
+    bool restoreArduinoBus(const BusRegisters &arduinoRegs);
+  };
+}
+
+#endif // DMA_FILL_H
@@ -0,0 +1,80 @@
+#ifndef DECODE_ARENA_H
+#define DECODE_ARENA_H
+
+#include <Arduino.h>
+#include "secrets.h"
+
+// ==================== 解码内存池配置 ====================
+
+// 解码工作内存大小：需容纳最宽BMP的一行原始数据 + 一行RGB565输出
+// （16KB 约可支持宽度 4000 像素的24位BMP）
+#ifndef DECODE_ARENA_SIZE
+#define DECODE_ARENA_SIZE (16 * 1024)
+#endif
+
+namespace Memory
+{
+  // ==================== 解码内存池 ====================
+  // 启动时一次性保留的静态内存（位于.bss，不占用堆），渲染路径上的
+  // 解码器和行缓冲区从这里按作用域分配，结束时整体归还，
+  // 长时间运行也不会让堆产生碎片。
+  // 只在渲染（loop）任务中使用，不支持跨任务并发分配。
+
+  class DecodeArena
+  {
+  public:
+    DecodeArena();
+
+    // 分配失败返回nullptr（不会回退到堆）
+    void* allocate(size_t size, size_t alignment = 4);
+
+    // 作用域标记：release(mark) 释放 mark 之后的所有分配
+    size_t mark() const { return offset; }
+    void release(size_t mark);
+
+    size_t capacity() const { return DECODE_ARENA_SIZE; }
+    size_t used() const { return offset; }
+    size_t highWater() const { return peak; }
+    uint32_t failedAllocations() const { return failures; }
+
+  private:
+    alignas(8) uint8_t buffer[DECODE_ARENA_SIZE];
+    size_t offset;
+    size_t peak;
+    uint32_t failures;
+  };
+
+  // 作用域分配器：析构时自动归还本作用域内的所有分配
+  class ArenaScope
+  {
+  public:
+    explicit ArenaScope(DecodeArena& arena) : arena(arena), start(arena.mark()) {}
+    ~ArenaScope() { arena.release(start); }
+
+    void* allocate(size_t size, size_t alignment = 4) { return arena.allocate(size, alignment); }
+
+  private:
+    DecodeArena& arena;
+    size_t start;
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+  };
+
+  // 全局解码内存池实例
+  extern DecodeArena decodeArena;
+
+  // ==================== 堆状态监控 ====================
+
+  struct HeapStats
+  {
+    uint32_t freeHeap;          // 当前空闲堆
+    uint32_t minFreeHeap;       // 启动以来的最低空闲堆
+    uint32_t largestFreeBlock;  // 最大可分配连续块
+    uint8_t fragmentation;      // 碎片率(%) = 1 - 最大块/空闲总量
+  };
+
+  HeapStats getHeapStats();
+}
+
+#endif // DECODE_ARENA_H
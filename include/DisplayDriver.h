@@ -4,6 +4,7 @@
 #include <Adafruit_GFX.h>
 #include <SPI.h>
 #include "secrets.h"
+#include "SPIConfig.h"
 
 // 显示驱动类型枚举
 enum DisplayDriverType {
@@ -13,6 +14,27 @@ enum DisplayDriverType {
 
 namespace Display
 {
+  // 纯色填充基准测试结果（全屏填充，单位微秒）
+  struct FillBenchmarkResult
+  {
+    uint32_t pixels;
+    uint8_t iterations;
+    uint32_t cpuMicros;  // Adafruit writeColor 路径
+    uint32_t dmaMicros;  // DMA常量缓冲区路径（不可用时为0）
+  };
+
+  // 像素传输统计（基准测试用，跨提交对比传输量和输出是否一致）
+  struct TransferStats
+  {
+    uint32_t bytes;          // 写入显示屏的像素字节数（裁剪后）
+    uint32_t transactions;   // SPI事务次数（startWrite/endWrite 对）
+    uint32_t windows;        // 地址窗口设置次数
+    uint32_t checksum;       // 输出像素的FNV-1a校验和（仅 detailed 模式）
+    uint32_t transferMicros; // 阻塞在SPI写入上的时间（仅 detailed 模式）
+    uint32_t minFreeHeap;    // 传输期间采样到的最低空闲堆（仅 detailed 模式）
+    bool detailed;
+  };
+
   // ==================== 抽象显示驱动基类 ====================
   class DisplayDriverBase
   {
@@ -32,6 +54,21 @@ namespace Display
     virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) = 0;
     virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) = 0;
     
+    // 整帧批量写入：beginFrame/endFrame 之间保持CS和SPI事务，
+    // 期间只能调用 pushImage，其他绘制函数会重复开启事务
+    virtual void beginFrame() = 0;
+    virtual void endFrame() = 0;
+    virtual void pushImage(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* pixels) = 0;
+    
+    // SPI总线配置
+    virtual const SPIBusConfig& getSPIConfig() const = 0;
+    virtual void setSPIFrequency(uint32_t frequency) = 0;
+    virtual uint32_t getSPIFrequency() const = 0;
+    virtual uint32_t calibrateSPI(bool force = false) = 0;
+    
+    // 纯色填充性能对比
+    virtual bool benchmarkFill(uint8_t iterations, FillBenchmarkResult& result) = 0;
+    
     // 文本显示功能
     virtual void displayText(const char* text, int16_t x = 10, int16_t y = 10,
                            uint16_t color = 0xFFFF, uint8_t size = 1) = 0;
@@ -63,6 +100,25 @@ namespace Display
     // 获取驱动类型
     virtual DisplayDriverType getDriverType() const = 0;
     virtual const char* getDriverName() const = 0;
+    
+    // 传输统计：detailed 为true时额外计算输出校验和并采样堆，开销较大
+    const TransferStats& getTransferStats() const { return transferStats; }
+    void resetTransferStats(bool detailed = false);
+    
+  protected:
+    TransferStats transferStats = {};
+    
+    // 由驱动在每次窗口写入/纯色填充时调用
+    void recordWindow(bool newTransaction, uint32_t pixelCount);
+    void recordPixels(const uint16_t* pixels, uint32_t count);
+    void recordFill(uint16_t color, uint32_t count);
+    
+    // 包围实际的SPI写入，统计传输耗时
+    uint32_t transferBegin() const { return transferStats.detailed ? micros() : 0; }
+    void transferEnd(uint32_t start)
+    {
+      if (transferStats.detailed) transferStats.transferMicros += micros() - start;
+    }
   };
 
   // ==================== 显示管理器 ====================
@@ -76,6 +132,11 @@ namespace Display
     bool setDriver(DisplayDriverType driverType);
     DisplayDriverType getCurrentDriver() const { return currentDriverType; }
     const char* getCurrentDriverName() const;
+    DisplayDriverBase* getDriver() const { return currentDriver; }
+    
+    // 编译期专用像素写入路径（见 DisplayPipeline.h），基准测试对比时可临时关闭
+    void setStaticPipelineEnabled(bool enabled) { staticPipelineEnabled = enabled; }
+    bool isStaticPipelineEnabled() const { return staticPipelineEnabled; }
     
     // 初始化
     bool begin();
@@ -92,6 +153,18 @@ namespace Display
     void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
     void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
     
+    void beginFrame();
+    void endFrame();
+    void pushImage(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* pixels);
+    
+    void setSPIFrequency(uint32_t frequency);
+    uint32_t getSPIFrequency() const;
+    uint32_t calibrateSPI(bool force = false);
+    bool benchmarkFill(uint8_t iterations, FillBenchmarkResult& result);
+    
+    void resetTransferStats(bool detailed = false);
+    TransferStats getTransferStats() const;
+    
     void displayText(const char* text, int16_t x = 10, int16_t y = 10,
                     uint16_t color = 0xFFFF, uint8_t size = 1);
     void displayCenteredText(const char* text, int16_t y,
@@ -118,6 +191,7 @@ namespace Display
     DisplayDriverBase* currentDriver;
     DisplayDriverType currentDriverType;
     bool initialized;
+    bool staticPipelineEnabled;
     
     // 创建驱动实例
     DisplayDriverBase* createDriver(DisplayDriverType driverType);
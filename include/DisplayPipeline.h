@@ -0,0 +1,81 @@
+#ifndef DISPLAY_PIPELINE_H
+#define DISPLAY_PIPELINE_H
+
+#include "DisplayDriver.h"
+#include "ILI9341Driver.h"
+#include "ST7789Driver.h"
+
+// ==================== 像素写入路径配置 ====================
+
+// 编译时选定的显示驱动（platformio.ini 的 build_flags 中设置）
+#ifndef DEFAULT_DISPLAY_DRIVER
+#define DEFAULT_DISPLAY_DRIVER DRIVER_ILI9341
+#endif
+
+// 为 DEFAULT_DISPLAY_DRIVER 生成专用的像素写入路径（渲染循环全部内联）。
+// 通过 /api/driver 切换到其他驱动后自动回退到经 DisplayManager 的通用路径；
+// 设为0只保留通用路径，节省Flash
+#ifndef DISPLAY_STATIC_PIPELINE
+#define DISPLAY_STATIC_PIPELINE 1
+#endif
+
+namespace Display
+{
+  template <DisplayDriverType Type> struct PanelFor;
+  template <> struct PanelFor<DRIVER_ILI9341> { typedef ILI9341Driver type; };
+  template <> struct PanelFor<DRIVER_ST7789> { typedef ST7789Driver type; };
+
+  // 编译时选定的面板驱动
+  typedef PanelFor<DEFAULT_DISPLAY_DRIVER>::type StaticPanel;
+
+  // ==================== 像素写入目标 ====================
+  // 渲染循环以模板参数 Sink 写像素，每张图片只选择一次：
+  //   PanelSink<StaticPanel>  当前驱动就是编译时选定的面板，按具体类型调用，全部内联
+  //   ManagerSink             经 DisplayManager 和驱动虚函数转发，任何驱动都可用
+
+  struct ManagerSink
+  {
+    static const char* name() { return "runtime"; }
+    static int16_t width() { return displayManager.getWidth(); }
+    static int16_t height() { return displayManager.getHeight(); }
+    static void beginFrame() { displayManager.beginFrame(); }
+    static void endFrame() { displayManager.endFrame(); }
+    static void pushImage(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* pixels)
+    {
+      displayManager.pushImage(x, y, w, h, pixels);
+    }
+  };
+
+  template <class Panel>
+  struct PanelSink
+  {
+    // 调用前由 staticPipelineActive() 保证当前驱动的实际类型就是 Panel
+    static Panel& panel() { return *static_cast<Panel*>(displayManager.getDriver()); }
+
+    static const char* name() { return "static"; }
+    static int16_t width() { return panel().getTFT().width(); }
+    static int16_t height() { return panel().getTFT().height(); }
+    static void beginFrame() { panel().Panel::beginFrame(); }
+    static void endFrame() { panel().Panel::endFrame(); }
+    static void pushImage(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* pixels)
+    {
+      panel().Panel::pushImage(x, y, w, h, pixels);
+    }
+  };
+
+#if DISPLAY_STATIC_PIPELINE
+  typedef PanelSink<StaticPanel> StaticSink;
+#else
+  typedef ManagerSink StaticSink;
+#endif
+
+  // 当前驱动能否走专用路径；为false时使用 ManagerSink
+  inline bool staticPipelineActive()
+  {
+    return DISPLAY_STATIC_PIPELINE && displayManager.isStaticPipelineEnabled() &&
+           displayManager.getDriver() != nullptr &&
+           displayManager.getCurrentDriver() == StaticPanel::DRIVER_TYPE;
+  }
+}
+
+#endif // DISPLAY_PIPELINE_H
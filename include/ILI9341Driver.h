@@ -1,15 +1,17 @@
 #ifndef ILI9341_DRIVER_H
 #define ILI9341_DRIVER_H
 
-#include "DisplayDriver.h"
+#include "PanelDriver.h"
 #include <Adafruit_ILI9341.h>
 
 namespace Display
 {
   // ==================== ILI9341驱动实现 ====================
-  class ILI9341Driver : public DisplayDriverBase
+  class ILI9341Driver final : public PanelDriver<ILI9341Driver>
   {
   public:
+    static const DisplayDriverType DRIVER_TYPE = DRIVER_ILI9341;
+    
     ILI9341Driver();
     virtual ~ILI9341Driver();
     
@@ -19,12 +21,17 @@ namespace Display
     void setBrightness(uint8_t brightness) override;
     
     // 基础绘制功能
-    void clearScreen(uint16_t color = ILI9341_BLACK) override;
-    void fillScreen(uint16_t color) override;
     void drawPixel(int16_t x, int16_t y, uint16_t color) override;
     void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) override;
     void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
-    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    
+    // 纯色填充（clearScreen/fillScreen/fillRect）和整帧批量写入由 PanelDriver 实现
+    
+    // SPI总线配置
+    const SPIBusConfig& getSPIConfig() const override { return spiConfig; }
+    void setSPIFrequency(uint32_t frequency) override;
+    uint32_t getSPIFrequency() const override { return spiFrequency; }
+    uint32_t calibrateSPI(bool force = false) override;
     
     // 文本显示功能
     void displayText(const char* text, int16_t x = 10, int16_t y = 10,
@@ -56,15 +63,19 @@ namespace Display
     int16_t getHeight() const override { return SCREEN_HEIGHT; }
     
     // 获取驱动信息
-    DisplayDriverType getDriverType() const override { return DRIVER_ILI9341; }
+    DisplayDriverType getDriverType() const override { return DRIVER_TYPE; }
     const char* getDriverName() const override { return "ILI9341"; }
     
   private:
     Adafruit_ILI9341 tft;
     bool initialized;
+    uint32_t spiFrequency;
+    
+    static const SPIBusConfig spiConfig;
     
     // 私有辅助函数
     void initializePins();
+    void configureSPIClock();
     void setupDisplay();
     void testColorDisplay();
   };
@@ -0,0 +1,168 @@
+#ifndef IMAGE_CATALOG_H
+#define IMAGE_CATALOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "StaticString.h"
+#include "secrets.h"
+
+// ==================== 图片目录元数据配置 ====================
+
+// 还没有测量过的图片按此渲染耗时估算（毫秒）
+#ifndef CATALOG_DEFAULT_RENDER_COST_MS
+#define CATALOG_DEFAULT_RENDER_COST_MS 250
+#endif
+
+// 连续失败多少次后隔离：导航和幻灯片跳过，直到文件被替换或手动解除
+#ifndef CATALOG_QUARANTINE_FAILURES
+#define CATALOG_QUARANTINE_FAILURES 2
+#endif
+
+// 失败台账文件（以'.'开头，不出现在图片列表中）
+#define CATALOG_LEDGER_PATH "/.image_failures"
+
+// 图片列表快照缓冲区个数：当前版本 + 仍被读者引用的旧版本 + 写端正在构建的新版本
+#ifndef CATALOG_SNAPSHOT_SLOTS
+#define CATALOG_SNAPSHOT_SLOTS 3
+#endif
+
+namespace Catalog
+{
+  // 每张图片的运行时元数据，按文件名保存（列表重排、改名后仍然对应）
+  struct ImageMeta
+  {
+    ImageName name;
+    uint16_t renderCostMs;   // 渲染耗时的指数滑动平均，0表示未测量
+    uint8_t failures;        // 连续渲染失败次数，成功一次清零
+    uint8_t lastError;       // ImageDisplay::RenderError
+    uint8_t lastDetail;      // 解码器错误码（JPEG为JRESULT）
+    bool quarantined;
+  };
+
+  // ==================== 图片元数据表 ====================
+  // 渲染循环写入测量结果，幻灯片调度按它提前开始解码；
+  // 渲染失败记入台账，连续失败 CATALOG_QUARANTINE_FAILURES 次的图片被隔离，
+  // 导航时跳过，不再每轮都白白解码一次再画错误页。台账保存在
+  // CATALOG_LEDGER_PATH，重启后仍然有效；渲染耗时只在内存中。
+  // 图片列表变化时按文件名清理。内部用互斥锁保护。
+
+  class ImageMetaTable
+  {
+  public:
+    void begin();
+
+    // 记录一次成功渲染的耗时（同时清除失败记录）
+    void recordRenderCost(const char* name, uint32_t costMs);
+
+    // 记录一次渲染失败，返回true表示本次失败导致图片被隔离
+    bool recordFailure(const char* name, uint8_t error, uint8_t detail);
+    bool isQuarantined(const char* name);
+
+    // 清除失败记录：手动解除隔离，或文件被重新上传
+    bool clearFailures(const char* name);
+
+    // 复制有失败记录的条目，返回条数
+    uint8_t copyFailures(ImageMeta* out, uint8_t maxCount);
+    uint8_t quarantinedCount();
+
+    // 预计渲染耗时：未测量的图片用已测图片的平均值，都没有时用默认值
+    uint32_t expectedRenderCost(const char* name);
+
+    // 文件改名后同步（批量重命名、入库转码）
+    void renameImage(const char* from, const char* to);
+
+    // 图片列表变化后移除已不存在的条目
+    void prune(const ImageName* images, int imageCount);
+
+  private:
+    ImageMeta entries[MAX_IMAGES];
+    uint8_t count = 0;
+    SemaphoreHandle_t mutex = nullptr;
+
+    void lock();
+    void unlock();
+    int find(const char* name) const;
+    int findOrAdd(const char* name);
+    void loadLedger();
+    bool saveLedger();
+  };
+
+  extern ImageMetaTable imageMeta;
+
+  // ==================== 图片列表快照 ====================
+  // 图片列表由Web任务（上传、删除、批量操作）、入库任务和主循环（幻灯片换图）修改，
+  // 由渲染循环和各个API读取。写端把完整的新版本写进一块空闲缓冲区，再原子地替换
+  // 当前指针；读端只取指针并增加引用计数，从不加锁，拿到的总是某个完整版本。
+  // 旧版本在引用计数归零前不会被复用（延迟回收），写端之间用递归互斥锁串行化。
+
+  struct CatalogSnapshot
+  {
+    uint32_t version;
+    int count;
+    int current;                    // 当前图片索引，count为0时无意义
+    ImageName names[MAX_IMAGES];
+    mutable std::atomic<uint16_t> readers;  // 持有此版本的读者数
+
+    const char* currentName() const { return count > 0 ? names[current].c_str() : ""; }
+  };
+
+  class SnapshotCatalog
+  {
+  public:
+    SnapshotCatalog();
+    void begin();
+
+    // 读端：取得当前版本，用完后必须 release（一般通过 SnapshotRef）
+    const CatalogSnapshot* acquire();
+    void release(const CatalogSnapshot* snapshot);
+
+    // 写端：修改图片列表的整个过程持有写锁，最后 publish 一次
+    void lockWriter();
+    void unlockWriter();
+    void publish(const ImageName* names, int count, int current);
+
+    uint32_t version();
+
+    // 供 /api/status 使用
+    void addToJson(JsonObject obj);
+
+  private:
+    CatalogSnapshot slots[CATALOG_SNAPSHOT_SLOTS];
+    std::atomic<CatalogSnapshot*> published;
+    SemaphoreHandle_t writerMutex = nullptr;
+    std::atomic<uint32_t> readRetries;
+    uint32_t writerWaits = 0;
+  };
+
+  extern SnapshotCatalog catalog;
+
+  // 读端作用域引用：构造时取得当前版本，析构时释放
+  class SnapshotRef
+  {
+  public:
+    SnapshotRef() : snapshot(catalog.acquire()) {}
+    ~SnapshotRef() { catalog.release(snapshot); }
+    SnapshotRef(const SnapshotRef&) = delete;
+    SnapshotRef& operator=(const SnapshotRef&) = delete;
+
+    const CatalogSnapshot* operator->() const { return snapshot; }
+    const CatalogSnapshot& operator*() const { return *snapshot; }
+
+  private:
+    const CatalogSnapshot* snapshot;
+  };
+
+  // 写端作用域锁（批量操作等有多个提前返回的处理器）
+  class WriterLock
+  {
+  public:
+    WriterLock() { catalog.lockWriter(); }
+    ~WriterLock() { catalog.unlockWriter(); }
+    WriterLock(const WriterLock&) = delete;
+    WriterLock& operator=(const WriterLock&) = delete;
+  };
+}
+
+#endif // IMAGE_CATALOG_H
@@ -4,8 +4,28 @@
 #include <LittleFS.h>
 #include <TJpg_Decoder.h>
 #include "DisplayDriver.h"
+#include "StaticString.h"
 #include "secrets.h"
 
+// ==================== 分片渲染配置 ====================
+// 大图解码一次要数百毫秒，渲染按MCU行分片，每片结束后让出CPU，
+// 让AsyncTCP、lwIP和空闲任务（看门狗）运行。以下两个条件先满足者结束一片。
+
+// 每片最多解码的MCU行数（JPEG的MCU行为8或16像素高；BMP/RGB565按16像素行计）
+#ifndef RENDER_SLICE_MCU_ROWS
+#define RENDER_SLICE_MCU_ROWS 2
+#endif
+
+// 每片的时间预算（微秒）
+#ifndef RENDER_SLICE_BUDGET_US
+#define RENDER_SLICE_BUDGET_US 15000
+#endif
+
+// 片间让出的tick数
+#ifndef RENDER_SLICE_YIELD_TICKS
+#define RENDER_SLICE_YIELD_TICKS 1
+#endif
+
 namespace ImageDisplay
 {
   // ==================== 图片格式支持 ====================
@@ -13,7 +33,19 @@ namespace ImageDisplay
   enum class ImageFormat {
     UNKNOWN,
     JPEG,
-    BMP
+    BMP,
+    RGB565   // 入库转码生成的屏幕尺寸原始像素（.r565）
+  };
+
+  // 渲染失败原因，记入图片目录的失败台账
+  enum class RenderError : uint8_t {
+    NONE,
+    FILE_OPEN,      // 文件不存在或无法打开
+    BAD_HEADER,     // 文件头损坏或尺寸无效
+    UNSUPPORTED,    // 不支持的格式（如非24位BMP）
+    NO_MEMORY,      // 缓冲区分配失败（暂时性，不计入台账）
+    READ_FAILED,    // 读取像素数据失败（文件被截断）
+    DECODE_FAILED   // JPEG解码失败，detail 为TJpgDec的JRESULT
   };
 
   // BMP文件结构
@@ -54,6 +86,18 @@ namespace ImageDisplay
     FIT_SCREEN   // 适配屏幕
   };
 
+  // 一张图片在屏幕上的布局，每张图片开始时按（显示模式, 旋转方向）查表计算一次
+  struct FrameLayout
+  {
+    uint8_t scale;          // JPEG解码缩放比例（1/2/4/8），BMP/RGB565固定为1
+    uint16_t width;         // 缩放后的尺寸
+    uint16_t height;
+    int16_t x;              // 左上角屏幕坐标，负值表示该方向被裁剪
+    int16_t y;
+    uint16_t screenWidth;   // 当前旋转方向下的屏幕尺寸
+    uint16_t screenHeight;
+  };
+
   // ==================== 图片显示管理类 ====================
 
   class ImageDisplayManager
@@ -64,6 +108,9 @@ namespace ImageDisplay
     void setDisplayMode(bool centerImage = true, bool scaleToFit = false);
     void setOrientationMode(DisplayMode mode);
     void setAutoRotation(bool enable);
+    DisplayMode getOrientationMode() const { return orientationMode; }
+    bool isAutoRotationEnabled() const { return autoRotationEnabled; }
+    uint8_t getCurrentRotation() const { return currentRotation; }
 
     // 图片格式检测
     ImageFormat detectImageFormat(const char* filename);
@@ -73,6 +120,8 @@ namespace ImageDisplay
     bool displayImage(const char* filename);
     bool displayJPEG(const char* filename);
     bool displayBMP(const char* filename);
+    // label 为屏幕底部显示的文件名（显示入库缓存时传原图名），默认为 filename
+    bool displayRGB565(const char* filename, const char* label = nullptr);
 
     // 图片信息获取
     bool getImageDimensions(const char* filename, uint16_t& width, uint16_t& height);
@@ -88,6 +137,9 @@ namespace ImageDisplay
     void enableCache(bool enable) { cacheEnabled = enable; }
     void clearCache();
 
+    // 颜色转换
+    static uint16_t rgb888ToRgb565(uint8_t r, uint8_t g, uint8_t b);
+
   private:
     bool initialized;
     bool centerImage;
@@ -121,13 +173,10 @@ namespace ImageDisplay
     ImageOrientation detectImageOrientation(uint16_t width, uint16_t height);
     bool shouldRotateScreen(ImageOrientation imgOrientation);
     void applyOptimalRotation(uint16_t imgWidth, uint16_t imgHeight);
-    void calculateOptimalScale(uint16_t imgWidth, uint16_t imgHeight,
-                               uint8_t &scale, uint16_t &finalWidth, uint16_t &finalHeight);
-    void calculateSmartPosition(uint16_t imgWidth, uint16_t imgHeight,
-                                int16_t &x, int16_t &y, DisplayMode mode);
+    // scalable 为 false 时（BMP/RGB565不经过解码器缩放）比例固定为1
+    FrameLayout computeFrameLayout(uint16_t imgWidth, uint16_t imgHeight, bool scalable);
 
     // 颜色转换
-    uint16_t rgb888ToRgb565(uint8_t r, uint8_t g, uint8_t b);
     void bgr888ToRgb565(uint8_t b, uint8_t g, uint8_t r, uint16_t& color);
   };
 
@@ -154,6 +203,35 @@ namespace ImageDisplay
   ImageFormat getImageFormat(const char* filename);
   bool isValidImageFile(const char* filename);
 
+  // TJpgDec 是全局单例（回调、缩放比例共享），渲染与后台转码任务使用前需持有此锁
+  void lockDecoder();
+  void unlockDecoder();
+
+  // 是否有任务正在等待解码器锁（长时间持有锁的后台任务应尽快让出）
+  bool isDecoderContended();
+
+  // ==================== 渲染取消（最新请求优先） ====================
+  // 目标图片每变化一次，请求代数加一；渲染开始时记下当时的代数，
+  // 解码回调发现代数已变就返回0中止TJpgDec，剩余部分不再解码。
+  // 连续切换多次时只有最后一张会完整绘制，切换延迟不超过一个MCU行。
+
+  // 目标图片变化后调用（任意任务）
+  void requestRender();
+  uint32_t getRequestedGeneration();
+
+  // 当前渲染是否已被更新的请求取代
+  bool isRenderCancelled();
+  uint32_t getCancelledRenderCount();
+
+  // 最近一次渲染的失败原因；displayImage 开始时清为 NONE
+  RenderError getLastRenderError();
+  uint8_t getLastRenderDetail();
+  const char* renderErrorName(RenderError error);
+
+  // 分片统计：让出次数、两次让出之间最长的连续渲染时间（微秒）
+  uint32_t getRenderSliceCount();
+  uint32_t getMaxRenderSliceMicros();
+
   // TJpg_Decoder回调函数（全局函数）
   bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap);
 }
@@ -0,0 +1,95 @@
+#ifndef IMAGE_INGEST_H
+#define IMAGE_INGEST_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "StaticString.h"
+#include "secrets.h"
+
+// ==================== 入库转码配置 ====================
+
+// 是否在上传后把大JPEG转码为屏幕尺寸的RGB565图片
+#ifndef INGEST_ENABLED
+#define INGEST_ENABLED true
+#endif
+
+#ifndef INGEST_TASK_STACK_SIZE
+#define INGEST_TASK_STACK_SIZE 8192
+#endif
+
+// 与loop任务同优先级，按时间片轮转，不会饿死渲染
+#ifndef INGEST_TASK_PRIORITY
+#define INGEST_TASK_PRIORITY 1
+#endif
+
+// 保留上传的原图，转码结果作为隐藏的显示缓存（仅“适应”类显示模式使用）；
+// 设为 false 时转码结果直接替换原图，节省闪存但原图不可恢复
+#ifndef INGEST_KEEP_ORIGINAL
+#define INGEST_KEEP_ORIGINAL true
+#endif
+
+// 显示缓存文件名前缀，后接原图内容的CRC32和大小，相同内容共用一份缓存
+#define INGEST_CACHE_PREFIX "/.r565_"
+
+// 转码期间有渲染等待解码器时，在MCU行之间中止并让出；
+// 同一张图被连续打断这么多次后，下一次不再让出，保证最终能完成
+#ifndef INGEST_MAX_PREEMPTIONS
+#define INGEST_MAX_PREEMPTIONS 4
+#endif
+
+// 等待查重的新上传数量，超出时新上传按普通文件保存
+#ifndef INGEST_UPLOAD_QUEUE_SIZE
+#define INGEST_UPLOAD_QUEUE_SIZE 16
+#endif
+
+// 转码后的文件头大小
+#define RGB565_HEADER_SIZE 8
+
+// 只转码比屏幕尺寸RGB565文件更大的JPEG：更小的图解码本来就快；
+// 替换原图时也保证转码后不会占用更多存储
+#ifndef INGEST_MIN_FILE_SIZE
+#define INGEST_MIN_FILE_SIZE ((uint32_t)SCREEN_WIDTH * SCREEN_HEIGHT * 2 + RGB565_HEADER_SIZE)
+#endif
+
+namespace Ingest
+{
+  // ==================== RGB565 图片格式 ====================
+  // 8字节文件头 + 按行存放的RGB565像素（与TJpgDec输出及pushImage的字节序一致），
+  // 显示时无需解码，直接整行写入屏幕。
+
+  struct RGB565Header
+  {
+    char magic[4];    // "R565"
+    uint16_t width;
+    uint16_t height;
+  } __attribute__((packed));
+
+  static_assert(sizeof(RGB565Header) == RGB565_HEADER_SIZE, "RGB565 header size mismatch");
+
+  bool readHeader(File& file, RGB565Header& header);
+
+  // ==================== 入库转码任务 ====================
+  // 后台任务扫描图片目录，把超过 INGEST_MIN_FILE_SIZE 的JPEG按一次解码缩放到
+  // 适配屏幕的尺寸写成RGB565，之后以“适应”模式显示时省去大图解码。
+  // 默认保留原图，转码结果存为按内容命名的隐藏缓存；关闭 INGEST_KEEP_ORIGINAL
+  // 时转码结果替换原文件（手机照片从数MB缩小到约150KB）。
+  // 解码器由 ImageDisplay::lockDecoder 保护，有渲染等待时转码在MCU行之间让出。
+  // 新上传的内容查重也在本任务中执行，关闭 INGEST_ENABLED 时只查重不转码。
+
+  void begin();
+
+  // 图片列表变化后调用：唤醒后台任务转码新文件、清理无主缓存
+  void notify();
+
+  // 新上传保存为正式文件后调用：由后台任务查重（重复内容改为别名），然后转码。
+  // hashKnown 为 false 表示上传时没能记录内容哈希，由后台任务读取文件补算
+  void notifyUploaded(const char* name, bool hashKnown = true);
+
+  // 查找JPEG原图 name 的显示缓存，存在时把路径写入 path 并返回true
+  bool findDisplayCache(const char* name, ImagePath& path);
+
+  bool isBusy();
+  uint16_t getTranscodedCount();
+}
+
+#endif // IMAGE_INGEST_H
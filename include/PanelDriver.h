@@ -0,0 +1,171 @@
+#ifndef PANEL_DRIVER_H
+#define PANEL_DRIVER_H
+
+#include "DisplayDriver.h"
+#include "DMAFill.h"
+
+namespace Display
+{
+  // ==================== 面板驱动公共实现（CRTP） ====================
+  // ILI9341和ST7789的纯色填充和整帧写入（beginFrame/pushImage/endFrame）完全相同，只是
+  // Adafruit面板对象的类型不同。Derived 通过 getTFT() 提供具体的面板对象，
+  // 这里按具体类型调用 setAddrWindow/writePixels，不经过 Adafruit_GFX 的虚函数。
+  // 实现放在头文件中：经 PanelSink<Derived> 调用时整条写入路径可以内联；
+  // 经 DisplayManager 调用时仍是一次虚函数调用，用于运行时切换驱动。
+
+  template <class Derived>
+  class PanelDriver : public DisplayDriverBase
+  {
+  public:
+    // 纯色填充：大块填充走DMA常量缓冲区，失败或不可用时回退到Adafruit路径
+    void clearScreen(uint16_t color = 0x0000) override
+    {
+      auto& tft = self().getTFT();
+      solidFill(0, 0, tft.width(), tft.height(), color, true);
+    }
+
+    void fillScreen(uint16_t color) override
+    {
+      auto& tft = self().getTFT();
+      solidFill(0, 0, tft.width(), tft.height(), color, true);
+    }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override
+    {
+      solidFill(x, y, w, h, color, true);
+    }
+
+    bool benchmarkFill(uint8_t iterations, FillBenchmarkResult& result) override
+    {
+      // 红、绿、蓝、黑（RGB565）
+      static const uint16_t colors[] = { 0xF800, 0x07E0, 0x001F, 0x0000 };
+      auto& tft = self().getTFT();
+      result.pixels = (uint32_t)tft.width() * tft.height();
+      result.iterations = iterations;
+
+      unsigned long start = micros();
+      for (uint8_t i = 0; i < iterations; i++) {
+        solidFill(0, 0, tft.width(), tft.height(), colors[i % 4], false);
+      }
+      result.cpuMicros = micros() - start;
+
+      result.dmaMicros = 0;
+      if (dmaFill.isAvailable()) {
+        start = micros();
+        for (uint8_t i = 0; i < iterations; i++) {
+          solidFill(0, 0, tft.width(), tft.height(), colors[i % 4], true);
+        }
+        result.dmaMicros = micros() - start;
+      }
+
+      Serial.printf("Fill benchmark (%u x %lu px): CPU %lu us, DMA %lu us\n",
+                    iterations, (unsigned long)result.pixels,
+                    (unsigned long)result.cpuMicros, (unsigned long)result.dmaMicros);
+      return true;
+    }
+
+    // 整帧批量写入
+    void beginFrame() override
+    {
+      if (!inFrame) {
+        self().getTFT().startWrite();
+        transferStats.transactions++;
+        inFrame = true;
+      }
+    }
+
+    void endFrame() override
+    {
+      if (inFrame) {
+        self().getTFT().endWrite();
+        inFrame = false;
+      }
+    }
+
+    void pushImage(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* pixels) override
+    {
+      auto& tft = self().getTFT();
+
+      // 裁剪到当前旋转方向下的屏幕范围
+      int32_t x0 = x < 0 ? 0 : x;
+      int32_t y0 = y < 0 ? 0 : y;
+      int32_t x1 = (int32_t)x + w;
+      int32_t y1 = (int32_t)y + h;
+      if (x1 > tft.width()) x1 = tft.width();
+      if (y1 > tft.height()) y1 = tft.height();
+      if (x0 >= x1 || y0 >= y1) {
+        return;
+      }
+
+      uint16_t clippedW = x1 - x0;
+      uint16_t clippedH = y1 - y0;
+      uint16_t* src = pixels + (y0 - y) * w + (x0 - x);
+
+      recordWindow(!inFrame, (uint32_t)clippedW * clippedH);
+      if (transferStats.detailed) {
+        for (uint16_t row = 0; row < clippedH; row++) {
+          recordPixels(src + row * w, clippedW);
+        }
+      }
+
+      uint32_t start = transferBegin();
+      if (!inFrame) tft.startWrite();
+      tft.setAddrWindow(x0, y0, clippedW, clippedH);
+      if (clippedW == w) {
+        // 无水平裁剪，整块连续写入
+        tft.writePixels(src, (uint32_t)clippedW * clippedH);
+      } else {
+        for (uint16_t row = 0; row < clippedH; row++) {
+          tft.writePixels(src + row * w, clippedW);
+        }
+      }
+      if (!inFrame) tft.endWrite();
+      transferEnd(start);
+    }
+
+  protected:
+    bool inFrame = false;
+    SolidFillDMA dmaFill;
+
+    void solidFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool allowDMA)
+    {
+      auto& tft = self().getTFT();
+
+      int32_t x0 = x < 0 ? 0 : x;
+      int32_t y0 = y < 0 ? 0 : y;
+      int32_t x1 = (int32_t)x + w;
+      int32_t y1 = (int32_t)y + h;
+      if (x1 > tft.width()) x1 = tft.width();
+      if (y1 > tft.height()) y1 = tft.height();
+      if (x0 >= x1 || y0 >= y1) {
+        return;
+      }
+
+      uint32_t pixelCount = (uint32_t)(x1 - x0) * (y1 - y0);
+      recordWindow(!inFrame, pixelCount);
+      recordFill(color, pixelCount);
+
+      uint32_t start = transferBegin();
+
+      // 小块填充或帧事务内直接走Adafruit路径
+      if (!allowDMA || inFrame || !dmaFill.isAvailable() || pixelCount < DMA_FILL_MIN_PIXELS) {
+        tft.fillRect(x0, y0, x1 - x0, y1 - y0, color);
+      } else {
+        tft.startWrite();
+        tft.setAddrWindow(x0, y0, x1 - x0, y1 - y0);
+        uint32_t sent = dmaFill.fill(color, pixelCount);
+        if (sent < pixelCount) {
+          tft.writeColor(color, pixelCount - sent);
+        }
+        tft.endWrite();
+      }
+
+      transferEnd(start);
+    }
+
+  private:
+    Derived& self() { return static_cast<Derived&>(*this); }
+  };
+}
+
+#endif // PANEL_DRIVER_H
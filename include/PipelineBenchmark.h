@@ -0,0 +1,115 @@
+#ifndef PIPELINE_BENCHMARK_H
+#define PIPELINE_BENCHMARK_H
+
+#include <Arduino.h>
+#include "secrets.h"
+
+// ==================== 流水线基准测试配置 ====================
+
+// 每张图片、每种显示模式重复解码的次数（取最小/平均耗时）
+#ifndef PIPELINE_BENCHMARK_ROUNDS
+#define PIPELINE_BENCHMARK_ROUNDS 3
+#endif
+
+// /api/bench 单次任务最多重复次数
+#ifndef BENCH_JOB_MAX_ITERATIONS
+#define BENCH_JOB_MAX_ITERATIONS 20
+#endif
+
+// /api/bench 保留的单帧耗时样本数（超出部分只计入总量，不参与分位数）
+#ifndef BENCH_JOB_MAX_SAMPLES
+#define BENCH_JOB_MAX_SAMPLES 128
+#endif
+
+// 颜色转换基准测试：每种转换的重复次数和每次转换的像素数（缓冲区来自解码内存池）
+#ifndef COLOR_BENCHMARK_ROUNDS
+#define COLOR_BENCHMARK_ROUNDS 200
+#endif
+
+#ifndef COLOR_BENCHMARK_PIXELS
+#define COLOR_BENCHMARK_PIXELS 1024
+#endif
+
+namespace Benchmark
+{
+  // ==================== 解码流水线基准测试 ====================
+  // 对LittleFS根目录下的全部图片（按文件名排序），依次在四种DisplayMode下
+  // 调用 ImageDisplayManager::displayImage，记录耗时、传输字节数、SPI事务数、
+  // 峰值堆占用和输出像素校验和，每个用例以一行 "BENCH {json}" 输出到串口。
+  // scripts/pipeline_bench.py 负责采集这些行并与其他提交的结果对比。
+
+  struct PipelineCaseResult
+  {
+    bool ok;
+    uint32_t wallMinMicros;
+    uint32_t wallAvgMicros;
+    uint32_t bytes;
+    uint32_t transactions;
+    uint32_t windows;
+    uint32_t peakHeapUsed;   // 解码前空闲堆 - 解码期间最低空闲堆
+    uint32_t checksum;
+    bool stable;             // 多轮输出校验和是否一致
+  };
+
+  // 返回运行的用例数（LittleFS未挂载或没有图片时为0）
+  uint16_t runPipelineBenchmark(uint8_t rounds = PIPELINE_BENCHMARK_ROUNDS);
+
+  // ==================== 颜色转换基准测试 ====================
+  // 对比 ColorConvert 的逐像素参考实现与编译期选中的实现（设备上为32位SWAR），
+  // 每种转换以一行 "BENCH_COLOR {json}" 输出两者的 MPixel/s 及结果是否一致。
+  void runColorBenchmark(uint16_t rounds = COLOR_BENCHMARK_ROUNDS);
+
+  // ==================== 设备端基准测试任务 ====================
+  // 由 /api/bench 在Web任务中排队，在渲染（loop）任务中执行，
+  // 避免Web任务和渲染任务同时操作SPI总线。
+
+  enum class BenchJobState : uint8_t {
+    IDLE,
+    QUEUED,
+    RUNNING,
+    DONE
+  };
+
+  enum class BenchSource : uint8_t {
+    CATALOG,   // 图片列表中的全部图片
+    SYNTHETIC  // 内置全屏测试图案（只测传输，不读文件）
+  };
+
+  // 单帧耗时分布（微秒）
+  struct TimingSummary
+  {
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+  };
+
+  struct BenchJobResult
+  {
+    BenchSource source;
+    uint8_t iterations;
+    uint16_t frames;          // 渲染的帧数
+    uint16_t failures;        // 显示失败的帧数
+    TimingSummary decode;     // 读文件+解码（总耗时 - 传输耗时）
+    TimingSummary transfer;   // 阻塞在SPI写入上的时间
+    TimingSummary total;
+    uint32_t bytes;           // 写入显示屏的像素字节数
+    float spiMBps;            // 有效SPI吞吐 = bytes / 传输耗时
+    uint32_t spiFrequency;
+    uint32_t heapLowWater;    // 测试期间采样到的最低空闲堆
+    uint32_t elapsedMillis;
+    bool staticPipeline;      // 是否走编译期专用像素写入路径（见 DisplayPipeline.h）
+  };
+
+  // Web任务调用：已有任务排队或运行中时返回false。
+  // staticPipeline 为false时强制走经 DisplayManager 的通用路径，用于对比两条路径
+  bool queueBenchJob(BenchSource source, uint8_t iterations, bool staticPipeline = true);
+  BenchJobState getBenchJobState();
+
+  // 最近一次完成的结果（状态为DONE时有效）
+  const BenchJobResult& getBenchJobResult();
+
+  // 渲染任务调用：执行排队的任务，执行过任务时返回true（调用者需重绘当前图片）
+  bool serviceBenchJob();
+}
+
+#endif // PIPELINE_BENCHMARK_H
@@ -0,0 +1,109 @@
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "StaticString.h"
+#include "secrets.h"
+
+// ==================== 播放列表配置 ====================
+
+#ifndef PLAYLIST_MAX
+#define PLAYLIST_MAX 4
+#endif
+
+#ifndef PLAYLIST_MAX_ITEMS
+#define PLAYLIST_MAX_ITEMS MAX_IMAGES
+#endif
+
+// 播放列表文件（以'.'开头，不出现在图片列表中）
+#define PLAYLIST_PATH "/.playlists"
+
+namespace Playlist
+{
+  // 游标和条目数为 uint16_t，图片列表索引为 int16_t（-1 表示文件不存在）
+  static_assert(PLAYLIST_MAX_ITEMS <= UINT16_MAX, "PLAYLIST_MAX_ITEMS does not fit uint16_t");
+  static_assert(MAX_IMAGES <= INT16_MAX, "MAX_IMAGES does not fit the int16_t resolved index");
+
+  typedef StaticString<16> PlaylistName;
+
+  struct PlaylistItem
+  {
+    ImageName name;
+    uint16_t dwellSeconds;   // 0 = 使用幻灯片默认间隔
+  };
+
+  // ==================== 播放列表 ====================
+  // 条目按文件名保存（重新扫描后索引会变），resolve 时换算为图片列表索引。
+  // 随机播放使用带种子的 Fisher-Yates 在 order 数组上原地生成排列（拒绝采样，无取模偏差）：
+  // 同一种子得到同一顺序，每播完一轮种子加一换一个排列，不分配内存。
+
+  struct PlaylistData
+  {
+    PlaylistName name;
+    bool shuffle;
+    uint32_t seed;
+    uint16_t cursor;                         // order 中的位置
+    uint16_t itemCount;
+    PlaylistItem items[PLAYLIST_MAX_ITEMS];
+    uint16_t order[PLAYLIST_MAX_ITEMS];      // 播放顺序 → items 下标
+    int16_t resolved[PLAYLIST_MAX_ITEMS];    // items 下标 → 图片列表索引，-1 表示文件不存在
+
+    void buildOrder();
+  };
+
+  // ==================== 播放列表管理器 ====================
+  // Web任务修改，渲染循环推进游标，入库转码任务改名，内部用互斥锁保护。
+
+  class PlaylistManager
+  {
+  public:
+    void begin();
+
+    // 保存（新建或覆盖）一个播放列表，返回false表示已满或参数无效
+    bool save(const char* name, const PlaylistItem* items, uint16_t count, bool shuffle, uint32_t seed);
+    bool remove(const char* name);
+
+    // 激活播放列表；空名称表示取消，幻灯片回到按图片列表顺序播放
+    bool activate(const char* name);
+    bool isActive() const { return active >= 0; }
+    const char* activeName() const;
+
+    // 图片列表变化后重新换算索引
+    void resolve(const ImageName* images, int imageCount);
+
+    // 文件改名后同步条目（批量重命名、入库转码）
+    void renameImage(const char* from, const char* to);
+
+    // 按播放顺序前进/后退，返回图片列表索引；没有可播放的图片时返回-1
+    int next();
+    int previous();
+    int current();
+
+    // 预览 next() 的结果，不移动游标
+    int peekNext();
+
+    // 当前条目的停留时间（毫秒）
+    unsigned long currentDwell(unsigned long defaultInterval);
+
+    // 序列化为 /api/playlists 的JSON
+    String toJson();
+
+  private:
+    PlaylistData playlists[PLAYLIST_MAX];
+    uint8_t count = 0;
+    int8_t active = -1;
+    SemaphoreHandle_t mutex = nullptr;
+
+    void lock();
+    void unlock();
+    int find(const char* name) const;
+    int step(int direction);
+    bool load();
+    bool saveFile();
+  };
+
+  extern PlaylistManager playlistManager;
+}
+
+#endif // PLAYLIST_H
@@ -0,0 +1,164 @@
+#ifndef RESUMABLE_UPLOAD_H
+#define RESUMABLE_UPLOAD_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "StaticString.h"
+#include "secrets.h"
+
+// ==================== 断点续传上传配置 ====================
+
+// 分块大小：弱信号下单块失败只需重传这一块
+#ifndef UPLOAD_CHUNK_SIZE
+#define UPLOAD_CHUNK_SIZE (16 * 1024)
+#endif
+
+// 同时进行的上传会话数
+#ifndef UPLOAD_MAX_SESSIONS
+#define UPLOAD_MAX_SESSIONS 2
+#endif
+
+// 会话空闲超时（毫秒），超时的会话在需要槽位时被回收
+#ifndef UPLOAD_SESSION_TIMEOUT_MS
+#define UPLOAD_SESSION_TIMEOUT_MS (10UL * 60 * 1000)
+#endif
+
+// 正在接收的分块超过这段时间没有新数据，视为连接已断开，允许其他请求接手
+#ifndef UPLOAD_CHUNK_STALL_MS
+#define UPLOAD_CHUNK_STALL_MS 5000
+#endif
+
+// 临时文件名前缀（以'.'开头，扫描图片时会被忽略）
+#define UPLOAD_TEMP_PREFIX "/.upload_"
+
+namespace Upload
+{
+  static const uint16_t MAX_CHUNKS = (MAX_FILE_SIZE + UPLOAD_CHUNK_SIZE - 1) / UPLOAD_CHUNK_SIZE;
+
+  enum class UploadResult : uint8_t {
+    OK,
+    NOT_FOUND,      // 会话不存在或已过期
+    INVALID,        // 参数错误（文件名、大小）或内容不是有效图片
+    TOO_LARGE,      // 超过 MAX_FILE_SIZE
+    NO_SLOT,        // 会话已满
+    BAD_OFFSET,     // 偏移量未按分块对齐或越界
+    BAD_LENGTH,     // 分块长度与预期不符
+    CRC_MISMATCH,   // 分块或整个文件校验失败
+    INCOMPLETE,     // 还有分块未收到
+    BUSY,           // 同一会话的另一个分块请求正在传输
+    IO_ERROR        // 文件系统错误
+  };
+
+  const char* resultMessage(UploadResult result);
+
+  // 已接收的字节区间 [start, end)
+  struct ByteRange
+  {
+    uint32_t start;
+    uint32_t end;
+  };
+
+  // ==================== 上传会话 ====================
+
+  struct UploadSession
+  {
+    bool active = false;
+    uint32_t id;
+    ImageName name;              // 客户端提供的原始文件名
+    ImagePath tempPath;          // 临时文件路径（保留扩展名，便于校验格式）
+    uint32_t size;
+    bool hasFileCrc;
+    uint32_t fileCrc;            // 整个文件的CRC32（可选，在finalize时校验）
+    uint8_t received[(MAX_CHUNKS + 7) / 8];
+    unsigned long lastActivity;
+
+    // 正在接收的分块：同一时刻只属于一个请求（owner），其他请求得到 BUSY
+    const void* chunkOwner;
+    bool chunkInFlight;
+    File chunkFile;
+    uint32_t chunkOffset;
+    uint32_t chunkLength;
+    uint32_t chunkWritten;
+    uint32_t expectedCrc;
+    uint32_t runningCrc;
+    UploadResult chunkResult;
+
+    uint16_t chunkCount() const { return (size + UPLOAD_CHUNK_SIZE - 1) / UPLOAD_CHUNK_SIZE; }
+    bool hasChunk(uint16_t index) const { return received[index >> 3] & (1 << (index & 7)); }
+    uint32_t receivedBytes() const;
+    bool isComplete() const;
+    // 另一个请求的分块正在传输（长时间没有数据的视为已断开）
+    bool isChunkBusy(const void* owner) const;
+
+    // 把已接收的分块合并为区间，返回区间数
+    uint8_t getRanges(ByteRange* ranges, uint8_t maxRanges) const;
+  };
+
+  // ==================== 断点续传管理器 ====================
+  // 协议：init 分配会话和临时文件 → 按分块 PUT（offset + CRC32）→
+  // status 查询已收到的区间 → finalize 校验后原子重命名为正式文件。
+  // 所有调用都在Web服务器任务中进行。
+
+  class ResumableUploadManager
+  {
+  public:
+    UploadResult init(const char* name, uint32_t size, bool hasFileCrc, uint32_t fileCrc, uint32_t& id);
+    UploadSession* find(uint32_t id);
+
+    // 分块数据分多次到达：beginChunk → writeChunk... → endChunk。
+    // owner 标识发起的请求，分块状态保存在会话中，同一会话的并发分块请求得到 BUSY
+    UploadResult beginChunk(uint32_t id, const void* owner, uint32_t offset, uint32_t length, uint32_t crc);
+    UploadResult writeChunk(uint32_t id, const void* owner, const uint8_t* data, size_t len);
+    UploadResult endChunk(uint32_t id, const void* owner);
+
+    // owner 的分块请求结束后的处理结果
+    UploadResult chunkResult(uint32_t id, const void* owner);
+
+    // 所有分块到齐并通过整文件校验和 validate 检查后，把临时文件重命名为 targetPath
+    UploadResult finalize(uint32_t id, const char* targetPath, bool (*validate)(const char* path) = nullptr);
+    void abort(uint32_t id);
+
+    uint8_t activeSessions() const;
+
+  private:
+    UploadSession sessions[UPLOAD_MAX_SESSIONS];
+
+    UploadSession* allocateSession();
+    void releaseSession(UploadSession& session, bool removeFile);
+  };
+
+  extern ResumableUploadManager resumableUploads;
+
+  // ==================== 上传校验 ====================
+
+  static const uint8_t IMAGE_HEAD_BYTES = 54;  // BMP文件头+信息头
+
+  // 根据文件头判断内容是否是图片：
+  // JPEG 需以 FFD8 开头；BMP 需以 "BM" 开头且文件不短于头中声明的大小；
+  // R565 需以 "R565" 开头且大小与头中的宽高一致。
+  // JPEG 不检查结尾的 EOI：手机照片等常在 EOI 之后附带元数据，截断的文件交给
+  // 解码失败和隔离台账处理
+  bool validateImageData(const char* filename, const uint8_t* head, size_t headLen, uint32_t size);
+
+  // 流式上传时收集文件头和CRC32，不需要写完后再读回文件
+  class ImageStreamCheck
+  {
+  public:
+    void reset();
+    void update(const uint8_t* data, size_t len);
+    uint32_t size() const { return total; }
+    uint32_t crc() const { return runningCrc; }   // 整个文件的CRC32，用于内容去重
+    bool isValid(const char* filename) const;
+
+  private:
+    uint8_t head[IMAGE_HEAD_BYTES];
+    uint8_t headLen;
+    uint32_t total;
+    uint32_t runningCrc;
+  };
+
+  // 删除上次运行遗留的临时文件（会话只保存在内存中，重启后全部失效）
+  uint16_t removeStaleTempFiles();
+}
+
+#endif // RESUMABLE_UPLOAD_H
@@ -0,0 +1,66 @@
+#ifndef SPI_CONFIG_H
+#define SPI_CONFIG_H
+
+#include <Arduino.h>
+#include <Adafruit_SPITFT.h>
+#include "secrets.h"
+
+// ==================== SPI总线默认配置 ====================
+// 以下参数均可在 secrets.h 或 platformio.ini 的 build_flags 中覆盖
+
+// 校准基准时钟：所有模块都应能稳定工作的低速时钟
+#ifndef TFT_SPI_SAFE_FREQUENCY
+#define TFT_SPI_SAFE_FREQUENCY 10000000
+#endif
+
+// 各驱动允许的最高SPI时钟
+#ifndef ILI9341_SPI_MAX_FREQUENCY
+#define ILI9341_SPI_MAX_FREQUENCY 40000000
+#endif
+
+#ifndef ST7789_SPI_MAX_FREQUENCY
+#define ST7789_SPI_MAX_FREQUENCY 80000000
+#endif
+
+// 无法验证时钟时（未接MISO读不回RDDID，或关闭了校准）使用的时钟。
+// 默认退回基准时钟；确认接线能承受更高时钟时可在这里显式提高（不超过驱动最高时钟）
+#ifndef TFT_SPI_UNVERIFIED_FREQUENCY
+#define TFT_SPI_UNVERIFIED_FREQUENCY TFT_SPI_SAFE_FREQUENCY
+#endif
+
+// 启动时是否自动校准SPI时钟（结果保存在NVS中，只需校准一次）
+#ifndef TFT_SPI_CALIBRATE
+#define TFT_SPI_CALIBRATE true
+#endif
+
+namespace Display
+{
+  // ==================== SPI总线配置 ====================
+
+  struct SPIBusConfig
+  {
+    uint32_t safeFrequency;  // 校准起点（基准读回值在此时钟下采集）
+    uint32_t maxFrequency;   // 驱动允许的最高时钟
+    uint8_t readbackRounds;  // 每个时钟档位的写入/读回轮数
+  };
+
+  // 读回函数：读取只读ID寄存器（RDDID）的第index个字节
+  typedef uint8_t (*SPIReadbackFn)(Adafruit_SPITFT &tft, uint8_t index);
+
+  // ==================== SPI时钟校准器 ====================
+
+  class SPICalibrator
+  {
+  public:
+    // 从基准时钟开始逐档升高，写入测试图案并读回RDDID，
+    // 返回最后一个读回结果与基准一致的时钟；无法读回（未接MISO）时返回0
+    static uint32_t calibrate(Adafruit_SPITFT &tft, const SPIBusConfig &config, SPIReadbackFn readback);
+
+    // NVS持久化（按驱动名区分）
+    static bool loadFrequency(const char *driverName, uint32_t &frequency);
+    static void saveFrequency(const char *driverName, uint32_t frequency);
+    static void clearFrequency(const char *driverName);
+  };
+}
+
+#endif // SPI_CONFIG_H
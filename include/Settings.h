@@ -0,0 +1,79 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include "StaticString.h"
+#include "secrets.h"
+
+// ==================== 设置持久化配置 ====================
+
+// 配置项（幻灯片、显示模式、驱动）修改后静默多久再写入NVS，连续调整只写一次
+#ifndef SETTINGS_DEBOUNCE_MS
+#define SETTINGS_DEBOUNCE_MS 2000
+#endif
+
+// 当前图片随幻灯片频繁变化，最多每隔这么久写一次（NVS每条约3个条目，限制擦写次数）
+#ifndef SETTINGS_MIN_WRITE_INTERVAL_MS
+#define SETTINGS_MIN_WRITE_INTERVAL_MS 60000
+#endif
+
+namespace Settings
+{
+  // 当前版本；新增字段只能追加在记录末尾并递增版本号
+  static const uint8_t SETTINGS_VERSION = 1;
+
+  static const uint8_t DRIVER_UNSET = 0xFF;
+
+  struct RuntimeSettings
+  {
+    bool slideshowActive = false;
+    uint32_t slideshowInterval = 3000;   // 毫秒
+    uint8_t orientationMode = 1;         // ImageDisplay::DisplayMode，默认 SMART_SCALE
+    bool autoRotation = true;
+    uint8_t displayDriver = DRIVER_UNSET;
+    uint16_t currentIndex = 0;
+    ImageName currentImage;              // 优先按文件名恢复，索引作为后备
+  };
+
+  // ==================== 设置存储 ====================
+  // 全部运行时状态保存为NVS中的一个紧凑二进制记录，启动时一次读取。
+  // 修改只更新内存并标记为脏，由 service()（在 loop 中调用）按防抖规则写入：
+  // 配置项在静默 SETTINGS_DEBOUNCE_MS 后写入，当前图片的变化最多每
+  // SETTINGS_MIN_WRITE_INTERVAL_MS 写一次。
+
+  class SettingsStore
+  {
+  public:
+    // 从NVS加载，没有记录或记录无效时使用默认值并返回false
+    bool begin();
+
+    RuntimeSettings get();
+    uint32_t getLoadMicros() const { return loadMicros; }
+
+    void setSlideshow(bool active, uint32_t interval);
+    void setOrientation(uint8_t mode, bool autoRotation);
+    void setDisplayDriver(uint8_t driver);
+    void setCurrentImage(const char* name, uint16_t index);
+
+    void service();
+    void flush();
+
+  private:
+    RuntimeSettings settings;
+    bool dirty = false;
+    bool urgent = false;
+    unsigned long lastChange = 0;
+    unsigned long lastWrite = 0;
+    uint32_t loadMicros = 0;
+    SemaphoreHandle_t mutex = nullptr;
+
+    void lock();
+    void unlock();
+    void markDirty(bool isConfig);
+    void write();
+  };
+
+  extern SettingsStore settingsStore;
+}
+
+#endif // SETTINGS_H
@@ -0,0 +1,186 @@
+#ifndef STATIC_STRING_H
+#define STATIC_STRING_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// ==================== 定长字符串 ====================
+// 在栈上或对象内部存放的定长字符串，超出容量时截断，不做任何堆分配。
+// 用于幻灯片主循环、图片路径等热路径，替代会反复分配的 Arduino String。
+
+template <size_t N>
+class StaticString
+{
+public:
+  StaticString() { clear(); }
+  StaticString(const char *str) { assign(str); }
+
+  static constexpr size_t capacity() { return N - 1; }
+
+  void clear()
+  {
+    len = 0;
+    buf[0] = '\0';
+  }
+
+  // 返回false表示发生了截断
+  bool assign(const char *str)
+  {
+    clear();
+    return append(str);
+  }
+
+  bool assign(const char *str, size_t count)
+  {
+    clear();
+    return append(str, count);
+  }
+
+  bool append(const char *str)
+  {
+    return str ? append(str, strlen(str)) : true;
+  }
+
+  bool append(const char *str, size_t count)
+  {
+    size_t room = capacity() - len;
+    size_t n = count < room ? count : room;
+    memcpy(buf + len, str, n);
+    len += n;
+    buf[len] = '\0';
+    return n == count;
+  }
+
+  bool append(char c)
+  {
+    if (len >= capacity()) {
+      return false;
+    }
+    buf[len++] = c;
+    buf[len] = '\0';
+    return true;
+  }
+
+  __attribute__((format(printf, 2, 3)))
+  bool appendf(const char *format, ...)
+  {
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buf + len, N - len, format, args);
+    va_end(args);
+
+    if (written < 0) {
+      buf[len] = '\0';
+      return false;
+    }
+    bool fits = (size_t)written <= capacity() - len;
+    len = fits ? len + written : capacity();
+    return fits;
+  }
+
+  void truncate(size_t newLength)
+  {
+    if (newLength < len) {
+      len = newLength;
+      buf[len] = '\0';
+    }
+  }
+
+  void toLowerCase()
+  {
+    for (size_t i = 0; i < len; i++) {
+      buf[i] = tolower((unsigned char)buf[i]);
+    }
+  }
+
+  const char *c_str() const { return buf; }
+  size_t length() const { return len; }
+  bool isEmpty() const { return len == 0; }
+  char operator[](size_t index) const { return index < len ? buf[index] : '\0'; }
+
+  bool equals(const char *str) const { return str && strcmp(buf, str) == 0; }
+  bool operator==(const char *str) const { return equals(str); }
+  bool operator!=(const char *str) const { return !equals(str); }
+  template <size_t M>
+  bool operator==(const StaticString<M> &other) const { return equals(other.c_str()); }
+  template <size_t M>
+  bool operator!=(const StaticString<M> &other) const { return !equals(other.c_str()); }
+
+  bool startsWith(const char *prefix) const
+  {
+    size_t n = strlen(prefix);
+    return n <= len && strncmp(buf, prefix, n) == 0;
+  }
+
+  bool endsWith(const char *suffix) const
+  {
+    size_t n = strlen(suffix);
+    return n <= len && strcmp(buf + len - n, suffix) == 0;
+  }
+
+  bool endsWithIgnoreCase(const char *suffix) const
+  {
+    size_t n = strlen(suffix);
+    return n <= len && strcasecmp(buf + len - n, suffix) == 0;
+  }
+
+  int lastIndexOf(char c) const
+  {
+    for (int i = (int)len - 1; i >= 0; i--) {
+      if (buf[i] == c) return i;
+    }
+    return -1;
+  }
+
+private:
+  char buf[N];
+  size_t len;
+};
+
+// ==================== 常用定长字符串类型 ====================
+
+// 文件名（LittleFS单个文件名最长31字节）
+#ifndef MAX_FILENAME_LENGTH
+#define MAX_FILENAME_LENGTH 32
+#endif
+
+// 完整路径（含前导'/'和临时后缀）
+#ifndef MAX_PATH_LENGTH
+#define MAX_PATH_LENGTH 48
+#endif
+
+typedef StaticString<MAX_FILENAME_LENGTH> ImageName;
+typedef StaticString<MAX_PATH_LENGTH> ImagePath;
+
+// 把文件名规范化为以'/'开头的绝对路径
+inline ImagePath makeImagePath(const char *filename)
+{
+  ImagePath path;
+  if (filename && filename[0] != '/') {
+    path.append('/');
+  }
+  path.append(filename);
+  return path;
+}
+
+// 按扩展名判断是否为支持的图片文件（不区分大小写）
+inline bool hasImageExtension(const char *filename)
+{
+  const char *dot = filename ? strrchr(filename, '.') : nullptr;
+  if (!dot) {
+    return false;
+  }
+  return strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0 ||
+         strcasecmp(dot, ".bmp") == 0 || strcasecmp(dot, ".png") == 0 ||
+         strcasecmp(dot, ".r565") == 0;
+}
+
+// 隐藏文件（文件名以'.'开头，如上传临时文件），不出现在图片列表中
+inline bool isHiddenFile(const char *filename)
+{
+  const char *slash = filename ? strrchr(filename, '/') : nullptr;
+  const char *base = slash ? slash + 1 : filename;
+  return base && base[0] == '.';
+}
+
+#endif // STATIC_STRING_H
@@ -0,0 +1,106 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <Arduino.h>
+#include "secrets.h"
+
+// ==================== 文本渲染配置 ====================
+
+// 支持的最大字号（更大的字号回退到Adafruit_GFX逐像素绘制）
+#ifndef TEXT_MAX_SIZE
+#define TEXT_MAX_SIZE 3
+#endif
+
+// 字形缓存槽位数（每槽按最大字号预留约224字节，16槽约3.5KB静态内存）
+#ifndef TEXT_GLYPH_CACHE_SLOTS
+#define TEXT_GLYPH_CACHE_SLOTS 16
+#endif
+
+// 条带缓冲区像素数（不透明文本按条带渲染后整块写入），至少要容纳一行屏幕宽度的像素
+#ifndef TEXT_STRIP_PIXELS
+#define TEXT_STRIP_PIXELS (SCREEN_WIDTH * 2)
+#endif
+
+// 字号大于1时是否对放大的字形做抗锯齿
+#ifndef TEXT_ANTI_ALIAS
+#define TEXT_ANTI_ALIAS true
+#endif
+
+namespace Display
+{
+  class DisplayDriverBase;
+
+  // 经典5x7字体的字符单元尺寸（含1像素字间距和1像素行间距）
+  static const uint8_t GLYPH_CELL_WIDTH = 6;
+  static const uint8_t GLYPH_CELL_HEIGHT = 8;
+
+  // ==================== 文本渲染器 ====================
+  // 把字形预先光栅化为4位覆盖率并缓存，取代Adafruit_GFX逐像素绘制字形。
+  // 透明绘制（与Adafruit_GFX只设前景色时相同，不覆盖字形外的像素）：
+  //   每行覆盖率过半的连续像素合并为一段水平线写入，无法与未知背景混合，不做抗锯齿；
+  // 不透明绘制（调用者已知背景色，例如刚填充过的状态栏）：
+  //   按前景/背景色生成16级RGB565调色板，整段文本渲染到条带缓冲区后以窗口方式批量写入。
+
+  class TextRenderer
+  {
+  public:
+    TextRenderer();
+
+    void setAntiAlias(bool enable);
+    bool isAntiAlias() const { return antiAlias; }
+
+    // 是否能处理该字号（否则调用者应回退到Adafruit_GFX）
+    bool supportsSize(uint8_t size) const { return size >= 1 && size <= TEXT_MAX_SIZE; }
+
+    // 文本宽度（像素），只计算到第一个换行符或 len
+    static uint16_t measure(const char *text, size_t len, uint8_t size);
+
+    // 透明绘制文本，'\n' 换行后回到起始x
+    void drawText(DisplayDriverBase &driver, const char *text, int16_t x, int16_t y,
+                  uint16_t fg, uint8_t size);
+
+    // 以背景色 bg 不透明绘制文本（字符单元整块覆盖）
+    void drawText(DisplayDriverBase &driver, const char *text, int16_t x, int16_t y,
+                  uint16_t fg, uint16_t bg, uint8_t size);
+
+    // 不透明绘制单行文本段（不解析换行）
+    void drawRun(DisplayDriverBase &driver, const char *text, size_t len, int16_t x, int16_t y,
+                 uint16_t fg, uint16_t bg, uint8_t size);
+
+    void clearCache();
+
+  private:
+    static const uint16_t MAX_CELL_PIXELS = GLYPH_CELL_WIDTH * TEXT_MAX_SIZE * GLYPH_CELL_HEIGHT * TEXT_MAX_SIZE;
+
+    struct GlyphSlot
+    {
+      uint8_t ch;
+      uint8_t size;
+      bool antiAlias;
+      bool valid;
+      uint32_t lastUse;
+      uint8_t coverage[MAX_CELL_PIXELS / 2]; // 4位覆盖率，每字节两个像素
+    };
+
+    GlyphSlot cache[TEXT_GLYPH_CACHE_SLOTS];
+    uint32_t useCounter;
+    bool antiAlias;
+
+    uint16_t strip[TEXT_STRIP_PIXELS];
+    uint16_t palette[16];
+
+    const GlyphSlot &getGlyph(uint8_t ch, uint8_t size);
+    void drawLines(DisplayDriverBase &driver, const char *text, int16_t x, int16_t y,
+                   uint16_t fg, uint16_t bg, uint8_t size, bool opaque);
+    void drawRunTransparent(DisplayDriverBase &driver, const char *text, size_t len, int16_t x, int16_t y,
+                            uint16_t fg, uint8_t size);
+    size_t clipRun(DisplayDriverBase &driver, size_t len, int16_t x, uint8_t size) const;
+    void rasterize(GlyphSlot &slot);
+    void buildPalette(uint16_t fg, uint16_t bg);
+  };
+
+  // 全局文本渲染器实例
+  extern TextRenderer textRenderer;
+}
+
+#endif // TEXT_RENDERER_H
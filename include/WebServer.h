@@ -5,8 +5,24 @@
 #include <ESPAsyncWebServer.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include "StaticString.h"
 #include "secrets.h"
 
+// ==================== 批量操作配置 ====================
+
+// /api/batch、/api/playlists 请求体上限（JSON）
+#ifndef BATCH_MAX_BODY_SIZE
+#define BATCH_MAX_BODY_SIZE 4096
+#endif
+
+// 单次批量请求的最大操作数
+#ifndef BATCH_MAX_OPS
+#define BATCH_MAX_OPS 64
+#endif
+
+// 自定义图片顺序（以'.'开头，不出现在图片列表中）
+#define IMAGE_ORDER_PATH "/.image_order"
+
 namespace WebServerManager
 {
   // ==================== Web服务器管理类 ====================
@@ -28,11 +44,14 @@ namespace WebServerManager
     }
 
     // 初始化和设置
+    // begin 只做本地部分（文件系统、图片列表、恢复上次状态），可以立即显示图片；
+    // startNetwork 发起WiFi连接并启动Web服务器，不等待连接完成
     bool begin();
+    bool startNetwork();
     void stop();
     bool isRunning() const { return serverRunning; }
 
-    // WiFi管理
+    // WiFi管理（非阻塞，只发起连接）
     bool connectWiFi(const char* ssid, const char* password);
     bool isWiFiConnected() const { return WiFi.status() == WL_CONNECTED; }
     String getIPAddress() const { return WiFi.localIP().toString(); }
@@ -42,16 +61,19 @@ namespace WebServerManager
     bool isFileSystemReady() const { return fileSystemReady; }
 
     // 图片管理
+    // 查询读取 Catalog::catalog 的当前快照，不加锁，可在任何任务中调用；
+    // 需要列表和当前图片保持一致时直接使用 Catalog::SnapshotRef
     void scanImages();
-    int getImageCount() const { return imageCount; }
+    int getImageCount() const;
     String getCurrentImageName() const;
-    int getCurrentImageIndex() const { return currentImageIndex; }
+    ImageName getCurrentImage() const; // 无图片时返回空串，不分配内存
+    int getCurrentImageIndex() const;
 
     // 图片控制
     bool nextImage();
     bool previousImage();
     bool setCurrentImage(int index);
-    bool deleteImage(const String& filename);
+    bool deleteImage(const String& filename, bool allReferences = false);
 
     // 幻灯片控制
     bool toggleSlideshow();
@@ -62,6 +84,14 @@ namespace WebServerManager
     unsigned long getSlideshowInterval() const { return slideshowInterval; }
     void updateSlideshow(); // 在主循环中调用
 
+    // 幻灯片调度：按截止时间换图，提前“预计渲染耗时”开始解码，使画面在截止时间画完。
+    // 主循环渲染结束后调用 onFrameRendered 记录耗时和偏差，并推进下一个截止时间
+    void onFrameRendered(const char* name, bool success, unsigned long startMs, unsigned long endMs);
+    // 待完成的切换没有产生渲染（切回了屏幕上的图片、列表已清空）时调用，
+    // 结束等待并从 nowMs 开始下一个间隔；没有待完成的切换时什么也不做
+    void onSwitchSettled(unsigned long nowMs);
+    unsigned long getMillisUntilSlideSwitch();
+
     // API响应
     String getImageListJson() const;
     String getSystemStatusJson() const;
@@ -71,15 +101,33 @@ namespace WebServerManager
     bool serverRunning;
     bool fileSystemReady;
 
-    // 图片管理
-    String imageList[MAX_IMAGES];
+    // 图片列表的写端工作副本：只在持有 Catalog 写锁时读写，改完后 publishImageList 发布快照
+    ImageName imageList[MAX_IMAGES];
     int imageCount;
     int currentImageIndex;
 
     // 幻灯片控制
+    struct SlideJitterStats
+    {
+      uint32_t frames = 0;
+      int32_t lastMs = 0;
+      uint32_t totalAbsMs = 0;
+      uint32_t maxAbsMs = 0;
+      uint32_t resyncs = 0;
+    };
+
     bool slideshowActive;
     unsigned long slideshowInterval;
-    unsigned long lastSlideshowChange;
+    unsigned long slideDeadline;       // 下一张应当画完的时间
+    bool slideSwitchPending;           // 已切换，等待渲染完成
+    unsigned long slideSwitchTime;     // 开始切换的时间 = 截止时间 - 下一张的预计渲染耗时
+    uint32_t slideSwitchVersion;       // 计算 slideSwitchTime 时的图片列表快照版本
+    bool slideSwitchTimeValid;
+    SlideJitterStats slideJitter;
+
+    int stepImageIndex(int direction);
+    unsigned long getSlideSwitchTime();
+    void armSlideDeadline(unsigned long from);
 
     // 路由设置
     void setupRoutes();
@@ -101,16 +149,39 @@ namespace WebServerManager
     void handleSlideshowStatusAPI(AsyncWebServerRequest *request);
     void handleDisplayDriverAPI(AsyncWebServerRequest *request);
     void handleSetDisplayDriverAPI(AsyncWebServerRequest *request);
+    void handleBenchAPI(AsyncWebServerRequest *request);
+    void handleImageDownloadAPI(AsyncWebServerRequest *request);
+    void handleUploadInitAPI(AsyncWebServerRequest *request);
+    void handleUploadChunkAPI(AsyncWebServerRequest *request);
+    void handleUploadSessionAPI(AsyncWebServerRequest *request);
+    void handleUploadFinalizeAPI(AsyncWebServerRequest *request);
+    void handleUploadAbortAPI(AsyncWebServerRequest *request);
+    static void handleUploadChunkBody(AsyncWebServerRequest *request, uint8_t *data,
+                                      size_t len, size_t index, size_t total);
+    void handleBenchStatusAPI(AsyncWebServerRequest *request);
+    void handleBatchAPI(AsyncWebServerRequest *request);
+    void handlePlaylistAPI(AsyncWebServerRequest *request);
+    void sendPlaylistsResponse(AsyncWebServerRequest *request, int code);
+    void handleQuarantineAPI(AsyncWebServerRequest *request);
+    void sendQuarantineResponse(AsyncWebServerRequest *request);
+    static void handleJsonBody(AsyncWebServerRequest *request, uint8_t *data,
+                                size_t len, size_t index, size_t total);
 
     // 文件上传处理
     static void handleFileUpload(AsyncWebServerRequest *request, String filename,
                                size_t index, uint8_t *data, size_t len, bool final);
 
     // 工具函数
-    bool isValidImageFile(const String& filename) const;
+    bool isValidImageFile(const char* filename) const;
     String sanitizeFilename(const String& filename) const;
     bool validateImageUpload(const String& filename, size_t fileSize) const;
-    String generateSafeFilename(const String &originalName) const;
+    ImageName generateSafeFilename(const char* originalName) const;
+
+    // 图片列表维护
+    void applyImageOrder();
+    void publishImageList();
+    void publishCurrentImage();
+    const char* workingCurrentName() const;
   };
 
   // 全局Web服务器控制器实例
@@ -120,6 +191,7 @@ namespace WebServerManager
 
   // 初始化和控制
   bool setup();
+  bool startNetwork();
   bool isRunning();
   String getIPAddress();
 
@@ -127,6 +199,7 @@ namespace WebServerManager
   void scanImages();
   int getImageCount();
   String getCurrentImageName();
+  ImageName getCurrentImage();
   int getCurrentImageIndex();
 
   // 图片控制
@@ -140,11 +213,6 @@ namespace WebServerManager
 
   // 颜色测试
   void testDisplayColors();
-
-  // 向后兼容的全局变量访问
-  extern int currentImageIndex;
-  extern String imageList[];
-  extern int imageCount;
 }
 
 #endif // WEB_SERVER_MANAGER_H
@@ -0,0 +1,131 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ArduinoJson.h>
+
+// ==================== WiFi连接配置 ====================
+
+// 使用缓存的BSSID/信道直连的超时，超时后回退到完整扫描
+#ifndef WIFI_FAST_CONNECT_TIMEOUT_MS
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000
+#endif
+
+// 完整扫描连接的超时
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#endif
+
+// 连接失败后的退避等待：从最小值开始逐次翻倍，不超过最大值
+#ifndef WIFI_BACKOFF_MIN_MS
+#define WIFI_BACKOFF_MIN_MS 1000
+#endif
+
+#ifndef WIFI_BACKOFF_MAX_MS
+#define WIFI_BACKOFF_MAX_MS 60000
+#endif
+
+// 直连时复用上次DHCP分配的地址（跳过DHCP，约省0.5~2秒）。
+// 复用期间设备不向路由器续租，租约过期后地址可能被分给别的设备而冲突，默认关闭；
+// 只在路由器为本设备保留了地址（静态DHCP绑定）时建议开启
+#ifndef WIFI_REUSE_IP_LEASE
+#define WIFI_REUSE_IP_LEASE false
+#endif
+
+// 复用同一个租约的最大次数，之后的直连重新走DHCP取得新租约
+#ifndef WIFI_LEASE_MAX_REUSES
+#define WIFI_LEASE_MAX_REUSES 3
+#endif
+
+// 用复用的地址连上后，经过这段时间重连一次走DHCP，取得可续租的正式租约
+#ifndef WIFI_LEASE_RENEW_MS
+#define WIFI_LEASE_RENEW_MS 300000
+#endif
+
+namespace Net
+{
+  enum class LinkState : uint8_t
+  {
+    IDLE,             // 未启动
+    FAST_CONNECTING,  // 使用缓存的BSSID/信道（和地址）直连
+    CONNECTING,       // 完整扫描 + DHCP
+    CONNECTED,
+    BACKOFF           // 失败后等待重试
+  };
+
+  struct LinkStats
+  {
+    uint32_t connects = 0;          // 成功连接次数（含首次）
+    uint32_t reconnects = 0;        // 断线后重连成功次数
+    uint32_t disconnects = 0;
+    uint32_t failures = 0;          // 超时的连接尝试
+    uint32_t fastConnects = 0;      // 通过缓存直连成功的次数
+    uint32_t lastConnectMs = 0;     // 最近一次从发起到拿到IP的耗时
+    uint32_t lastReconnectMs = 0;   // 最近一次从断线到重新连上的耗时
+  };
+
+  // ==================== WiFi连接管理器 ====================
+  // 非阻塞状态机，由 loop 调用 service() 推进，连接期间幻灯片照常播放。
+  // 连上后把BSSID、信道（开启 WIFI_REUSE_IP_LEASE 时还有DHCP租约）缓存到NVS，
+  // 之后（重启或断线）先按缓存直连，省去扫描；直连失败再完整扫描，仍失败则指数退避重试。
+  // 只有DHCP取得的地址才会写入缓存，复用次数达到上限后重新DHCP。
+  // 断线重连由本管理器负责，关闭了WiFi驱动的自动重连。
+
+  class WiFiLinkManager
+  {
+  public:
+    // 保存凭据并发起第一次连接，立即返回
+    bool begin(const char* ssid, const char* password);
+    void service();
+
+    LinkState getState() const { return state; }
+    bool isConnected() const { return state == LinkState::CONNECTED; }
+    const LinkStats& getStats() const { return stats; }
+
+    // 供 /api/status 使用
+    void addToJson(JsonObject obj) const;
+
+  private:
+    struct CachedLink
+    {
+      uint8_t version;
+      uint8_t channel;
+      uint8_t bssid[6];
+      uint32_t ssidHash;    // SSID变更后缓存失效
+      uint32_t ip;
+      uint32_t gateway;
+      uint32_t subnet;
+      uint32_t dns;
+      uint8_t leaseReuses;  // 上次DHCP之后复用该地址直连的次数
+    } __attribute__((packed));
+
+    const char* ssid = nullptr;
+    const char* password = nullptr;
+    LinkState state = LinkState::IDLE;
+    LinkStats stats;
+    CachedLink cache;
+    bool cacheValid = false;
+    bool usingCachedLease = false;     // 本次直连使用缓存地址，而不是DHCP
+    uint8_t failedAttempts = 0;
+    unsigned long stateSince = 0;      // 当前状态的开始时间
+    unsigned long attemptStart = 0;    // 本次连接尝试的开始时间
+    unsigned long disconnectedAt = 0;  // 断线时间，0表示不是重连
+    unsigned long backoffMs = 0;
+
+    void loadCache();
+    void saveCache();
+    void startAttempt();
+    void startFastConnect();
+    void startFullConnect();
+    void onConnected();
+    void onAttemptFailed();
+    void enterState(LinkState newState);
+  };
+
+  extern WiFiLinkManager wifiLink;
+
+  const char* linkStateName(LinkState state);
+}
+
+#endif // WIFI_LINK_H
@@ -15,6 +15,12 @@
 #define TFT_DC   6   // 数据/命令引脚
 #define TFT_RST  10  // 复位引脚
 
+// SPI时钟配置（可选，默认值见 SPIConfig.h）
+// #define ILI9341_SPI_MAX_FREQUENCY 40000000  // ILI9341 最高SPI时钟
+// #define ST7789_SPI_MAX_FREQUENCY 80000000   // ST7789 最高SPI时钟
+// #define TFT_SPI_CALIBRATE false             // 关闭启动时的SPI时钟校准
+// #define TFT_SPI_UNVERIFIED_FREQUENCY 40000000  // 未接MISO无法校准时使用的时钟（默认10MHz基准时钟）
+
 // 显示屏尺寸
 #define SCREEN_WIDTH  320
 #define SCREEN_HEIGHT 240
@@ -0,0 +1,282 @@
+#!/usr/bin/env python3
+"""
+Little Gallery ESP32 解码流水线基准测试工具
+
+配合 airm2m_core_esp32c3_bench 环境使用：
+  1. corpus   生成固定的测试语料（JPEG/BMP，横竖屏、大图、奇数尺寸）
+  2. upload   通过 /upload 接口把语料上传到设备
+  3. capture  复位设备并从串口采集 "BENCH {json}" 结果，保存为JSON文件
+  4. compare  对比两次采集的结果（耗时、传输量、输出校验和）
+
+用法示例:
+  python scripts/pipeline_bench.py corpus bench/corpus
+  python scripts/pipeline_bench.py upload littlegallery.local bench/corpus
+  pio run -e airm2m_core_esp32c3_bench -t upload
+  python scripts/pipeline_bench.py capture /dev/ttyUSB0
+  python scripts/pipeline_bench.py compare bench/results/abc1234.json bench/results/def5678.json
+"""
+
+import argparse
+import json
+import struct
+import subprocess
+import sys
+import time
+import urllib.request
+import uuid
+from pathlib import Path
+
+# 语料定义: (文件名, 宽, 高, 格式)
+# 文件名不超过31字节（LittleFS限制），且只含上传时不会被改写的字符
+CORPUS = [
+    ("land_320x240.jpg", 320, 240, "jpeg"),
+    ("port_240x320.jpg", 240, 320, "jpeg"),
+    ("large_1600x1200.jpg", 1600, 1200, "jpeg"),
+    ("large_port_1200x1600.jpg", 1200, 1600, "jpeg"),
+    ("odd_333x197.jpg", 333, 197, "jpeg"),
+    ("odd_1021x767.jpg", 1021, 767, "jpeg"),
+    ("square_480x480.jpg", 480, 480, "jpeg"),
+    ("land_320x240.bmp", 320, 240, "bmp"),
+    ("port_240x320.bmp", 240, 320, "bmp"),
+    ("odd_203x151.bmp", 203, 151, "bmp"),
+]
+
+
+def pattern_pixel(x, y, w, h):
+    """确定性的测试图案：渐变 + 棋盘格 + 对角线，兼顾平滑区域和高频细节"""
+    r = (x * 255) // max(w - 1, 1)
+    g = (y * 255) // max(h - 1, 1)
+    b = 255 if ((x // 16) + (y // 16)) % 2 == 0 else 64
+    if abs(x * h - y * w) < max(w, h) * 2:
+        r, g, b = 255, 255, 255
+    return r, g, b
+
+
+def write_bmp24(path, w, h):
+    """生成24位未压缩BMP（自底向上存储，行4字节对齐）"""
+    row_size = (w * 3 + 3) // 4 * 4
+    data_size = row_size * h
+    header = struct.pack("<2sIHHI", b"BM", 54 + data_size, 0, 0, 54)
+    info = struct.pack("<IiiHHIIiiII", 40, w, h, 1, 24, 0, data_size, 2835, 2835, 0, 0)
+
+    with open(path, "wb") as f:
+        f.write(header)
+        f.write(info)
+        padding = b"\x00" * (row_size - w * 3)
+        for y in range(h - 1, -1, -1):
+            row = bytearray()
+            for x in range(w):
+                r, g, b = pattern_pixel(x, y, w, h)
+                row += bytes((b, g, r))
+            f.write(row)
+            f.write(padding)
+
+
+def write_jpeg(path, w, h):
+    """生成基线JPEG（需要Pillow；TJpgDec不支持渐进式JPEG）"""
+    try:
+        from PIL import Image
+    except ImportError:
+        print("Pillow is required to generate JPEG corpus: pip install pillow")
+        return False
+
+    img = Image.new("RGB", (w, h))
+    img.putdata([pattern_pixel(x, y, w, h) for y in range(h) for x in range(w)])
+    img.save(path, "JPEG", quality=85, progressive=False, optimize=False, subsampling=2)
+    return True
+
+
+def cmd_corpus(args):
+    out_dir = Path(args.output)
+    out_dir.mkdir(parents=True, exist_ok=True)
+
+    missing = 0
+    for name, w, h, fmt in CORPUS:
+        path = out_dir / name
+        if path.exists() and not args.force:
+            print(f"Exists: {path}")
+            continue
+        if fmt == "bmp":
+            write_bmp24(path, w, h)
+        elif not write_jpeg(path, w, h):
+            missing += 1
+            continue
+        print(f"Generated: {path} ({path.stat().st_size} bytes)")
+    return 1 if missing else 0
+
+
+def upload_file(host, path):
+    """以multipart/form-data方式上传单个文件到 /upload"""
+    boundary = uuid.uuid4().hex
+    content = Path(path).read_bytes()
+    body = (
+        f"--{boundary}\r\n"
+        f'Content-Disposition: form-data; name="file"; filename="{Path(path).name}"\r\n'
+        f"Content-Type: application/octet-stream\r\n\r\n"
+    ).encode() + content + f"\r\n--{boundary}--\r\n".encode()
+
+    request = urllib.request.Request(
+        f"http://{host}/upload",
+        data=body,
+        headers={"Content-Type": f"multipart/form-data; boundary={boundary}"},
+        method="POST",
+    )
+    with urllib.request.urlopen(request, timeout=60) as response:
+        return response.status, response.read().decode(errors="replace")
+
+
+def cmd_upload(args):
+    files = sorted(p for p in Path(args.corpus).iterdir() if p.is_file())
+    if not files:
+        print(f"No files in {args.corpus}")
+        return 1
+
+    for path in files:
+        status, text = upload_file(args.host, path)
+        print(f"{path.name}: HTTP {status} {text.strip()[:80]}")
+        # 给设备留出写入和校验的时间
+        time.sleep(0.5)
+    return 0
+
+
+def git_revision():
+    try:
+        rev = subprocess.run(["git", "rev-parse", "--short", "HEAD"],
+                             capture_output=True, text=True, check=True).stdout.strip()
+        dirty = subprocess.run(["git", "status", "--porcelain", "--untracked-files=no"],
+                               capture_output=True, text=True, check=True).stdout.strip()
+        return rev + ("-dirty" if dirty else "")
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def cmd_capture(args):
+    try:
+        import serial
+    except ImportError:
+        print("pyserial is required: pip install pyserial")
+        return 1
+
+    revision = git_revision()
+    report = {"revision": revision, "captured_at": time.strftime("%Y-%m-%dT%H:%M:%S"),
+              "meta": None, "summary": None, "results": []}
+
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        if not args.no_reset:
+            # 通过RTS拉低EN复位芯片（DTR保持高电平，避免进入下载模式）
+            port.dtr = False
+            port.rts = True
+            time.sleep(0.1)
+            port.rts = False
+
+        deadline = time.time() + args.timeout
+        while time.time() < deadline:
+            line = port.readline().decode(errors="replace").strip()
+            if not line:
+                continue
+            if args.verbose:
+                print(line)
+            if line.startswith("BENCH_BEGIN "):
+                report["meta"] = json.loads(line[len("BENCH_BEGIN "):])
+                print(f"Benchmark started: {report['meta']}")
+            elif line.startswith("BENCH "):
+                entry = json.loads(line[len("BENCH "):])
+                report["results"].append(entry)
+                print(f"  {entry['file']:<28} {entry['mode']:<12} "
+                      f"{entry['wall_min_us'] / 1000:8.1f} ms  {'ok' if entry['ok'] else 'FAIL'}")
+            elif line.startswith("BENCH_END "):
+                report["summary"] = json.loads(line[len("BENCH_END "):])
+                break
+        else:
+            print("Timed out waiting for BENCH_END")
+            return 1
+
+    output = Path(args.output) if args.output else Path("bench/results") / f"{revision}.json"
+    output.parent.mkdir(parents=True, exist_ok=True)
+    output.write_text(json.dumps(report, indent=2, ensure_ascii=False))
+    print(f"Saved {len(report['results'])} results to {output}")
+    return 0
+
+
+def case_key(entry):
+    # 用文件内容CRC而不是文件名匹配，上传时文件名可能被加上时间戳
+    return (entry["file_crc"], entry["mode"])
+
+
+def cmd_compare(args):
+    base = json.loads(Path(args.base).read_text())
+    new = json.loads(Path(args.new).read_text())
+    base_cases = {case_key(e): e for e in base["results"]}
+
+    print(f"Base: {base.get('revision')}  New: {new.get('revision')}")
+    print(f"{'file':<28} {'mode':<12} {'base ms':>9} {'new ms':>9} {'delta':>8} "
+          f"{'bytes':>8} {'txn':>6} {'heap':>7}  output")
+
+    regressions = 0
+    total_base = total_new = 0
+    for entry in new["results"]:
+        old = base_cases.get(case_key(entry))
+        if old is None:
+            print(f"{entry['file']:<28} {entry['mode']:<12} (no baseline)")
+            continue
+
+        b_ms = old["wall_min_us"] / 1000
+        n_ms = entry["wall_min_us"] / 1000
+        total_base += b_ms
+        total_new += n_ms
+        delta = (n_ms - b_ms) / b_ms * 100 if b_ms else 0.0
+        if delta > args.threshold:
+            regressions += 1
+
+        output = "same" if entry["checksum"] == old["checksum"] else "CHANGED"
+        if entry["ok"] != old["ok"]:
+            output = "ok->fail" if old["ok"] else "fail->ok"
+
+        print(f"{entry['file']:<28} {entry['mode']:<12} {b_ms:9.1f} {n_ms:9.1f} {delta:+7.1f}% "
+              f"{entry['bytes'] - old['bytes']:+8d} {entry['transactions'] - old['transactions']:+6d} "
+              f"{entry['peak_heap'] - old['peak_heap']:+7d}  {output}")
+
+    if total_base:
+        print(f"\nTotal: {total_base:.1f} ms -> {total_new:.1f} ms "
+              f"({(total_new - total_base) / total_base * 100:+.1f}%)")
+    if regressions:
+        print(f"{regressions} case(s) slower than +{args.threshold:.0f}%")
+    return 1 if regressions and args.fail_on_regression else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Little Gallery decode pipeline benchmark")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("corpus", help="generate the benchmark corpus")
+    p.add_argument("output", nargs="?", default="bench/corpus")
+    p.add_argument("--force", action="store_true", help="regenerate existing files")
+    p.set_defaults(func=cmd_corpus)
+
+    p = sub.add_parser("upload", help="upload the corpus to a device")
+    p.add_argument("host", help="device host, e.g. littlegallery.local")
+    p.add_argument("corpus", nargs="?", default="bench/corpus")
+    p.set_defaults(func=cmd_upload)
+
+    p = sub.add_parser("capture", help="reset the device and capture benchmark output")
+    p.add_argument("port", help="serial port, e.g. /dev/ttyUSB0 or COM3")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--timeout", type=int, default=600, help="seconds to wait for BENCH_END")
+    p.add_argument("--output", help="result file (default bench/results/<git rev>.json)")
+    p.add_argument("--no-reset", action="store_true", help="do not reset the device via RTS")
+    p.add_argument("--verbose", action="store_true", help="echo all serial output")
+    p.set_defaults(func=cmd_capture)
+
+    p = sub.add_parser("compare", help="compare two result files")
+    p.add_argument("base")
+    p.add_argument("new")
+    p.add_argument("--threshold", type=float, default=5.0, help="regression threshold in percent")
+    p.add_argument("--fail-on-regression", action="store_true")
+    p.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
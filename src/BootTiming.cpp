@@ -0,0 +1,51 @@
+#include "BootTiming.h"
+
+namespace Boot
+{
+  struct Phase
+  {
+    const char* name;
+    uint32_t micros;
+  };
+
+  static Phase phases[BOOT_MAX_PHASES];
+  static uint8_t phaseCount = 0;
+
+  void mark(const char* phase)
+  {
+    uint32_t now = micros();
+    if (phaseCount < BOOT_MAX_PHASES) {
+      phases[phaseCount++] = {phase, now};
+    }
+    Serial.printf("[boot] %s at %lu ms\n", phase, (unsigned long)(now / 1000));
+  }
+
+  int32_t phaseMillis(const char* phase)
+  {
+    for (uint8_t i = 0; i < phaseCount; i++) {
+      if (strcmp(phases[i].name, phase) == 0) {
+        return phases[i].micros / 1000;
+      }
+    }
+    return -1;
+  }
+
+  void printSummary()
+  {
+    uint32_t previous = 0;
+    Serial.println("Boot phases (ms since power-on / phase duration):");
+    for (uint8_t i = 0; i < phaseCount; i++) {
+      Serial.printf("  %-12s %6lu %6lu\n", phases[i].name,
+                    (unsigned long)(phases[i].micros / 1000),
+                    (unsigned long)((phases[i].micros - previous) / 1000));
+      previous = phases[i].micros;
+    }
+  }
+
+  void addToJson(JsonObject obj)
+  {
+    for (uint8_t i = 0; i < phaseCount; i++) {
+      obj[phases[i].name] = phases[i].micros / 1000;
+    }
+  }
+}
@@ -0,0 +1,324 @@
+#include "ColorConvert.h"
+#include <string.h>
+
+#if defined(COLOR_CONVERT_SSE2) || defined(COLOR_CONVERT_AVX2)
+#include <immintrin.h>
+#elif defined(COLOR_CONVERT_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace Color
+{
+  // ==================== 逐像素参考实现 ====================
+
+  namespace Scalar
+  {
+    void bgr888ToRgb565(const uint8_t* src, uint16_t* dst, size_t count)
+    {
+      for (size_t i = 0; i < count; i++, src += 3) {
+        dst[i] = rgb565(src[2], src[1], src[0]);
+      }
+    }
+
+    void xrgb8888ToRgb565(const uint32_t* src, uint16_t* dst, size_t count)
+    {
+      for (size_t i = 0; i < count; i++) {
+        uint32_t p = src[i];
+        dst[i] = rgb565((uint8_t)(p >> 16), (uint8_t)(p >> 8), (uint8_t)p);
+      }
+    }
+
+    void swapBytes565(const uint16_t* src, uint16_t* dst, size_t count)
+    {
+      for (size_t i = 0; i < count; i++) {
+        dst[i] = swap16(src[i]);
+      }
+    }
+  }
+
+  // ==================== 32位SWAR ====================
+  // RV32 没有SIMD，但按字读写本身就省掉了大部分访存：24位像素每4个读3个字
+  // （逐字节需要12次读），输出每2个像素写1个字。字内各像素的分量位置固定，
+  // 每个分量只需一次移位和一次掩码。字节序交换在一个字内同时处理两个像素。
+  // 以下按小端布局推导（ESP32-C3、x86、ARM均为小端），SIMD实现的尾部也使用这里的函数。
+
+  static inline bool isAligned4(const void* p)
+  {
+    return ((uintptr_t)p & 3) == 0;
+  }
+
+  // 已对齐的按字读写；经 memcpy 避免违反严格别名规则，编译器生成单条 lw/sw
+  static inline uint32_t load32(const void* p)
+  {
+    uint32_t value;
+    memcpy(&value, __builtin_assume_aligned(p, 4), sizeof(value));
+    return value;
+  }
+
+  static inline void store32(void* p, uint32_t value)
+  {
+    memcpy(__builtin_assume_aligned(p, 4), &value, sizeof(value));
+  }
+
+  // 一个字内低24位为 B,G,R 的像素
+  static inline uint32_t packBGR(uint32_t w)
+  {
+    return ((w >> 8) & 0xF800) | ((w >> 5) & 0x07E0) | ((w >> 3) & 0x001F);
+  }
+
+  // 输出两个像素：dst 按4字节对齐时写一个字，否则写两个半字（每行只判断一次）
+  template <bool DstAligned>
+  static inline void storePair(uint16_t* dst, uint32_t lo, uint32_t hi)
+  {
+    if (DstAligned) {
+      store32(dst, lo | (hi << 16));
+    } else {
+      dst[0] = (uint16_t)lo;
+      dst[1] = (uint16_t)hi;
+    }
+  }
+
+  // src 已按4字节对齐，每次4个像素：
+  //   w0 = B0 G0 R0 B1   w1 = G1 R1 B2 G2   w2 = R2 B3 G3 R3
+  template <bool DstAligned>
+  static size_t bgr888Words(const uint8_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4, src += 12, dst += 4) {
+      uint32_t w0 = load32(src);
+      uint32_t w1 = load32(src + 4);
+      uint32_t w2 = load32(src + 8);
+
+      uint32_t p0 = packBGR(w0);
+      uint32_t p1 = (w1 & 0xF800) | ((w1 << 3) & 0x07E0) | (w0 >> 27);
+      uint32_t p2 = ((w2 << 8) & 0xF800) | ((w1 >> 21) & 0x07E0) | ((w1 >> 19) & 0x001F);
+      uint32_t p3 = packBGR(w2 >> 8);
+
+      storePair<DstAligned>(dst, p0, p1);
+      storePair<DstAligned>(dst + 2, p2, p3);
+    }
+    return i;
+  }
+
+  static void bgr888Swar(const uint8_t* src, uint16_t* dst, size_t count)
+  {
+    // 每像素3字节，最多3个像素后 src 到达字边界
+    while (count > 0 && !isAligned4(src)) {
+      *dst++ = rgb565(src[2], src[1], src[0]);
+      src += 3;
+      count--;
+    }
+
+    size_t done = isAligned4(dst) ? bgr888Words<true>(src, dst, count)
+                                  : bgr888Words<false>(src, dst, count);
+    Scalar::bgr888ToRgb565(src + done * 3, dst + done, count - done);
+  }
+
+  static void xrgb8888Swar(const uint32_t* src, uint16_t* dst, size_t count)
+  {
+    if (count > 0 && !isAligned4(dst)) {
+      *dst++ = (uint16_t)packBGR(*src++);
+      count--;
+    }
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+      store32(dst + i, packBGR(src[i]) | (packBGR(src[i + 1]) << 16));
+    }
+    Scalar::xrgb8888ToRgb565(src + i, dst + i, count - i);
+  }
+
+  static void swapSwar(const uint16_t* src, uint16_t* dst, size_t count)
+  {
+    // 两端对齐方式不同时无法按字处理
+    if (isAligned4(src) != isAligned4(dst)) {
+      Scalar::swapBytes565(src, dst, count);
+      return;
+    }
+    if (count > 0 && !isAligned4(src)) {
+      *dst++ = swap16(*src++);
+      count--;
+    }
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+      uint32_t w = load32(src + i);
+      store32(dst + i, ((w & 0x00FF00FF) << 8) | ((w >> 8) & 0x00FF00FF));
+    }
+    Scalar::swapBytes565(src + i, dst + i, count - i);
+  }
+
+#if defined(COLOR_CONVERT_SSE2) || defined(COLOR_CONVERT_AVX2)
+  // ==================== x86 SSE2 / AVX2 ====================
+
+  // 4个 0x00RRGGBB → 4个RGB565（仍在32位通道中）
+  static inline __m128i pack565x4(__m128i v)
+  {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(v, 8), _mm_set1_epi32(0xF800));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(v, 5), _mm_set1_epi32(0x07E0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(v, 3), _mm_set1_epi32(0x001F));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+  }
+
+  // SSE2 没有无符号32→16打包：先符号扩展低16位，有符号打包就不会饱和
+  static inline __m128i narrow565x8(__m128i lo, __m128i hi)
+  {
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+  }
+
+#if defined(__SSSE3__)
+  // 12字节（4个BGR像素）展开为4个 0x00RRGGBB
+  static inline __m128i expandBGR(const uint8_t* src)
+  {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffle);
+  }
+#endif
+
+#if defined(COLOR_CONVERT_AVX2)
+  // 8个 0x00RRGGBB → 8个RGB565（仍在32位通道中）
+  static inline __m256i pack565x8(__m256i v)
+  {
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(v, 8), _mm256_set1_epi32(0xF800));
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 5), _mm256_set1_epi32(0x07E0));
+    __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 3), _mm256_set1_epi32(0x001F));
+    return _mm256_or_si256(_mm256_or_si256(r, g), b);
+  }
+
+  // 打包按128位通道交错，再按64位重排回顺序
+  static inline __m256i narrow565x16(__m256i lo, __m256i hi)
+  {
+    return _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+  }
+#endif
+
+  static void bgr888Simd(const uint8_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+#if defined(COLOR_CONVERT_AVX2)
+    // 每次16像素（48字节），最后一次16字节读取越过4字节，需多留余量
+    for (; i + 18 <= count; i += 16) {
+      const uint8_t* p = src + i * 3;
+      __m256i a = _mm256_set_m128i(expandBGR(p + 12), expandBGR(p));
+      __m256i b = _mm256_set_m128i(expandBGR(p + 36), expandBGR(p + 24));
+      _mm256_storeu_si256((__m256i*)(dst + i), narrow565x16(pack565x8(a), pack565x8(b)));
+    }
+#elif defined(__SSSE3__)
+    for (; i + 10 <= count; i += 8) {
+      const uint8_t* p = src + i * 3;
+      __m128i lo = pack565x4(expandBGR(p));
+      __m128i hi = pack565x4(expandBGR(p + 12));
+      _mm_storeu_si128((__m128i*)(dst + i), narrow565x8(lo, hi));
+    }
+#endif
+    // 只有SSE2时没有字节重排指令，24位像素走SWAR
+    bgr888Swar(src + i * 3, dst + i, count - i);
+  }
+
+  static void xrgb8888Simd(const uint32_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+#if defined(COLOR_CONVERT_AVX2)
+    for (; i + 16 <= count; i += 16) {
+      __m256i lo = pack565x8(_mm256_loadu_si256((const __m256i*)(src + i)));
+      __m256i hi = pack565x8(_mm256_loadu_si256((const __m256i*)(src + i + 8)));
+      _mm256_storeu_si256((__m256i*)(dst + i), narrow565x16(lo, hi));
+    }
+#endif
+    for (; i + 8 <= count; i += 8) {
+      __m128i lo = pack565x4(_mm_loadu_si128((const __m128i*)(src + i)));
+      __m128i hi = pack565x4(_mm_loadu_si128((const __m128i*)(src + i + 4)));
+      _mm_storeu_si128((__m128i*)(dst + i), narrow565x8(lo, hi));
+    }
+    xrgb8888Swar(src + i, dst + i, count - i);
+  }
+
+  static void swapSimd(const uint16_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+#if defined(COLOR_CONVERT_AVX2)
+    for (; i + 16 <= count; i += 16) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+      _mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8)));
+    }
+#endif
+    for (; i + 8 <= count; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+      _mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+    swapSwar(src + i, dst + i, count - i);
+  }
+
+#elif defined(COLOR_CONVERT_NEON)
+  // ==================== ARM NEON ====================
+
+  // 8位分量放到16位高字节，再按 565 依次右移插入
+  static inline uint16x8_t pack565x8(uint8x8_t r, uint8x8_t g, uint8x8_t b)
+  {
+    uint16x8_t out = vshll_n_u8(r, 8);
+    out = vsriq_n_u16(out, vshll_n_u8(g, 8), 5);
+    return vsriq_n_u16(out, vshll_n_u8(b, 8), 11);
+  }
+
+  static void bgr888Simd(const uint8_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+      uint8x16x3_t bgr = vld3q_u8(src + i * 3);
+      vst1q_u16(dst + i, pack565x8(vget_low_u8(bgr.val[2]), vget_low_u8(bgr.val[1]), vget_low_u8(bgr.val[0])));
+      vst1q_u16(dst + i + 8, pack565x8(vget_high_u8(bgr.val[2]), vget_high_u8(bgr.val[1]), vget_high_u8(bgr.val[0])));
+    }
+    bgr888Swar(src + i * 3, dst + i, count - i);
+  }
+
+  static void xrgb8888Simd(const uint32_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+      uint8x16x4_t bgra = vld4q_u8((const uint8_t*)(src + i));
+      vst1q_u16(dst + i, pack565x8(vget_low_u8(bgra.val[2]), vget_low_u8(bgra.val[1]), vget_low_u8(bgra.val[0])));
+      vst1q_u16(dst + i + 8, pack565x8(vget_high_u8(bgra.val[2]), vget_high_u8(bgra.val[1]), vget_high_u8(bgra.val[0])));
+    }
+    xrgb8888Swar(src + i, dst + i, count - i);
+  }
+
+  static void swapSimd(const uint16_t* src, uint16_t* dst, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+      uint8x16_t v = vld1q_u8((const uint8_t*)(src + i));
+      vst1q_u8((uint8_t*)(dst + i), vrev16q_u8(v));
+    }
+    swapSwar(src + i, dst + i, count - i);
+  }
+#endif
+
+  // ==================== 编译期分派 ====================
+
+#if defined(COLOR_CONVERT_SWAR)
+  void bgr888ToRgb565(const uint8_t* src, uint16_t* dst, size_t count) { bgr888Swar(src, dst, count); }
+  void xrgb8888ToRgb565(const uint32_t* src, uint16_t* dst, size_t count) { xrgb8888Swar(src, dst, count); }
+  void swapBytes565(const uint16_t* src, uint16_t* dst, size_t count) { swapSwar(src, dst, count); }
+#else
+  void bgr888ToRgb565(const uint8_t* src, uint16_t* dst, size_t count) { bgr888Simd(src, dst, count); }
+  void xrgb8888ToRgb565(const uint32_t* src, uint16_t* dst, size_t count) { xrgb8888Simd(src, dst, count); }
+  void swapBytes565(const uint16_t* src, uint16_t* dst, size_t count) { swapSimd(src, dst, count); }
+#endif
+
+  const char* kernelName()
+  {
+#if defined(COLOR_CONVERT_AVX2)
+    return "avx2";
+#elif defined(COLOR_CONVERT_SSE2) && defined(__SSSE3__)
+    return "ssse3";
+#elif defined(COLOR_CONVERT_SSE2)
+    return "sse2";
+#elif defined(COLOR_CONVERT_NEON)
+    return "neon";
+#else
+    return "swar32";
+#endif
+  }
+}
@@ -0,0 +1,456 @@
+#include "ContentIndex.h"
+#include <esp_rom_crc.h>
+
+namespace Dedup
+{
+  ContentIndex contentIndex;
+
+  // ==================== 索引文件格式 ====================
+  // 文件头 + fileCount 条文件记录 + aliasCount 条别名记录，文件名按定长存放
+
+  static const uint32_t INDEX_MAGIC = 0x58444943; // "CIDX"
+  static const uint8_t INDEX_VERSION = 1;
+
+  struct IndexHeader
+  {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t fileCount;
+    uint8_t aliasCount;
+    uint8_t reserved;
+  } __attribute__((packed));
+
+  struct StoredFile
+  {
+    char name[MAX_FILENAME_LENGTH];
+    uint32_t size;
+    uint32_t crc;
+  } __attribute__((packed));
+
+  struct StoredAlias
+  {
+    char alias[MAX_FILENAME_LENGTH];
+    char target[MAX_FILENAME_LENGTH];
+  } __attribute__((packed));
+
+  static void copyName(char* dst, const ImageName& name)
+  {
+    memset(dst, 0, MAX_FILENAME_LENGTH);
+    memcpy(dst, name.c_str(), name.length());
+  }
+
+  static const char* baseName(const char* path)
+  {
+    return (path && path[0] == '/') ? path + 1 : path;
+  }
+
+  uint32_t computeFileCrc(File& file)
+  {
+    uint8_t buffer[512];
+    uint32_t crc = 0;
+    size_t n;
+
+    file.seek(0);
+    while ((n = file.read(buffer, sizeof(buffer))) > 0) {
+      crc = esp_rom_crc32_le(crc, buffer, n);
+    }
+    file.seek(0);
+    return crc;
+  }
+
+  // 逐字节比较两个文件，排除CRC32碰撞
+  static bool sameContent(File& a, File& b)
+  {
+    uint8_t bufferA[256];
+    uint8_t bufferB[256];
+
+    a.seek(0);
+    b.seek(0);
+    for (;;) {
+      size_t n = a.read(bufferA, sizeof(bufferA));
+      if (b.read(bufferB, n) != n || memcmp(bufferA, bufferB, n) != 0) {
+        return false;
+      }
+      if (n == 0) {
+        return true;
+      }
+    }
+  }
+
+  // ==================== ContentIndex 实现 ====================
+
+  void ContentIndex::lock()
+  {
+    if (mutex) {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+  }
+
+  void ContentIndex::unlock()
+  {
+    if (mutex) {
+      xSemaphoreGive(mutex);
+    }
+  }
+
+  void ContentIndex::begin()
+  {
+    if (!mutex) {
+      mutex = xSemaphoreCreateMutex();
+    }
+
+    lock();
+    fileCount = 0;
+    aliasTotal = 0;
+    if (!load()) {
+      Serial.println("Content index not found, starting empty");
+    }
+
+    // 丢弃文件已不存在的记录（例如断电发生在删除文件和保存索引之间）
+    bool changed = false;
+    for (int i = fileCount - 1; i >= 0; i--) {
+      if (!LittleFS.exists(makeImagePath(files[i].name.c_str()).c_str())) {
+        removeFileRecord(i);
+        changed = true;
+      }
+    }
+    for (int i = aliasTotal - 1; i >= 0; i--) {
+      if (findFile(aliases[i].target.c_str()) < 0) {
+        removeAliasRecord(i);
+        changed = true;
+      }
+    }
+    if (changed) {
+      save();
+    }
+
+    Serial.printf("Content index: %u file(s), %u alias(es)\n", fileCount, aliasTotal);
+    unlock();
+  }
+
+  bool ContentIndex::load()
+  {
+    File file = LittleFS.open(CONTENT_INDEX_PATH, "r");
+    if (!file) {
+      return false;
+    }
+
+    IndexHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != INDEX_MAGIC || header.version != INDEX_VERSION ||
+        header.fileCount > MAX_IMAGES || header.aliasCount > DEDUP_MAX_ALIASES) {
+      Serial.println("Content index corrupt, ignoring");
+      file.close();
+      return false;
+    }
+
+    for (uint8_t i = 0; i < header.fileCount; i++) {
+      StoredFile stored;
+      if (file.read((uint8_t*)&stored, sizeof(stored)) != sizeof(stored)) break;
+      FileRecord& record = files[fileCount++];
+      record.name.assign(stored.name, strnlen(stored.name, MAX_FILENAME_LENGTH));
+      record.size = stored.size;
+      record.crc = stored.crc;
+    }
+    for (uint8_t i = 0; i < header.aliasCount; i++) {
+      StoredAlias stored;
+      if (file.read((uint8_t*)&stored, sizeof(stored)) != sizeof(stored)) break;
+      AliasRecord& record = aliases[aliasTotal++];
+      record.alias.assign(stored.alias, strnlen(stored.alias, MAX_FILENAME_LENGTH));
+      record.target.assign(stored.target, strnlen(stored.target, MAX_FILENAME_LENGTH));
+    }
+
+    file.close();
+    return true;
+  }
+
+  bool ContentIndex::save()
+  {
+    // 先写临时文件再重命名，断电时保留旧索引
+    static const char* tempPath = CONTENT_INDEX_PATH ".tmp";
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) {
+      Serial.println("Failed to write content index");
+      return false;
+    }
+
+    IndexHeader header = {INDEX_MAGIC, INDEX_VERSION, fileCount, aliasTotal, 0};
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+    for (uint8_t i = 0; ok && i < fileCount; i++) {
+      StoredFile stored;
+      copyName(stored.name, files[i].name);
+      stored.size = files[i].size;
+      stored.crc = files[i].crc;
+      ok = file.write((const uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+    }
+    for (uint8_t i = 0; ok && i < aliasTotal; i++) {
+      StoredAlias stored;
+      copyName(stored.alias, aliases[i].alias);
+      copyName(stored.target, aliases[i].target);
+      ok = file.write((const uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+    }
+    file.close();
+
+    if (!ok || !LittleFS.rename(tempPath, CONTENT_INDEX_PATH)) {
+      Serial.println("Failed to write content index");
+      LittleFS.remove(tempPath);
+      return false;
+    }
+    return true;
+  }
+
+  int ContentIndex::findFile(const char* name) const
+  {
+    for (uint8_t i = 0; i < fileCount; i++) {
+      if (files[i].name == name) return i;
+    }
+    return -1;
+  }
+
+  int ContentIndex::findAlias(const char* alias) const
+  {
+    for (uint8_t i = 0; i < aliasTotal; i++) {
+      if (aliases[i].alias == alias) return i;
+    }
+    return -1;
+  }
+
+  void ContentIndex::removeFileRecord(int index)
+  {
+    files[index] = files[--fileCount];
+  }
+
+  void ContentIndex::removeAliasRecord(int index)
+  {
+    aliases[index] = aliases[--aliasTotal];
+  }
+
+  void ContentIndex::indexUnknownFiles(uint32_t size)
+  {
+    File root = LittleFS.open("/");
+    if (!root) {
+      return;
+    }
+
+    bool added = false;
+    File file = root.openNextFile();
+    while (file && fileCount < MAX_IMAGES) {
+      const char* name = file.name();
+      if (!file.isDirectory() && file.size() == size && !isHiddenFile(name) &&
+          hasImageExtension(name) && strlen(name) <= ImageName::capacity() && findFile(name) < 0) {
+        FileRecord& record = files[fileCount++];
+        record.name.assign(name);
+        record.size = size;
+        record.crc = computeFileCrc(file);
+        added = true;
+      }
+      file = root.openNextFile();
+    }
+    root.close();
+
+    if (added) {
+      save();
+    }
+  }
+
+  bool ContentIndex::findDuplicate(const char* path, uint32_t size, uint32_t crc, ImageName& target)
+  {
+    const char* self = baseName(path);
+    bool found = false;
+
+    lock();
+    indexUnknownFiles(size);
+
+    for (uint8_t i = 0; i < fileCount && !found; i++) {
+      FileRecord& record = files[i];
+      if (record.size != size || record.crc != crc || record.name == self) {
+        continue;
+      }
+
+      File stored = LittleFS.open(makeImagePath(record.name.c_str()).c_str(), "r");
+      if (!stored) {
+        continue;
+      }
+      // 已被入库转码替换的文件原始字节不在了，无法确认内容相同，按新文件保存
+      if (stored.size() == size) {
+        File candidate = LittleFS.open(path, "r");
+        found = candidate && sameContent(stored, candidate);
+        candidate.close();
+      }
+      stored.close();
+
+      if (found) {
+        target = record.name;
+      }
+    }
+
+    unlock();
+    return found;
+  }
+
+  void ContentIndex::addFile(const char* name, uint32_t size, uint32_t crc)
+  {
+    lock();
+    int index = findFile(name);
+    if (index < 0 && fileCount < MAX_IMAGES) {
+      index = fileCount++;
+    }
+    if (index >= 0) {
+      files[index].name.assign(name);
+      files[index].size = size;
+      files[index].crc = crc;
+      save();
+    }
+    unlock();
+  }
+
+  bool ContentIndex::addAlias(const char* alias, const char* target)
+  {
+    lock();
+    bool ok = aliasTotal < DEDUP_MAX_ALIASES && findFile(target) >= 0 && findAlias(alias) < 0;
+    if (ok) {
+      aliases[aliasTotal].alias.assign(alias);
+      aliases[aliasTotal].target.assign(target);
+      aliasTotal++;
+      save();
+    }
+    unlock();
+    return ok;
+  }
+
+  bool ContentIndex::convertToAlias(const char* name, const char* target)
+  {
+    lock();
+    int index = findFile(name);
+    bool ok = index >= 0 && aliasTotal < DEDUP_MAX_ALIASES && findFile(target) >= 0;
+    if (ok) {
+      removeFileRecord(index);
+      aliases[aliasTotal].alias.assign(name);
+      aliases[aliasTotal].target.assign(target);
+      aliasTotal++;
+      save();
+    }
+    unlock();
+    return ok;
+  }
+
+  void ContentIndex::renameFile(const char* from, const char* to)
+  {
+    lock();
+    int index = findFile(from);
+    if (index >= 0) {
+      files[index].name.assign(to);
+      for (uint8_t i = 0; i < aliasTotal; i++) {
+        if (aliases[i].target == from) {
+          aliases[i].target.assign(to);
+        }
+      }
+      save();
+    }
+    unlock();
+  }
+
+  bool ContentIndex::lookup(const char* name, uint32_t& size, uint32_t& crc)
+  {
+    lock();
+    int index = findFile(name);
+    if (index >= 0) {
+      size = files[index].size;
+      crc = files[index].crc;
+    }
+    unlock();
+    return index >= 0;
+  }
+
+  bool ContentIndex::hasContent(uint32_t size, uint32_t crc)
+  {
+    lock();
+    bool found = false;
+    for (uint8_t i = 0; i < fileCount && !found; i++) {
+      found = files[i].size == size && files[i].crc == crc;
+    }
+    unlock();
+    return found;
+  }
+
+  ReleaseResult ContentIndex::release(const char* name)
+  {
+    ReleaseResult result = ReleaseResult::NOT_FOUND;
+
+    lock();
+    int aliasIndex = findAlias(name);
+    if (aliasIndex >= 0) {
+      removeAliasRecord(aliasIndex);
+      result = ReleaseResult::ALIAS_REMOVED;
+    } else {
+      int fileIndex = findFile(name);
+      if (fileIndex >= 0) {
+        // 还有别名时只减少一个引用，文件保留
+        for (int i = aliasTotal - 1; i >= 0; i--) {
+          if (aliases[i].target == name) {
+            removeAliasRecord(i);
+            result = ReleaseResult::ALIAS_REMOVED;
+            break;
+          }
+        }
+        if (result == ReleaseResult::NOT_FOUND) {
+          removeFileRecord(fileIndex);
+          result = ReleaseResult::DELETE_FILE;
+        }
+      }
+    }
+    if (result != ReleaseResult::NOT_FOUND) {
+      save();
+    }
+    unlock();
+    return result;
+  }
+
+  void ContentIndex::removeAll(const char* name)
+  {
+    lock();
+    for (int i = aliasTotal - 1; i >= 0; i--) {
+      if (aliases[i].target == name) {
+        removeAliasRecord(i);
+      }
+    }
+    int index = findFile(name);
+    if (index >= 0) {
+      removeFileRecord(index);
+    }
+    save();
+    unlock();
+  }
+
+  uint8_t ContentIndex::refCount(const char* name)
+  {
+    lock();
+    uint8_t count = 0;
+    if (findFile(name) >= 0) {
+      count = 1;
+      for (uint8_t i = 0; i < aliasTotal; i++) {
+        if (aliases[i].target == name) count++;
+      }
+    }
+    unlock();
+    return count;
+  }
+
+  uint16_t ContentIndex::aliasCount()
+  {
+    return aliasTotal;
+  }
+
+  uint32_t ContentIndex::savedBytes()
+  {
+    lock();
+    uint32_t saved = 0;
+    for (uint8_t i = 0; i < aliasTotal; i++) {
+      int index = findFile(aliases[i].target.c_str());
+      if (index >= 0) saved += files[index].size;
+    }
+    unlock();
+    return saved;
+  }
+}
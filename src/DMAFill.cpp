@@ -0,0 +1,279 @@
+#include "DMAFill.h"
+#include <esp_heap_caps.h>
+#include <hal/spi_ll.h>
+
+namespace Display
+{
+  // Arduino的SPI对象在ESP32-C3上使用GPSPI2
+  static const spi_host_device_t DMA_FILL_HOST = SPI2_HOST;
+
+  // spi_bus_initialize 会复位GPSPI2，spi_bus_free 会关掉它的时钟（Arduino仍在使用），
+  // 所以总线只初始化一次、永不释放，切换驱动时新的实例直接挂载设备
+  static bool busInitialized = false;
+
+  // ==================== 寄存器上下文 ====================
+
+  static void saveRegisters(spi_dev_t *hw, SolidFillDMA::BusRegisters &regs)
+  {
+    regs.addr = hw->addr;
+    regs.ctrl = hw->ctrl.val;
+    regs.clock = hw->clock.val;
+    regs.user = hw->user.val;
+    regs.user1 = hw->user1.val;
+    regs.user2 = hw->user2.val;
+    regs.msDlen = hw->ms_dlen.val;
+    regs.misc = hw->misc.val;
+    regs.dinMode = hw->din_mode.val;
+    regs.dinNum = hw->din_num.val;
+    regs.doutMode = hw->dout_mode.val;
+    regs.dmaConf = hw->dma_conf.val;
+    regs.dmaIntEna = hw->dma_int_ena.val;
+    regs.slave = hw->slave.val;
+    regs.slave1 = hw->slave1.val;
+    regs.clkGate = hw->clk_gate.val;
+  }
+
+  static void loadRegisters(spi_dev_t *hw, const SolidFillDMA::BusRegisters &regs)
+  {
+    // 先恢复时钟门控和主从模式，再写其余配置
+    hw->clk_gate.val = regs.clkGate;
+    hw->slave.val = regs.slave;
+    hw->slave1.val = regs.slave1;
+    hw->addr = regs.addr;
+    hw->ctrl.val = regs.ctrl;
+    hw->clock.val = regs.clock;
+    hw->user.val = regs.user;
+    hw->user1.val = regs.user1;
+    hw->user2.val = regs.user2;
+    hw->ms_dlen.val = regs.msDlen;
+    hw->misc.val = regs.misc;
+    hw->din_mode.val = regs.dinMode;
+    hw->din_num.val = regs.dinNum;
+    hw->dout_mode.val = regs.doutMode;
+    hw->dma_conf.val = regs.dmaConf;
+    hw->dma_int_ena.val = regs.dmaIntEna;
+    // 清掉DMA事务留下的中断标志，再把配置同步到SPI时钟域
+    hw->dma_int_clr.val = UINT32_MAX;
+    spi_ll_apply_config(hw);
+  }
+
+  // DMA_CONF 的低两位是只读的FIFO空/满状态，DMA传输后会变，不参与比较
+  static const uint32_t DMA_CONF_STATUS_MASK = 0x3;
+
+  static bool registersMatch(spi_dev_t *hw, const SolidFillDMA::BusRegisters &regs)
+  {
+    SolidFillDMA::BusRegisters current;
+    saveRegisters(hw, current);
+    current.dmaConf &= ~DMA_CONF_STATUS_MASK;
+    SolidFillDMA::BusRegisters expected = regs;
+    expected.dmaConf &= ~DMA_CONF_STATUS_MASK;
+    return memcmp(&current, &expected, sizeof(expected)) == 0;
+  }
+
+  // ==================== SolidFillDMA 类实现 ====================
+
+  SolidFillDMA::SolidFillDMA()
+    : device(nullptr), pattern(nullptr), patternColor(0), patternValid(false),
+      deviceRegs()
+  {
+  }
+
+  SolidFillDMA::~SolidFillDMA()
+  {
+    end();
+  }
+
+  bool SolidFillDMA::begin(uint32_t frequency)
+  {
+    if (device) {
+      return true;
+    }
+
+    pattern = (uint16_t *)heap_caps_malloc(DMA_FILL_PATTERN_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+    if (!pattern) {
+      Serial.println("DMA fill: failed to allocate pattern buffer");
+      return false;
+    }
+
+    // 初始化前保存Arduino的寄存器：spi_bus_initialize 会复位整个外设
+    spi_dev_t *hw = SPI_LL_GET_HW(DMA_FILL_HOST);
+    BusRegisters arduinoRegs;
+    saveRegisters(hw, arduinoRegs);
+
+    if (!busInitialized) {
+      // 引脚已由Arduino SPI路由到GPSPI2，这里全部传-1，不改动GPIO矩阵
+      spi_bus_config_t busConfig = {};
+      busConfig.mosi_io_num = -1;
+      busConfig.miso_io_num = -1;
+      busConfig.sclk_io_num = -1;
+      busConfig.quadwp_io_num = -1;
+      busConfig.quadhd_io_num = -1;
+      busConfig.max_transfer_sz = DMA_FILL_PATTERN_PIXELS * sizeof(uint16_t);
+
+      esp_err_t err = spi_bus_initialize(DMA_FILL_HOST, &busConfig, SPI_DMA_CH_AUTO);
+      if (err != ESP_OK) {
+        Serial.printf("DMA fill: bus init failed (%d), using CPU fill\n", err);
+        loadRegisters(hw, arduinoRegs);
+        end();
+        return false;
+      }
+      busInitialized = true;
+    }
+
+    if (!addDevice(frequency) || !captureDeviceContext(arduinoRegs)) {
+      restoreArduinoBus(arduinoRegs);
+      end();
+      return false;
+    }
+
+    Serial.println("DMA fill enabled");
+    return true;
+  }
+
+  void SolidFillDMA::end()
+  {
+    // 只卸载设备，总线保持初始化（见 busInitialized）
+    if (device) {
+      spi_bus_remove_device(device);
+      device = nullptr;
+    }
+    if (pattern) {
+      heap_caps_free(pattern);
+      pattern = nullptr;
+    }
+    patternValid = false;
+  }
+
+  bool SolidFillDMA::addDevice(uint32_t frequency)
+  {
+    // CS由Adafruit驱动通过GPIO控制，这里不分配硬件CS
+    spi_device_interface_config_t deviceConfig = {};
+    deviceConfig.mode = 0;
+    deviceConfig.clock_speed_hz = frequency;
+    deviceConfig.spics_io_num = -1;
+    deviceConfig.queue_size = DMA_FILL_QUEUE_DEPTH;
+
+    esp_err_t err = spi_bus_add_device(DMA_FILL_HOST, &deviceConfig, &device);
+    if (err != ESP_OK) {
+      Serial.printf("DMA fill: add device failed (%d)\n", err);
+      device = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  bool SolidFillDMA::captureDeviceContext(const BusRegisters &arduinoRegs)
+  {
+    // 新设备第一次取得总线锁时spi_master写入设备配置（时钟、模式、CS时序），
+    // 之后认为配置仍在寄存器里不再重写，所以记下这份状态，每次 fill 时换入
+    spi_dev_t *hw = SPI_LL_GET_HW(DMA_FILL_HOST);
+    if (spi_device_acquire_bus(device, portMAX_DELAY) != ESP_OK) {
+      Serial.println("DMA fill: failed to acquire bus");
+      return false;
+    }
+    saveRegisters(hw, deviceRegs);
+    spi_device_release_bus(device);
+    return restoreArduinoBus(arduinoRegs);
+  }
+
+  bool SolidFillDMA::setFrequency(uint32_t frequency)
+  {
+    if (!busInitialized) {
+      return false;
+    }
+
+    if (device) {
+      spi_bus_remove_device(device);
+      device = nullptr;
+    }
+
+    BusRegisters arduinoRegs;
+    saveRegisters(SPI_LL_GET_HW(DMA_FILL_HOST), arduinoRegs);
+    if (!addDevice(frequency)) {
+      return false;
+    }
+    return captureDeviceContext(arduinoRegs);
+  }
+
+  uint32_t SolidFillDMA::fill(uint16_t color, uint32_t pixelCount)
+  {
+    if (!device || pixelCount == 0) {
+      return 0;
+    }
+
+    // 颜色变化时重建常量缓冲区（上一次填充已等待完成，可以安全改写）
+    if (!patternValid || patternColor != color) {
+      uint16_t swapped = (color >> 8) | (color << 8);
+      for (uint32_t i = 0; i < DMA_FILL_PATTERN_PIXELS; i++) {
+        pattern[i] = swapped;
+      }
+      patternColor = color;
+      patternValid = true;
+    }
+
+    // 换入spi_master的寄存器上下文；调用者持有Arduino的SPI锁，这里再持有spi_master的总线锁
+    spi_dev_t *hw = SPI_LL_GET_HW(DMA_FILL_HOST);
+    BusRegisters arduinoRegs;
+    saveRegisters(hw, arduinoRegs);
+    if (spi_device_acquire_bus(device, portMAX_DELAY) != ESP_OK) {
+      return 0;
+    }
+    loadRegisters(hw, deviceRegs);
+
+    uint32_t remaining = pixelCount;
+    uint8_t inFlight = 0;
+    uint8_t slot = 0;
+    bool ok = true;
+
+    while (remaining > 0 || inFlight > 0) {
+      // 队列未满时继续提交，所有事务指向同一块常量缓冲区
+      while (ok && remaining > 0 && inFlight < DMA_FILL_QUEUE_DEPTH) {
+        uint32_t chunk = remaining < DMA_FILL_PATTERN_PIXELS ? remaining : DMA_FILL_PATTERN_PIXELS;
+
+        spi_transaction_t &trans = transactions[slot];
+        memset(&trans, 0, sizeof(trans));
+        trans.length = chunk * 16;
+        trans.tx_buffer = pattern;
+
+        if (spi_device_queue_trans(device, &trans, portMAX_DELAY) != ESP_OK) {
+          ok = false;
+          break;
+        }
+
+        remaining -= chunk;
+        inFlight++;
+        slot = (slot + 1) % DMA_FILL_QUEUE_DEPTH;
+      }
+
+      if (inFlight == 0) {
+        break;
+      }
+
+      spi_transaction_t *done = nullptr;
+      spi_device_get_trans_result(device, &done, portMAX_DELAY);
+      inFlight--;
+    }
+
+    saveRegisters(hw, deviceRegs);
+    spi_device_release_bus(device);
+
+    // 换回失败时停用之后的DMA填充；已排队的事务都已完成，剩余像素由调用者用CPU补上
+    if (!restoreArduinoBus(arduinoRegs)) {
+      spi_bus_remove_device(device);
+      device = nullptr;
+    }
+    return pixelCount - remaining;
+  }
+
+  bool SolidFillDMA::restoreArduinoBus(const BusRegisters &arduinoRegs)
+  {
+    // 整组写回Arduino HAL的寄存器，不依赖下一次 beginTransaction 重写其中任何一项
+    spi_dev_t *hw = SPI_LL_GET_HW(DMA_FILL_HOST);
+    loadRegisters(hw, arduinoRegs);
+    if (!registersMatch(hw, arduinoRegs)) {
+      Serial.println("DMA fill: SPI registers not restored, falling back to CPU fill");
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,53 @@
+#include "DecodeArena.h"
+#include <esp_heap_caps.h>
+
+namespace Memory
+{
+  // 全局解码内存池实例
+  DecodeArena decodeArena;
+
+  // ==================== DecodeArena 类实现 ====================
+
+  DecodeArena::DecodeArena()
+    : offset(0), peak(0), failures(0)
+  {
+  }
+
+  void* DecodeArena::allocate(size_t size, size_t alignment)
+  {
+    size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+    if (size == 0 || aligned + size > DECODE_ARENA_SIZE) {
+      failures++;
+      Serial.printf("Decode arena exhausted: need %u bytes, %u free\n",
+                    (unsigned)size, (unsigned)(DECODE_ARENA_SIZE - offset));
+      return nullptr;
+    }
+
+    offset = aligned + size;
+    if (offset > peak) {
+      peak = offset;
+    }
+    return buffer + aligned;
+  }
+
+  void DecodeArena::release(size_t mark)
+  {
+    if (mark < offset) {
+      offset = mark;
+    }
+  }
+
+  // ==================== 堆状态监控 ====================
+
+  HeapStats getHeapStats()
+  {
+    HeapStats stats;
+    stats.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    stats.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    stats.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    stats.fragmentation = stats.freeHeap > 0
+      ? 100 - (uint8_t)((uint64_t)stats.largestFreeBlock * 100 / stats.freeHeap)
+      : 0;
+    return stats;
+  }
+}
@@ -2,16 +2,68 @@
 #include "ILI9341Driver.h"
 #include "ST7789Driver.h"
 #include <WiFi.h>
+#include <esp_heap_caps.h>
 
 namespace Display
 {
   // 全局显示管理器实例
   DisplayManager displayManager;
   
+  // ==================== 传输统计 ====================
+  
+  static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+  static const uint32_t FNV_PRIME = 16777619u;
+  
+  void DisplayDriverBase::resetTransferStats(bool detailed)
+  {
+    transferStats = {};
+    transferStats.checksum = FNV_OFFSET_BASIS;
+    transferStats.minFreeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    transferStats.detailed = detailed;
+  }
+  
+  void DisplayDriverBase::recordWindow(bool newTransaction, uint32_t pixelCount)
+  {
+    if (newTransaction) transferStats.transactions++;
+    transferStats.windows++;
+    transferStats.bytes += pixelCount * 2;
+    
+    if (transferStats.detailed) {
+      uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+      if (freeHeap < transferStats.minFreeHeap) {
+        transferStats.minFreeHeap = freeHeap;
+      }
+    }
+  }
+  
+  void DisplayDriverBase::recordPixels(const uint16_t* pixels, uint32_t count)
+  {
+    if (!transferStats.detailed) return;
+    
+    uint32_t hash = transferStats.checksum;
+    for (uint32_t i = 0; i < count; i++) {
+      hash = (hash ^ (pixels[i] & 0xFF)) * FNV_PRIME;
+      hash = (hash ^ (pixels[i] >> 8)) * FNV_PRIME;
+    }
+    transferStats.checksum = hash;
+  }
+  
+  void DisplayDriverBase::recordFill(uint16_t color, uint32_t count)
+  {
+    if (!transferStats.detailed) return;
+    
+    // 纯色填充按 (颜色, 像素数) 折叠，避免逐像素计算
+    uint32_t hash = transferStats.checksum;
+    hash = (hash ^ color) * FNV_PRIME;
+    hash = (hash ^ count) * FNV_PRIME;
+    transferStats.checksum = hash;
+  }
+  
   // ==================== DisplayManager 类实现 ====================
   
   DisplayManager::DisplayManager() 
-    : currentDriver(nullptr), currentDriverType(DRIVER_ILI9341), initialized(false)
+    : currentDriver(nullptr), currentDriverType(DRIVER_ILI9341), initialized(false),
+      staticPipelineEnabled(true)
   {
   }
   
@@ -155,6 +207,55 @@ namespace Display
     if (currentDriver) currentDriver->fillRect(x, y, w, h, color);
   }
   
+  void DisplayManager::beginFrame()
+  {
+    if (currentDriver) currentDriver->beginFrame();
+  }
+  
+  void DisplayManager::endFrame()
+  {
+    if (currentDriver) currentDriver->endFrame();
+  }
+  
+  void DisplayManager::pushImage(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* pixels)
+  {
+    if (currentDriver) currentDriver->pushImage(x, y, w, h, pixels);
+  }
+  
+  void DisplayManager::setSPIFrequency(uint32_t frequency)
+  {
+    if (currentDriver) currentDriver->setSPIFrequency(frequency);
+  }
+  
+  uint32_t DisplayManager::getSPIFrequency() const
+  {
+    if (currentDriver) return currentDriver->getSPIFrequency();
+    return 0;
+  }
+  
+  uint32_t DisplayManager::calibrateSPI(bool force)
+  {
+    if (currentDriver) return currentDriver->calibrateSPI(force);
+    return 0;
+  }
+  
+  bool DisplayManager::benchmarkFill(uint8_t iterations, FillBenchmarkResult& result)
+  {
+    if (currentDriver) return currentDriver->benchmarkFill(iterations, result);
+    return false;
+  }
+  
+  void DisplayManager::resetTransferStats(bool detailed)
+  {
+    if (currentDriver) currentDriver->resetTransferStats(detailed);
+  }
+  
+  TransferStats DisplayManager::getTransferStats() const
+  {
+    if (currentDriver) return currentDriver->getTransferStats();
+    return TransferStats();
+  }
+  
   void DisplayManager::displayText(const char* text, int16_t x, int16_t y, uint16_t color, uint8_t size)
   {
     if (currentDriver) currentDriver->displayText(text, x, y, color, size);
@@ -1,12 +1,20 @@
 #include "ILI9341Driver.h"
+#include "TextRenderer.h"
 #include <WiFi.h>
 
 namespace Display
 {
   // ==================== ILI9341Driver 类实现 ====================
   
+  const SPIBusConfig ILI9341Driver::spiConfig = {
+    TFT_SPI_SAFE_FREQUENCY,
+    ILI9341_SPI_MAX_FREQUENCY,
+    4
+  };
+  
   ILI9341Driver::ILI9341Driver() 
-    : tft(TFT_CS, TFT_DC, TFT_RST), initialized(false)
+    : tft(TFT_CS, TFT_DC, TFT_RST), initialized(false),
+      spiFrequency(TFT_SPI_SAFE_FREQUENCY)
   {
   }
   
@@ -27,7 +35,15 @@ namespace Display
     initializePins();
 
     // 开始初始化显示屏
-    tft.begin();
+    tft.begin(TFT_SPI_SAFE_FREQUENCY);
+    
+    // 设置SPI时钟（使用NVS中的校准结果或重新校准）
+    configureSPIClock();
+    
+    // 初始化DMA纯色填充（失败时清屏等操作回退到CPU路径）
+    if (TFT_DMA_FILL) {
+      dmaFill.begin(spiFrequency);
+    }
     
     // 设置默认配置
     setupDisplay();
@@ -52,6 +68,56 @@ namespace Display
     digitalWrite(TFT_RST, HIGH);
   }
   
+  void ILI9341Driver::configureSPIClock()
+  {
+    uint32_t frequency = 0;
+    if (SPICalibrator::loadFrequency(getDriverName(), frequency) &&
+        frequency <= spiConfig.maxFrequency) {
+      Serial.printf("Using stored SPI clock: %lu Hz\n", (unsigned long)frequency);
+      setSPIFrequency(frequency);
+    } else if (TFT_SPI_CALIBRATE) {
+      calibrateSPI(true);
+    } else {
+      setSPIFrequency(TFT_SPI_UNVERIFIED_FREQUENCY);
+    }
+  }
+  
+  uint32_t ILI9341Driver::calibrateSPI(bool force)
+  {
+    uint32_t frequency = 0;
+    if (!force && SPICalibrator::loadFrequency(getDriverName(), frequency)) {
+      return frequency;
+    }
+    
+    frequency = SPICalibrator::calibrate(tft, spiConfig, [](Adafruit_SPITFT& t, uint8_t index) {
+      return static_cast<Adafruit_ILI9341&>(t).readcommand8(ILI9341_RDDID, index);
+    });
+    
+    if (frequency != 0) {
+      SPICalibrator::saveFrequency(getDriverName(), frequency);
+    } else {
+      // 无法读回时不做持久化，使用未验证时钟（默认为基准时钟）
+      frequency = TFT_SPI_UNVERIFIED_FREQUENCY;
+    }
+    
+    setSPIFrequency(frequency);
+    return frequency;
+  }
+  
+  void ILI9341Driver::setSPIFrequency(uint32_t frequency)
+  {
+    if (frequency > spiConfig.maxFrequency) {
+      frequency = spiConfig.maxFrequency;
+    }
+    
+    spiFrequency = frequency;
+    tft.setSPISpeed(frequency);
+    if (dmaFill.isAvailable()) {
+      dmaFill.setFrequency(frequency);
+    }
+    Serial.printf("ILI9341 SPI clock: %lu Hz\n", (unsigned long)frequency);
+  }
+  
   void ILI9341Driver::setupDisplay()
   {
     // 设置默认方向
@@ -80,16 +146,6 @@ namespace Display
     // 这里暂时留空，可根据硬件配置实现
   }
   
-  void ILI9341Driver::clearScreen(uint16_t color)
-  {
-    tft.fillScreen(color);
-  }
-  
-  void ILI9341Driver::fillScreen(uint16_t color)
-  {
-    tft.fillScreen(color);
-  }
-  
   void ILI9341Driver::drawPixel(int16_t x, int16_t y, uint16_t color)
   {
     tft.drawPixel(x, y, color);
@@ -105,13 +161,14 @@ namespace Display
     tft.drawRect(x, y, w, h, color);
   }
   
-  void ILI9341Driver::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
-  {
-    tft.fillRect(x, y, w, h, color);
-  }
-  
   void ILI9341Driver::displayText(const char* text, int16_t x, int16_t y, uint16_t color, uint8_t size)
   {
+    // 常用字号走字形缓存；与Adafruit_GFX一样透明绘制，不覆盖文字周围的图片
+    if (textRenderer.supportsSize(size)) {
+      textRenderer.drawText(*this, text, x, y, color, size);
+      return;
+    }
+    
     tft.setCursor(x, y);
     tft.setTextColor(color);
     tft.setTextSize(size);
@@ -120,10 +177,15 @@ namespace Display
   
   void ILI9341Driver::displayCenteredText(const char* text, int16_t y, uint16_t color, uint8_t size)
   {
-    tft.setTextSize(size);
-    int16_t x1, y1;
-    uint16_t w, h;
-    tft.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
+    uint16_t w;
+    if (textRenderer.supportsSize(size)) {
+      w = TextRenderer::measure(text, strlen(text), size);
+    } else {
+      tft.setTextSize(size);
+      int16_t x1, y1;
+      uint16_t h;
+      tft.getTextBounds(text, 0, 0, &x1, &y1, &w, &h);
+    }
     
     int16_t x = (getWidth() - w) / 2;
     displayText(text, x, y, color, size);
@@ -131,32 +193,26 @@ namespace Display
   
   void ILI9341Driver::displayMultilineText(const char* text, int16_t x, int16_t y, uint16_t color, uint8_t size)
   {
-    tft.setCursor(x, y);
+    if (textRenderer.supportsSize(size)) {
+      textRenderer.drawText(*this, text, x, y, color, size);
+      return;
+    }
+    
     tft.setTextColor(color);
     tft.setTextSize(size);
     
-    String str = String(text);
     int lineHeight = 8 * size;
     int currentY = y;
+    tft.setCursor(x, currentY);
     
-    int start = 0;
-    int end = str.indexOf('\n');
-    
-    while (end != -1) {
-      String line = str.substring(start, end);
-      tft.setCursor(x, currentY);
-      tft.print(line);
-      currentY += lineHeight;
-      
-      start = end + 1;
-      end = str.indexOf('\n', start);
-    }
-    
-    // 打印最后一行
-    if (start < str.length()) {
-      String line = str.substring(start);
-      tft.setCursor(x, currentY);
-      tft.print(line);
+    // 逐字符输出，遇到换行回到起始x
+    for (const char* p = text; *p; p++) {
+      if (*p == '\n') {
+        currentY += lineHeight;
+        tft.setCursor(x, currentY);
+      } else {
+        tft.write(*p);
+      }
     }
   }
   
@@ -197,8 +253,7 @@ namespace Display
     displayCenteredText(ipAddress.c_str(), 105, ILI9341_CYAN, 1);
 
     displayCenteredText("mDNS Address:", 125, ILI9341_WHITE, 1);
-    String mdnsAddr = String(MDNS_HOSTNAME) + ".local";
-    displayCenteredText(mdnsAddr.c_str(), 140, ILI9341_MAGENTA, 1);
+    displayCenteredText(MDNS_HOSTNAME ".local", 140, ILI9341_MAGENTA, 1);
 
     displayCenteredText("Ready to display images!", 170, ILI9341_YELLOW, 1);
   }
@@ -222,8 +277,10 @@ namespace Display
     // 在屏幕底部显示图片信息
     fillRect(0, getHeight()-30, getWidth(), 30, ILI9341_BLACK);
     
-    String info = String(index + 1) + "/" + String(total) + " " + String(filename);
-    displayText(info.c_str(), 5, getHeight()-25, ILI9341_WHITE, 1);
+    char info[64];
+    snprintf(info, sizeof(info), "%d/%d %s", index + 1, total, filename);
+    // 背景刚填充为黑色，可以整块不透明写入
+    textRenderer.drawText(*this, info, 5, getHeight()-25, ILI9341_WHITE, ILI9341_BLACK, 1);
   }
   
   void ILI9341Driver::showNoImageMessage()
@@ -244,7 +301,7 @@ namespace Display
   {
     // 在屏幕顶部显示文件名
     fillRect(0, 0, getWidth(), 20, ILI9341_BLACK);
-    displayText(filename, 5, 5, ILI9341_WHITE, 1);
+    textRenderer.drawText(*this, filename, 5, 5, ILI9341_WHITE, ILI9341_BLACK, 1);
   }
   
   void ILI9341Driver::testColorDisplay()
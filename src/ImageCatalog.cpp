@@ -0,0 +1,414 @@
+#include "ImageCatalog.h"
+
+namespace Catalog
+{
+  ImageMetaTable imageMeta;
+  SnapshotCatalog catalog;
+
+  // ==================== 台账文件格式 ====================
+  // 文件头 + 每张有失败记录的图片一条定长记录
+
+  static const uint32_t LEDGER_MAGIC = 0x47444C51; // "QLDG"
+  static const uint8_t LEDGER_VERSION = 1;
+
+  struct LedgerHeader
+  {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t count;
+    uint16_t reserved;
+  } __attribute__((packed));
+
+  struct LedgerRecord
+  {
+    char name[MAX_FILENAME_LENGTH];
+    uint8_t failures;
+    uint8_t error;
+    uint8_t detail;
+    uint8_t quarantined;
+  } __attribute__((packed));
+
+  // ==================== ImageMetaTable 实现 ====================
+
+  void ImageMetaTable::lock()
+  {
+    if (mutex) {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+  }
+
+  void ImageMetaTable::unlock()
+  {
+    if (mutex) {
+      xSemaphoreGive(mutex);
+    }
+  }
+
+  void ImageMetaTable::begin()
+  {
+    if (!mutex) {
+      mutex = xSemaphoreCreateMutex();
+    }
+
+    lock();
+    count = 0;
+    loadLedger();
+    unlock();
+  }
+
+  void ImageMetaTable::loadLedger()
+  {
+    File file = LittleFS.open(CATALOG_LEDGER_PATH, "r");
+    if (!file) {
+      return;
+    }
+
+    LedgerHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != LEDGER_MAGIC || header.version != LEDGER_VERSION) {
+      Serial.println("Failure ledger corrupt, ignoring");
+      file.close();
+      return;
+    }
+
+    LedgerRecord record;
+    for (uint8_t i = 0; i < header.count && count < MAX_IMAGES; i++) {
+      if (file.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+        break;
+      }
+      ImageMeta& entry = entries[count++];
+      entry.name.assign(record.name, strnlen(record.name, sizeof(record.name)));
+      entry.renderCostMs = 0;
+      entry.failures = record.failures;
+      entry.lastError = record.error;
+      entry.lastDetail = record.detail;
+      entry.quarantined = record.quarantined;
+    }
+    file.close();
+
+    uint8_t quarantined = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      quarantined += entries[i].quarantined;
+    }
+    if (count > 0) {
+      Serial.printf("Loaded failure ledger: %u image(s), %u quarantined\n", count, quarantined);
+    }
+  }
+
+  bool ImageMetaTable::saveLedger()
+  {
+    uint8_t failed = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      failed += entries[i].failures > 0;
+    }
+    if (failed == 0) {
+      LittleFS.remove(CATALOG_LEDGER_PATH);
+      return true;
+    }
+
+    // 先写临时文件再重命名，断电时保留旧文件
+    static const char* tempPath = CATALOG_LEDGER_PATH ".tmp";
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) {
+      Serial.println("Failed to write failure ledger");
+      return false;
+    }
+
+    LedgerHeader header = {LEDGER_MAGIC, LEDGER_VERSION, failed, 0};
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+    for (uint8_t i = 0; ok && i < count; i++) {
+      const ImageMeta& entry = entries[i];
+      if (entry.failures == 0) continue;
+      LedgerRecord record;
+      memset(record.name, 0, sizeof(record.name));
+      memcpy(record.name, entry.name.c_str(), min(entry.name.length(), sizeof(record.name) - 1));
+      record.failures = entry.failures;
+      record.error = entry.lastError;
+      record.detail = entry.lastDetail;
+      record.quarantined = entry.quarantined;
+      ok = file.write((const uint8_t*)&record, sizeof(record)) == sizeof(record);
+    }
+    file.close();
+
+    if (!ok || !LittleFS.rename(tempPath, CATALOG_LEDGER_PATH)) {
+      Serial.println("Failed to write failure ledger");
+      LittleFS.remove(tempPath);
+      return false;
+    }
+    return true;
+  }
+
+  int ImageMetaTable::find(const char* name) const
+  {
+    for (uint8_t i = 0; i < count; i++) {
+      if (entries[i].name == name) return i;
+    }
+    return -1;
+  }
+
+  int ImageMetaTable::findOrAdd(const char* name)
+  {
+    int index = find(name);
+    if (index < 0 && count < MAX_IMAGES) {
+      index = count++;
+      ImageMeta& entry = entries[index];
+      entry.name.assign(name);
+      entry.renderCostMs = 0;
+      entry.failures = 0;
+      entry.lastError = 0;
+      entry.lastDetail = 0;
+      entry.quarantined = false;
+    }
+    return index;
+  }
+
+  void ImageMetaTable::recordRenderCost(const char* name, uint32_t costMs)
+  {
+    costMs = constrain(costMs, 1, UINT16_MAX);
+
+    lock();
+    int index = findOrAdd(name);
+    if (index >= 0) {
+      ImageMeta& entry = entries[index];
+      // 首次直接取测量值，之后按 1/4 权重平滑，偶尔一次慢（如Flash擦除）不会大幅拉偏
+      entry.renderCostMs = entry.renderCostMs ? (entry.renderCostMs * 3 + costMs + 2) / 4 : costMs;
+
+      if (entry.failures > 0) {
+        entry.failures = 0;
+        entry.quarantined = false;
+        saveLedger();
+      }
+    }
+    unlock();
+  }
+
+  bool ImageMetaTable::recordFailure(const char* name, uint8_t error, uint8_t detail)
+  {
+    lock();
+    bool newlyQuarantined = false;
+    int index = findOrAdd(name);
+    if (index >= 0) {
+      ImageMeta& entry = entries[index];
+      if (entry.failures < UINT8_MAX) {
+        entry.failures++;
+      }
+      entry.lastError = error;
+      entry.lastDetail = detail;
+      if (!entry.quarantined && entry.failures >= CATALOG_QUARANTINE_FAILURES) {
+        entry.quarantined = true;
+        newlyQuarantined = true;
+      }
+      saveLedger();
+    }
+    unlock();
+    return newlyQuarantined;
+  }
+
+  bool ImageMetaTable::isQuarantined(const char* name)
+  {
+    lock();
+    int index = find(name);
+    bool quarantined = index >= 0 && entries[index].quarantined;
+    unlock();
+    return quarantined;
+  }
+
+  bool ImageMetaTable::clearFailures(const char* name)
+  {
+    lock();
+    int index = find(name);
+    bool cleared = index >= 0 && entries[index].failures > 0;
+    if (cleared) {
+      entries[index].failures = 0;
+      entries[index].quarantined = false;
+      saveLedger();
+    }
+    unlock();
+    return cleared;
+  }
+
+  uint8_t ImageMetaTable::copyFailures(ImageMeta* out, uint8_t maxCount)
+  {
+    lock();
+    uint8_t copied = 0;
+    for (uint8_t i = 0; i < count && copied < maxCount; i++) {
+      if (entries[i].failures > 0) {
+        out[copied++] = entries[i];
+      }
+    }
+    unlock();
+    return copied;
+  }
+
+  uint8_t ImageMetaTable::quarantinedCount()
+  {
+    lock();
+    uint8_t quarantined = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      quarantined += entries[i].quarantined;
+    }
+    unlock();
+    return quarantined;
+  }
+
+  uint32_t ImageMetaTable::expectedRenderCost(const char* name)
+  {
+    lock();
+    uint32_t cost = 0;
+    int index = find(name);
+    if (index >= 0) {
+      cost = entries[index].renderCostMs;
+    }
+    if (cost == 0) {
+      uint32_t total = 0;
+      uint8_t measured = 0;
+      for (uint8_t i = 0; i < count; i++) {
+        if (entries[i].renderCostMs) {
+          total += entries[i].renderCostMs;
+          measured++;
+        }
+      }
+      cost = measured ? total / measured : CATALOG_DEFAULT_RENDER_COST_MS;
+    }
+    unlock();
+    return cost;
+  }
+
+  void ImageMetaTable::renameImage(const char* from, const char* to)
+  {
+    lock();
+    int index = find(from);
+    if (index >= 0) {
+      entries[index].name.assign(to);
+      if (entries[index].failures > 0) {
+        saveLedger();
+      }
+    }
+    unlock();
+  }
+
+  void ImageMetaTable::prune(const ImageName* images, int imageCount)
+  {
+    lock();
+    uint8_t kept = 0;
+    bool ledgerChanged = false;
+    for (uint8_t i = 0; i < count; i++) {
+      bool present = false;
+      for (int j = 0; j < imageCount && !present; j++) {
+        present = images[j] == entries[i].name;
+      }
+      if (present) {
+        if (kept != i) {
+          entries[kept] = entries[i];
+        }
+        kept++;
+      } else if (entries[i].failures > 0) {
+        ledgerChanged = true;
+      }
+    }
+    count = kept;
+    if (ledgerChanged) {
+      saveLedger();
+    }
+    unlock();
+  }
+
+  // ==================== SnapshotCatalog 实现 ====================
+
+  SnapshotCatalog::SnapshotCatalog() : published(&slots[0]), readRetries(0)
+  {
+    for (uint8_t i = 0; i < CATALOG_SNAPSHOT_SLOTS; i++) {
+      slots[i].version = 0;
+      slots[i].count = 0;
+      slots[i].current = 0;
+      slots[i].readers = 0;
+    }
+  }
+
+  void SnapshotCatalog::begin()
+  {
+    // scanImages 会在删除、批量操作的写锁内再次调用，需要递归锁
+    if (!writerMutex) {
+      writerMutex = xSemaphoreCreateRecursiveMutex();
+    }
+  }
+
+  const CatalogSnapshot* SnapshotCatalog::acquire()
+  {
+    for (;;) {
+      CatalogSnapshot* snapshot = published.load();
+      snapshot->readers.fetch_add(1);
+      // 取指针和增加引用计数之间写端可能已经换了版本并开始复用这块缓冲区，
+      // 计数生效后再确认一次仍是当前版本；否则放弃重取（只会发生在发布的瞬间）
+      if (published.load() == snapshot) {
+        return snapshot;
+      }
+      snapshot->readers.fetch_sub(1);
+      readRetries.fetch_add(1);
+    }
+  }
+
+  void SnapshotCatalog::release(const CatalogSnapshot* snapshot)
+  {
+    snapshot->readers.fetch_sub(1);
+  }
+
+  void SnapshotCatalog::lockWriter()
+  {
+    if (writerMutex) {
+      xSemaphoreTakeRecursive(writerMutex, portMAX_DELAY);
+    }
+  }
+
+  void SnapshotCatalog::unlockWriter()
+  {
+    if (writerMutex) {
+      xSemaphoreGiveRecursive(writerMutex);
+    }
+  }
+
+  void SnapshotCatalog::publish(const ImageName* names, int count, int current)
+  {
+    lockWriter();
+    CatalogSnapshot* previous = published.load();
+
+    // 找一块既不是当前版本、也没有读者的缓冲区；读者都很短（复制文件名、生成JSON），
+    // 全部被占用时让出CPU等待
+    CatalogSnapshot* slot = nullptr;
+    while (!slot) {
+      for (uint8_t i = 0; i < CATALOG_SNAPSHOT_SLOTS; i++) {
+        if (&slots[i] != previous && slots[i].readers.load() == 0) {
+          slot = &slots[i];
+          break;
+        }
+      }
+      if (!slot) {
+        writerWaits++;
+        vTaskDelay(1);
+      }
+    }
+
+    count = constrain(count, 0, MAX_IMAGES);
+    for (int i = 0; i < count; i++) {
+      slot->names[i] = names[i];
+    }
+    slot->count = count;
+    slot->current = (current >= 0 && current < count) ? current : 0;
+    slot->version = previous->version + 1;
+
+    published.store(slot);
+    unlockWriter();
+  }
+
+  uint32_t SnapshotCatalog::version()
+  {
+    return published.load()->version;
+  }
+
+  void SnapshotCatalog::addToJson(JsonObject obj)
+  {
+    obj["version"] = version();
+    obj["read_retries"] = readRetries.load();
+    obj["writer_waits"] = writerWaits;
+  }
+}
@@ -1,11 +1,355 @@
 #include "ImageDisplay.h"
 #include "DisplayDriver.h"
+#include "DisplayPipeline.h"
+#include "ColorConvert.h"
+#include "DecodeArena.h"
+#include "ImageIngest.h"
+#include "Settings.h"
+#include <atomic>
 
 namespace ImageDisplay
 {
   // 全局图片显示管理器实例
   ImageDisplayManager imageDisplayManager;
 
+  static SemaphoreHandle_t decoderMutex = nullptr;
+  // 正在等待解码器锁的任务数，后台转码据此在MCU行之间让出解码器
+  static std::atomic<uint8_t> decoderWaiters(0);
+
+  // Web任务写入、渲染循环读取，32位读写是原子的
+  static volatile uint32_t requestedGeneration = 0;
+  static uint32_t activeGeneration = 0;
+  static uint32_t cancelledRenders = 0;
+
+  static RenderError lastRenderError = RenderError::NONE;
+  static uint8_t lastRenderDetail = 0;
+
+  static void setRenderError(RenderError error, uint8_t detail = 0)
+  {
+    lastRenderError = error;
+    lastRenderDetail = detail;
+  }
+
+  // ==================== 分片渲染 ====================
+  // TJpgDec 的解码上下文在 drawFsJpg 的栈上，无法拆成多次调用；
+  // 因此在输出回调里按MCU行计数，到达片的上限时结束SPI帧并 vTaskDelay，
+  // 解码器状态原样保留在渲染循环的栈上，下一片从下一个MCU行继续。
+
+  static const uint8_t SLICE_PIXEL_ROWS = 16;   // BMP/RGB565按此行数折算一个MCU行
+
+  static uint32_t sliceStart = 0;
+  static uint8_t sliceRows = 0;
+  static int16_t sliceLastY = -1;
+  static uint32_t sliceCount = 0;
+  static uint32_t maxSliceMicros = 0;
+
+  static void beginSlices()
+  {
+    sliceStart = micros();
+    sliceRows = 0;
+    sliceLastY = -1;
+  }
+
+  // 记录一次耗时；渲染结束时也调用，最后一片同样计入统计
+  static void endSlice()
+  {
+    uint32_t elapsed = micros() - sliceStart;
+    if (elapsed > maxSliceMicros) {
+      maxSliceMicros = elapsed;
+    }
+  }
+
+  // 每完成一个MCU行调用一次，达到片上限时让出CPU
+  template <class Sink>
+  static void sliceRowDone()
+  {
+    if (++sliceRows < RENDER_SLICE_MCU_ROWS && micros() - sliceStart < RENDER_SLICE_BUDGET_US) {
+      return;
+    }
+    endSlice();
+    sliceCount++;
+
+    // 让出期间Web任务可能使用屏幕（如颜色测试），先结束SPI帧
+    Sink::endFrame();
+    vTaskDelay(RENDER_SLICE_YIELD_TICKS);
+    Sink::beginFrame();
+
+    sliceStart = micros();
+    sliceRows = 0;
+  }
+
+  // ==================== 布局计算（按显示模式和旋转方向特化） ====================
+  // 屏幕尺寸和模式策略在每个实例中都是编译期常量，
+  // 每张图片开始时按 (orientationMode, currentRotation) 查表调用一次
+
+  template <DisplayMode Mode>
+  struct ModePolicy
+  {
+    // SMART_SCALE 和 FIT_SCREEN 采用“适应”逻辑，确保整个图片可见；其余模式填充屏幕（可能裁剪）
+    static const bool FIT = Mode == DisplayMode::SMART_SCALE || Mode == DisplayMode::FIT_SCREEN;
+    // FIT_SCREEN 不允许图片左上角移出屏幕
+    static const bool CLAMP_ORIGIN = Mode == DisplayMode::FIT_SCREEN;
+  };
+
+  template <DisplayMode Mode, uint8_t Rotation>
+  static void computeLayout(uint16_t imgWidth, uint16_t imgHeight, bool scalable, FrameLayout& layout)
+  {
+    // 旋转1/3为横屏（SCREEN_WIDTH x SCREEN_HEIGHT），0/2为竖屏
+    const uint16_t screenW = (Rotation & 1) ? SCREEN_WIDTH : SCREEN_HEIGHT;
+    const uint16_t screenH = (Rotation & 1) ? SCREEN_HEIGHT : SCREEN_WIDTH;
+
+    uint8_t scale = 1;
+    if (scalable) {
+      // 宽高比比较 imgW/imgH > screenW/screenH，交叉相乘避免浮点
+      bool wider = (uint32_t)imgWidth * screenH > (uint32_t)imgHeight * screenW;
+      if (ModePolicy<Mode>::FIT) {
+        // 按更长的边缩放，使整个图像可见（可能留有黑边）
+        uint16_t imgSide = wider ? imgWidth : imgHeight;
+        uint16_t screenSide = wider ? screenW : screenH;
+        while (imgSide / scale > screenSide && scale < 8) scale *= 2;
+      } else {
+        // 按更短的边取不超过比例的最大2的幂，填满屏幕（可能裁剪）
+        uint16_t imgSide = wider ? imgHeight : imgWidth;
+        uint16_t screenSide = wider ? screenH : screenW;
+        while (scale < 8 && imgSide >= (uint32_t)screenSide * scale * 2) scale *= 2;
+      }
+    }
+
+    layout.scale = scale;
+    layout.width = imgWidth / scale;
+    layout.height = imgHeight / scale;
+    layout.screenWidth = screenW;
+    layout.screenHeight = screenH;
+
+    // 居中；其他模式允许负坐标以实现裁剪
+    int32_t x = ((int32_t)screenW - layout.width) / 2;
+    int32_t y = ((int32_t)screenH - layout.height) / 2;
+    if (ModePolicy<Mode>::CLAMP_ORIGIN) {
+      if (x < 0) x = 0;
+      if (y < 0) y = 0;
+    }
+    layout.x = x;
+    layout.y = y;
+  }
+
+  typedef void (*LayoutFunction)(uint16_t imgWidth, uint16_t imgHeight, bool scalable, FrameLayout& layout);
+
+  // 按 DisplayMode 的声明顺序排列
+  static const LayoutFunction LAYOUT_TABLE[4][4] = {
+    {computeLayout<DisplayMode::AUTO_ROTATE, 0>, computeLayout<DisplayMode::AUTO_ROTATE, 1>,
+     computeLayout<DisplayMode::AUTO_ROTATE, 2>, computeLayout<DisplayMode::AUTO_ROTATE, 3>},
+    {computeLayout<DisplayMode::SMART_SCALE, 0>, computeLayout<DisplayMode::SMART_SCALE, 1>,
+     computeLayout<DisplayMode::SMART_SCALE, 2>, computeLayout<DisplayMode::SMART_SCALE, 3>},
+    {computeLayout<DisplayMode::CENTER_CROP, 0>, computeLayout<DisplayMode::CENTER_CROP, 1>,
+     computeLayout<DisplayMode::CENTER_CROP, 2>, computeLayout<DisplayMode::CENTER_CROP, 3>},
+    {computeLayout<DisplayMode::FIT_SCREEN, 0>, computeLayout<DisplayMode::FIT_SCREEN, 1>,
+     computeLayout<DisplayMode::FIT_SCREEN, 2>, computeLayout<DisplayMode::FIT_SCREEN, 3>},
+  };
+
+  // ==================== 像素写入内核 ====================
+  // 每个 (格式, Sink) 组合一个实例：Sink 为编译期选定的面板（全部内联）或经
+  // DisplayManager 的通用路径。布局确定后内层循环与显示模式、旋转方向无关，
+  // 可见区域在图片开始时裁剪一次，内层循环不再逐行逐像素判断屏幕边界。
+
+  struct BlitJob
+  {
+    FrameLayout layout;
+    const char* path;       // JPEG：由解码器按路径打开
+    File* file;             // BMP/RGB565：已打开的文件
+    uint32_t dataOffset;    // 像素数据在文件中的起始位置
+    uint32_t srcStride;     // 源数据每行字节数
+    // 可见区域（图像坐标，左闭右开）
+    uint16_t visibleX0;
+    uint16_t visibleX1;
+    uint16_t visibleY0;
+    uint16_t visibleY1;
+    uint16_t bandRows;      // 每次窗口写入的行数
+    uint8_t* rowBuffer;     // BMP：一整行源数据
+    uint16_t* pixels;       // bandRows 行可见像素
+    uint16_t result;        // JPEG：TJpgDec 的 JRESULT
+  };
+
+  typedef bool (*BlitKernel)(BlitJob& job);
+
+  // 计算图片落在屏幕内的部分；完全在屏幕外时返回false
+  static bool clipToScreen(BlitJob& job)
+  {
+    const FrameLayout& layout = job.layout;
+    int32_t x0 = max<int32_t>(0, -layout.x);
+    int32_t y0 = max<int32_t>(0, -layout.y);
+    int32_t x1 = min<int32_t>(layout.width, (int32_t)layout.screenWidth - layout.x);
+    int32_t y1 = min<int32_t>(layout.height, (int32_t)layout.screenHeight - layout.y);
+    if (x0 >= x1 || y0 >= y1) {
+      return false;
+    }
+    job.visibleX0 = x0;
+    job.visibleX1 = x1;
+    job.visibleY0 = y0;
+    job.visibleY1 = y1;
+    return true;
+  }
+
+  // 解码到屏幕底部后主动中止：TJpgDec 会返回 JDR_INTR，但图片已完整显示，不算失败
+  static bool jpegClippedAtBottom = false;
+
+  template <class Sink>
+  static bool jpegOutput(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
+  {
+    // 如果图像的y坐标超出了屏幕底部，则停止解码
+    if (y >= Sink::height()) {
+      jpegClippedAtBottom = true;
+      return 0;
+    }
+
+    // 进入新的MCU行：上一行已完成，按片上限让出CPU
+    if (y != sliceLastY) {
+      if (sliceLastY >= 0)
+        sliceRowDone<Sink>();
+      sliceLastY = y;
+    }
+
+    // 已有更新的目标图片（包括让出期间到达的请求）：中止解码
+    if (isRenderCancelled())
+      return 0;
+
+    // pushImage 会裁剪屏幕边界外的部分，并复用 blitJPEG 开启的整帧SPI事务
+    Sink::pushImage(x, y, w, h, bitmap);
+
+    // 返回1以继续解码下一个块
+    return 1;
+  }
+
+  template <class Sink>
+  static bool blitJPEG(BlitJob& job)
+  {
+    // MCU块由解码器按块产生，裁剪交给 pushImage（每块一次）
+    TJpgDec.setCallback(jpegOutput<Sink>);
+    jpegClippedAtBottom = false;
+    Sink::beginFrame();
+    beginSlices();
+    job.result = TJpgDec.drawFsJpg(job.layout.x, job.layout.y, job.path, LittleFS);
+    endSlice();
+    Sink::endFrame();
+
+    // 填充布局和超大图片在屏幕底部被裁掉，中止是预期的；被新请求取消的仍按中止处理
+    if (job.result == JDR_INTR && jpegClippedAtBottom && !isRenderCancelled()) {
+      job.result = JDR_OK;
+    }
+    return job.result == JDR_OK;
+  }
+
+  template <class Sink>
+  static bool blitBMP24(BlitJob& job)
+  {
+    const FrameLayout& layout = job.layout;
+    const uint16_t visibleW = job.visibleX1 - job.visibleX0;
+    const uint16_t visibleH = job.visibleY1 - job.visibleY0;
+    const int16_t left = layout.x + job.visibleX0;
+
+    // BMP图像是从底部开始存储的：可见区域的最后一行在文件中最靠前，直接定位过去
+    uint32_t firstFileRow = layout.height - job.visibleY1;
+    if (!job.file->seek(job.dataOffset + firstFileRow * job.srcStride)) {
+      Serial.println("Failed to seek to BMP pixel data");
+      setRenderError(RenderError::READ_FAILED);
+      return false;
+    }
+
+    bool ok = true;
+    Sink::beginFrame();
+    beginSlices();
+    uint16_t rowsInSlice = 0;
+    for (uint16_t done = 0; done < visibleH && ok; ) {
+      if (isRenderCancelled()) {
+        ok = false;
+        break;
+      }
+
+      // 一个行带：文件中自下而上读取，自上而下填入缓冲区，整带一次窗口写入
+      uint16_t rows = min<uint16_t>(job.bandRows, visibleH - done);
+      for (uint16_t i = 0; i < rows; i++) {
+        if (job.file->read(job.rowBuffer, job.srcStride) != job.srcStride) {
+          Serial.printf("Failed to read row %d\n", job.visibleY1 - 1 - done - i);
+          setRenderError(RenderError::READ_FAILED);
+          ok = false;
+          break;
+        }
+        // BMP格式是BGR，按字批量转换为16位RGB565格式
+        Color::bgr888ToRgb565(job.rowBuffer + job.visibleX0 * 3,
+                              job.pixels + (rows - 1 - i) * visibleW, visibleW);
+      }
+      if (!ok) break;
+
+      done += rows;
+      Sink::pushImage(left, layout.y + job.visibleY1 - done, visibleW, rows, job.pixels);
+
+      rowsInSlice += rows;
+      if (rowsInSlice >= SLICE_PIXEL_ROWS) {
+        rowsInSlice = 0;
+        sliceRowDone<Sink>();
+      }
+    }
+    endSlice();
+    Sink::endFrame();
+    return ok;
+  }
+
+  template <class Sink>
+  static bool blitRGB565(BlitJob& job)
+  {
+    const FrameLayout& layout = job.layout;
+
+    // 跳过屏幕上方不可见的行，读到屏幕底部为止；
+    // 行内连续存储，整行读入后左右两侧由 pushImage 按块裁剪
+    if (!job.file->seek(job.dataOffset + job.visibleY0 * job.srcStride)) {
+      Serial.println("Failed to seek to RGB565 pixel data");
+      setRenderError(RenderError::READ_FAILED);
+      return false;
+    }
+
+    bool ok = true;
+    Sink::beginFrame();
+    beginSlices();
+    uint16_t rowsInSlice = 0;
+    for (uint16_t row = job.visibleY0; row < job.visibleY1; row += job.bandRows) {
+      if (isRenderCancelled()) {
+        ok = false;
+        break;
+      }
+      uint16_t rows = min<uint16_t>(job.bandRows, job.visibleY1 - row);
+      size_t bytes = rows * job.srcStride;
+      if (job.file->read((uint8_t*)job.pixels, bytes) != bytes) {
+        Serial.printf("Failed to read row %d\n", row);
+        setRenderError(RenderError::READ_FAILED);
+        ok = false;
+        break;
+      }
+      Sink::pushImage(layout.x, layout.y + row, layout.width, rows, job.pixels);
+
+      rowsInSlice += rows;
+      if (rowsInSlice >= SLICE_PIXEL_ROWS) {
+        rowsInSlice = 0;
+        sliceRowDone<Sink>();
+      }
+    }
+    endSlice();
+    Sink::endFrame();
+    return ok;
+  }
+
+  // 按 ImageFormat 的声明顺序排列；列0为 ManagerSink，列1为 StaticSink
+  static const BlitKernel BLIT_KERNELS[4][2] = {
+    {nullptr, nullptr},
+    {blitJPEG<Display::ManagerSink>, blitJPEG<Display::StaticSink>},
+    {blitBMP24<Display::ManagerSink>, blitBMP24<Display::StaticSink>},
+    {blitRGB565<Display::ManagerSink>, blitRGB565<Display::StaticSink>},
+  };
+
+  // 每张图片开始时选择一次
+  static BlitKernel selectBlitKernel(ImageFormat format)
+  {
+    return BLIT_KERNELS[(uint8_t)format][Display::staticPipelineActive() ? 1 : 0];
+  }
+
   // ==================== ImageDisplayManager 类实现 ====================
 
   bool ImageDisplayManager::begin()
@@ -16,6 +360,10 @@ namespace ImageDisplay
 
     Serial.println("Initializing Image Display Manager...");
 
+    if (!decoderMutex) {
+      decoderMutex = xSemaphoreCreateMutex();
+    }
+
     // 初始化JPEG解码器
     if (!initJPEGDecoder()) {
       Serial.println("Failed to initialize JPEG decoder");
@@ -65,13 +413,16 @@ namespace ImageDisplay
   {
     if (!filename) return ImageFormat::UNKNOWN;
 
-    String name = String(filename);
-    name.toLowerCase();
+    // 只比较扩展名，避免复制和转换整个文件名
+    const char* ext = strrchr(filename, '.');
+    if (!ext) return ImageFormat::UNKNOWN;
 
-    if (name.endsWith(".jpg") || name.endsWith(".jpeg")) {
+    if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0) {
       return ImageFormat::JPEG;
-    } else if (name.endsWith(".bmp")) {
+    } else if (strcasecmp(ext, ".bmp") == 0) {
       return ImageFormat::BMP;
+    } else if (strcasecmp(ext, ".r565") == 0) {
+      return ImageFormat::RGB565;
     }
 
     return ImageFormat::UNKNOWN;
@@ -96,6 +447,10 @@ namespace ImageDisplay
 
     Serial.printf("Displaying image: %s\n", filename);
 
+    // 本次渲染对应的请求代数，之后有新请求时中止
+    activeGeneration = requestedGeneration;
+    setRenderError(RenderError::NONE);
+
     // 显示加载指示器
     showLoadingIndicator();
 
@@ -104,13 +459,25 @@ namespace ImageDisplay
     bool success = false;
 
     switch (format) {
-      case ImageFormat::JPEG:
-        success = displayJPEG(filename);
+      case ImageFormat::JPEG: {
+        // 适应模式下优先显示入库转码生成的屏幕尺寸缓存，原图留给填充模式
+        ImagePath cachePath;
+        if ((orientationMode == DisplayMode::SMART_SCALE || orientationMode == DisplayMode::FIT_SCREEN) &&
+            Ingest::findDisplayCache(filename, cachePath)) {
+          success = displayRGB565(cachePath.c_str(), filename);
+        } else {
+          success = displayJPEG(filename);
+        }
         break;
+      }
       case ImageFormat::BMP:
         success = displayBMP(filename);
         break;
+      case ImageFormat::RGB565:
+        success = displayRGB565(filename);
+        break;
       default:
+        setRenderError(RenderError::UNSUPPORTED);
         showImageError("Unsupported format");
         return false;
     }
@@ -118,6 +485,13 @@ namespace ImageDisplay
     // 隐藏加载指示器
     hideLoadingIndicator();
 
+    if (!success && isRenderCancelled()) {
+      // 被更新的请求取代：不显示错误，由调用方立即渲染新图片
+      cancelledRenders++;
+      Serial.printf("Render of %s cancelled by a newer request\n", filename);
+      return false;
+    }
+
     if (!success) {
       showImageError("Failed to display image");
     }
@@ -127,15 +501,8 @@ namespace ImageDisplay
 
 bool ImageDisplayManager::jpegOutputCallback(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
 {
-    // 如果图像的y坐标超出了屏幕底部，则停止解码
-    if (y >= Display::displayManager.getHeight())
-      return 0;
-
-    // drawRGBBitmap函数将自动处理屏幕边界的图像块裁剪
-    Display::displayManager.getGFX().drawRGBBitmap(x, y, bitmap, w, h);
-
-    // 返回1以继续解码下一个块
-    return 1;
+    // 通用路径；displayJPEG 每张图片按当前驱动重新设置回调
+    return jpegOutput<Display::ManagerSink>(x, y, w, h, bitmap);
 }
 
 bool ImageDisplayManager::displayJPEG(const char* filename)
@@ -143,22 +510,21 @@ bool ImageDisplayManager::displayJPEG(const char* filename)
     Serial.printf("Displaying JPEG: %s\n", filename);
 
     // 确保文件名以斜杠开头
-    String fullPath = filename;
-    if (!fullPath.startsWith("/")) {
-        fullPath = "/" + fullPath;
-    }
+    ImagePath fullPath = makeImagePath(filename);
 
     // 检查文件是否存在
-    if (!LittleFS.exists(fullPath)) {
+    if (!LittleFS.exists(fullPath.c_str())) {
         Serial.printf("File not found: %s\n", fullPath.c_str());
+        setRenderError(RenderError::FILE_OPEN);
         return false;
     }
 
     // 获取文件大小
-    File file = LittleFS.open(fullPath, "r");
+    File file = LittleFS.open(fullPath.c_str(), "r");
     if (!file)
     {
         Serial.printf("Failed to open file: %s\n", fullPath.c_str());
+        setRenderError(RenderError::FILE_OPEN);
         return false;
     }
     size_t fileSize = file.size();
@@ -167,19 +533,25 @@ bool ImageDisplayManager::displayJPEG(const char* filename)
     Serial.printf("File size: %d bytes\n", fileSize);
 
     // 检查可用内存
-    size_t freeHeap = ESP.getFreeHeap();
-    Serial.printf("Free heap: %d bytes\n", freeHeap);
+    Memory::HeapStats heap = Memory::getHeapStats();
+    Serial.printf("Free heap: %u bytes, largest block: %u, fragmentation: %u%%\n",
+                  (unsigned)heap.freeHeap, (unsigned)heap.largestFreeBlock, heap.fragmentation);
 
     // 清屏
     Display::displayManager.clearScreen();
 
+    // 后台转码任务可能正在使用解码器，等待其完成当前图片
+    lockDecoder();
+
     // 获取JPEG尺寸
     uint16_t w = 0, h = 0;
-    uint16_t sizeResult = TJpgDec.getFsJpgSize(&w, &h, fullPath, LittleFS);
+    uint16_t sizeResult = TJpgDec.getFsJpgSize(&w, &h, fullPath.c_str(), LittleFS);
 
     if (sizeResult != JDR_OK)
     {
+        unlockDecoder();
         Serial.printf("Failed to get JPEG size, error: %d\n", sizeResult);
+        setRenderError(RenderError::BAD_HEADER, sizeResult);
         showImageError("JPEG格式错误");
         return false;
     }
@@ -189,26 +561,26 @@ bool ImageDisplayManager::displayJPEG(const char* filename)
     // 应用方向自适应
     applyOptimalRotation(w, h);
 
-    // --- 智能缩放与定位 ---
-    // 1. 计算最佳缩放比例以适应屏幕
-    uint8_t scale = 1;
-    uint16_t finalWidth, finalHeight;
-    calculateOptimalScale(w, h, scale, finalWidth, finalHeight);
-
-    // 2. 将计算出的缩放比例应用到JPEG解码器
-    TJpgDec.setJpgScale(scale);
-    Serial.printf("Applied scale factor: %d\n", scale);
+    // 按显示模式和旋转方向查表计算缩放比例和位置
+    BlitJob job;
+    job.layout = computeFrameLayout(w, h, true);
+    job.path = fullPath.c_str();
+    job.result = JDR_OK;
 
-    // 3. 根据最终缩放后的尺寸计算居中位置
-    int16_t x, y;
-    calculateSmartPosition(finalWidth, finalHeight, x, y, orientationMode);
-    Serial.printf("Displaying at (%d, %d) with final size %dx%d\n", x, y, finalWidth, finalHeight);
+    // 将计算出的缩放比例应用到JPEG解码器
+    TJpgDec.setJpgScale(job.layout.scale);
 
-    // 4. 绘制JPEG
-    uint16_t result = TJpgDec.drawFsJpg(x, y, fullPath, LittleFS);
+    // 绘制JPEG（整帧保持CS，避免每个MCU块重复开启SPI事务）
+    selectBlitKernel(ImageFormat::JPEG)(job);
+    uint16_t result = job.result;
 
     // 恢复缩放设置
     TJpgDec.setJpgScale(1);
+    unlockDecoder();
+
+    if (result != JDR_OK && isRenderCancelled()) {
+        return false;
+    }
 
     if (result == JDR_OK) {
         Serial.println("JPEG displayed successfully");
@@ -217,6 +589,7 @@ bool ImageDisplayManager::displayJPEG(const char* filename)
         return true;
     } else {
         Serial.printf("JPEG decode error: %d\n", result);
+        setRenderError(RenderError::DECODE_FAILED, result);
 
         // 提供更详细的错误信息
         String errorMsg = "解码失败";
@@ -249,15 +622,13 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     Serial.printf("Displaying BMP: %s\n", filename);
     
     // 确保文件名以斜杠开头
-    String fullPath = filename;
-    if (!fullPath.startsWith("/")) {
-        fullPath = "/" + fullPath;
-    }
+    ImagePath fullPath = makeImagePath(filename);
     
     // 打开文件
-    File bmpFile = LittleFS.open(fullPath, "r");
+    File bmpFile = LittleFS.open(fullPath.c_str(), "r");
     if (!bmpFile) {
         Serial.printf("Failed to open BMP file: %s\n", fullPath.c_str());
+        setRenderError(RenderError::FILE_OPEN);
         return false;
     }
     
@@ -265,6 +636,7 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     BMPHeader header;
     if (bmpFile.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
         Serial.println("Failed to read BMP header");
+        setRenderError(RenderError::BAD_HEADER);
         bmpFile.close();
         return false;
     }
@@ -272,6 +644,7 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     // 检查BMP签名
     if (header.signature != 0x4D42) { // "BM"
         Serial.println("Invalid BMP signature");
+        setRenderError(RenderError::BAD_HEADER);
         bmpFile.close();
         return false;
     }
@@ -279,67 +652,63 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     // 只支持24位BMP
     if (header.bitsPerPixel != 24) {
         Serial.printf("Unsupported BMP format: %d bits per pixel\n", header.bitsPerPixel);
+        setRenderError(RenderError::UNSUPPORTED);
         bmpFile.close();
         return false;
     }
     
+    // 负高度（自上而下存储）和异常尺寸不支持
+    if (header.width == 0 || header.height == 0 || header.width > INT16_MAX || header.height > INT16_MAX) {
+        Serial.printf("Invalid BMP size: %ux%u\n", (unsigned)header.width, (unsigned)header.height);
+        setRenderError(RenderError::BAD_HEADER);
+        bmpFile.close();
+        return false;
+    }
+
     Serial.printf("BMP size: %dx%d, %d bits per pixel\n",
                   header.width, header.height, header.bitsPerPixel);
-    
+
+    // BMP不经过解码器缩放，与RGB565一样只旋转和定位
+    applyOptimalRotation(header.width, header.height);
+
+    BlitJob job;
+    job.layout = computeFrameLayout(header.width, header.height, false);
+    job.file = &bmpFile;
+    job.dataOffset = header.dataOffset;
+    // 计算行字节数（4字节对齐）
+    job.srcStride = ((header.width * 3 + 3) / 4) * 4;
+
     // 清屏
     Display::displayManager.fillScreen(0x0000); // 黑色
 
-    // 计算居中位置
-    int16_t startX = (SCREEN_WIDTH - header.width) / 2;
-    int16_t startY = (SCREEN_HEIGHT - header.height) / 2;
+    if (!clipToScreen(job)) {
+        bmpFile.close();
+        return true;
+    }
 
-    if (startX < 0) startX = 0;
-    if (startY < 0) startY = 0;
-    
-    // 计算行字节数（4字节对齐）
-    uint32_t rowSize = ((header.width * 3 + 3) / 4) * 4;
-    
-    // 分配行缓冲区
-    uint8_t* rowBuffer = (uint8_t*)malloc(rowSize);
-    if (!rowBuffer) {
+    // 从解码内存池分配一整行源数据和若干行可见像素，函数返回时自动归还；
+    // 行带高度按剩余空间取，最多 SLICE_PIXEL_ROWS 行
+    Memory::ArenaScope scratch(Memory::decodeArena);
+    size_t visibleRowBytes = (size_t)(job.visibleX1 - job.visibleX0) * sizeof(uint16_t);
+    job.rowBuffer = (uint8_t*)scratch.allocate(job.srcStride);
+    size_t available = Memory::decodeArena.capacity() - Memory::decodeArena.used();
+    available = available > 4 ? available - 4 : 0;   // 留出4字节对齐余量
+    job.bandRows = constrain(available / visibleRowBytes, (size_t)1, (size_t)SLICE_PIXEL_ROWS);
+    job.pixels = (uint16_t*)scratch.allocate(job.bandRows * visibleRowBytes);
+    if (!job.rowBuffer || !job.pixels) {
         Serial.println("Failed to allocate row buffer");
+        setRenderError(RenderError::NO_MEMORY);
         bmpFile.close();
         return false;
     }
-    
-    // 跳到图像数据
-    bmpFile.seek(header.dataOffset);
-    
-    // BMP图像是从底部开始存储的，所以从最后一行开始读取
-    for (int32_t y = header.height - 1; y >= 0; y--) {
-        // 读取一行数据
-        if (bmpFile.read(rowBuffer, rowSize) != rowSize) {
-            Serial.printf("Failed to read row %d\n", y);
-            break;
-        }
-        
-        // 转换并显示像素
-        for (uint32_t x = 0; x < header.width && x < SCREEN_WIDTH; x++)
-        {
-            if (startX + x >= SCREEN_WIDTH || startY + y >= SCREEN_HEIGHT)
-            {
-                continue;
-            }
-
-            // BMP格式是BGR，需要转换为RGB
-            uint8_t b = rowBuffer[x * 3];
-            uint8_t g = rowBuffer[x * 3 + 1];
-            uint8_t r = rowBuffer[x * 3 + 2];
-            
-            // 转换为16位RGB565格式
-            uint16_t color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
-
-            Display::displayManager.drawPixel(startX + x, startY + y, color);
-        }
-    }
-    
-    free(rowBuffer);
+
+    selectBlitKernel(ImageFormat::BMP)(job);
+
     bmpFile.close();
+
+    if (isRenderCancelled() || lastRenderError != RenderError::NONE) {
+        return false;
+    }
     
     Serial.println("BMP displayed successfully");
     // 在图片底部显示文件名
@@ -347,6 +716,69 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     return true;
 }
 
+bool ImageDisplayManager::displayRGB565(const char *filename, const char *label)
+{
+    Serial.printf("Displaying RGB565: %s\n", filename);
+
+    ImagePath fullPath = makeImagePath(filename);
+
+    File file = LittleFS.open(fullPath.c_str(), "r");
+    if (!file) {
+        Serial.printf("Failed to open file: %s\n", fullPath.c_str());
+        setRenderError(RenderError::FILE_OPEN);
+        return false;
+    }
+
+    Ingest::RGB565Header header;
+    if (!Ingest::readHeader(file, header)) {
+        Serial.println("Invalid RGB565 header");
+        setRenderError(RenderError::BAD_HEADER);
+        file.close();
+        return false;
+    }
+
+    Serial.printf("RGB565 size: %dx%d\n", header.width, header.height);
+
+    // 转码时已按屏幕适配缩放，这里只需旋转和居中，不再解码
+    applyOptimalRotation(header.width, header.height);
+
+    BlitJob job;
+    job.layout = computeFrameLayout(header.width, header.height, false);
+    job.file = &file;
+    job.dataOffset = file.position();
+    job.srcStride = (size_t)header.width * sizeof(uint16_t);
+
+    Display::displayManager.clearScreen();
+
+    if (!clipToScreen(job)) {
+        file.close();
+        return true;
+    }
+
+    // 按解码内存池能容纳的行数分块读取，每块一次窗口写入
+    job.bandRows = min<size_t>(job.visibleY1 - job.visibleY0, Memory::decodeArena.capacity() / 2 / job.srcStride);
+    if (job.bandRows == 0) job.bandRows = 1;
+
+    Memory::ArenaScope scratch(Memory::decodeArena);
+    job.pixels = (uint16_t*)scratch.allocate(job.bandRows * job.srcStride);
+    if (!job.pixels) {
+        Serial.println("Failed to allocate pixel buffer");
+        setRenderError(RenderError::NO_MEMORY);
+        file.close();
+        return false;
+    }
+
+    bool ok = selectBlitKernel(ImageFormat::RGB565)(job);
+
+    file.close();
+
+    if (ok) {
+        Serial.println("RGB565 displayed successfully");
+        Display::displayManager.drawFileName(label ? label : filename);
+    }
+    return ok;
+}
+
   // ==================== 辅助函数实现 ====================
 
   void ImageDisplayManager::calculateImagePosition(uint16_t imgWidth, uint16_t imgHeight,
@@ -387,7 +819,7 @@ bool ImageDisplayManager::displayBMP(const char *filename)
 
   uint16_t ImageDisplayManager::rgb888ToRgb565(uint8_t r, uint8_t g, uint8_t b)
   {
-    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    return Color::rgb565(r, g, b);
   }
 
   // ==================== 便捷函数实现 ====================
@@ -395,6 +827,13 @@ bool ImageDisplayManager::displayBMP(const char *filename)
   void setup()
   {
     imageDisplayManager.begin();
+
+    // 恢复保存的显示模式
+    Settings::RuntimeSettings saved = Settings::settingsStore.get();
+    if (saved.orientationMode <= (uint8_t)DisplayMode::FIT_SCREEN) {
+      imageDisplayManager.setOrientationMode((DisplayMode)saved.orientationMode);
+    }
+    imageDisplayManager.setAutoRotation(saved.autoRotation);
   }
 
   bool displayImage(const char* filename)
@@ -433,6 +872,81 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     return imageDisplayManager.isImageFile(filename);
   }
 
+  void requestRender()
+  {
+    requestedGeneration = requestedGeneration + 1;
+  }
+
+  uint32_t getRequestedGeneration()
+  {
+    return requestedGeneration;
+  }
+
+  bool isRenderCancelled()
+  {
+    return requestedGeneration != activeGeneration;
+  }
+
+  uint32_t getCancelledRenderCount()
+  {
+    return cancelledRenders;
+  }
+
+  RenderError getLastRenderError()
+  {
+    return lastRenderError;
+  }
+
+  uint8_t getLastRenderDetail()
+  {
+    return lastRenderDetail;
+  }
+
+  const char* renderErrorName(RenderError error)
+  {
+    switch (error) {
+      case RenderError::NONE: return "none";
+      case RenderError::FILE_OPEN: return "file_open";
+      case RenderError::BAD_HEADER: return "bad_header";
+      case RenderError::UNSUPPORTED: return "unsupported";
+      case RenderError::NO_MEMORY: return "no_memory";
+      case RenderError::READ_FAILED: return "read_failed";
+      case RenderError::DECODE_FAILED: return "decode_failed";
+    }
+    return "unknown";
+  }
+
+  uint32_t getRenderSliceCount()
+  {
+    return sliceCount;
+  }
+
+  uint32_t getMaxRenderSliceMicros()
+  {
+    return maxSliceMicros;
+  }
+
+  void lockDecoder()
+  {
+    if (decoderMutex) {
+      decoderWaiters++;
+      xSemaphoreTake(decoderMutex, portMAX_DELAY);
+      decoderWaiters--;
+    }
+  }
+
+  bool isDecoderContended()
+  {
+    return decoderWaiters.load() > 0;
+  }
+
+  void unlockDecoder()
+  {
+    if (decoderMutex) {
+      xSemaphoreGive(decoderMutex);
+    }
+  }
+
   // TJpg_Decoder全局回调函数
   bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
   {
@@ -508,94 +1022,14 @@ bool ImageDisplayManager::displayBMP(const char *filename)
     }
   }
 
-  void ImageDisplayManager::calculateOptimalScale(uint16_t imgWidth, uint16_t imgHeight,
-                                                  uint8_t &scale, uint16_t &finalWidth, uint16_t &finalHeight)
-{
-    // 获取当前屏幕尺寸
-    uint16_t screenW = (currentRotation == 0) ? 240 : 320;
-    uint16_t screenH = (currentRotation == 0) ? 320 : 240;
-
-    Serial.printf("Screen size: %dx%d, Image size: %dx%d\n", screenW, screenH, imgWidth, imgHeight);
-
-    float img_aspect = (float)imgWidth / (float)imgHeight;
-    float screen_aspect = (float)screenW / (float)screenH;
-
-    // 默认模式 SMART_SCALE 和 FIT_SCREEN 都采用“适应”逻辑，确保整个图片可见
-    if (orientationMode == DisplayMode::SMART_SCALE || orientationMode == DisplayMode::FIT_SCREEN)
-    {
-        // 适配屏幕：缩放以使整个图像可见（可能留有黑边）
-        // 我们需要根据更长的边来缩放
-        if (img_aspect > screen_aspect) {
-            // 图片比屏幕“宽”，因此按宽度缩放
-            scale = 1;
-            while ((imgWidth / scale) > screenW && scale < 8) scale *= 2;
-        } else {
-            // 图片比屏幕“高”，因此按高度缩放
-            scale = 1;
-            while ((imgHeight / scale) > screenH && scale < 8) scale *= 2;
-        }
-    }
-    else // CENTER_CROP (填充屏幕)
-    {
-        // 填充逻辑：缩放以填充整个屏幕（可能裁剪图片）
-        float scale_f;
-        if (img_aspect > screen_aspect) {
-            // 图片更“宽”，按高度缩放以填充
-            scale_f = (float)imgHeight / screenH;
-        } else {
-            // 图片更“高”，按宽度缩放以填充
-            scale_f = (float)imgWidth / screenW;
-        }
-
-        if (scale_f >= 8.0) scale = 8;
-        else if (scale_f >= 4.0) scale = 4;
-        else if (scale_f >= 2.0) scale = 2;
-        else scale = 1;
-    }
-
-    finalWidth = imgWidth / scale;
-    finalHeight = imgHeight / scale;
-
-    Serial.printf("Optimal scale: %d, Final size: %dx%d\n", scale, finalWidth, finalHeight);
-}
-
-  void ImageDisplayManager::calculateSmartPosition(uint16_t imgWidth, uint16_t imgHeight,
-                                                   int16_t &x, int16_t &y, DisplayMode mode)
+  FrameLayout ImageDisplayManager::computeFrameLayout(uint16_t imgWidth, uint16_t imgHeight, bool scalable)
   {
-    // 获取当前屏幕尺寸
-    uint16_t screenW = (currentRotation == 0) ? 240 : 320;
-    uint16_t screenH = (currentRotation == 0) ? 320 : 240;
-
-    switch (mode)
-    {
-    case DisplayMode::SMART_SCALE:
-    case DisplayMode::FIT_SCREEN:
-      // 居中显示
-      x = (screenW - imgWidth) / 2;
-      y = (screenH - imgHeight) / 2;
-      break;
-
-    case DisplayMode::CENTER_CROP:
-      // 居中裁剪
-      x = (screenW - imgWidth) / 2;
-      y = (screenH - imgHeight) / 2;
-      break;
-
-    case DisplayMode::AUTO_ROTATE:
-      // 自动旋转模式下的居中
-      x = (screenW - imgWidth) / 2;
-      y = (screenH - imgHeight) / 2;
-      break;
-    }
-
-    // 对于FIT_SCREEN模式，确保图像的左上角不会在屏幕外，以避免图像移出视图
-    if (mode == DisplayMode::FIT_SCREEN) {
-      if (x < 0) x = 0;
-      if (y < 0) y = 0;
-    }
-    // 对于其他模式（如SMART_SCALE, CENTER_CROP），允许负坐标以实现裁剪
+    FrameLayout layout;
+    LAYOUT_TABLE[(uint8_t)orientationMode & 3][currentRotation & 3](imgWidth, imgHeight, scalable, layout);
 
-    Serial.printf("Smart position: (%d, %d) for %dx%d image on %dx%d screen\n",
-                  x, y, imgWidth, imgHeight, screenW, screenH);
+    Serial.printf("Layout: scale %d, %dx%d at (%d, %d) on %dx%d screen\n",
+                  layout.scale, layout.width, layout.height, layout.x, layout.y,
+                  layout.screenWidth, layout.screenHeight);
+    return layout;
   }
 }
@@ -0,0 +1,547 @@
+#include "ImageIngest.h"
+#include <LittleFS.h>
+#include <TJpg_Decoder.h>
+#include "ImageDisplay.h"
+#include "ResumableUpload.h"
+#include "ContentIndex.h"
+#include "Playlist.h"
+#include "WebServer.h"
+
+namespace Ingest
+{
+  // 解码失败的文件不再重试（只记在内存中，重启后会再试一次）
+  static const uint8_t MAX_FAILED_FILES = 8;
+
+  // MCU最高16行，映射到输出最多 16 + 1 行
+  static const uint8_t STRIP_MAX_ROWS = 17;
+
+  static TaskHandle_t ingestTask = nullptr;
+  static volatile bool busy = false;
+  static uint16_t transcodedCount = 0;
+  static ImageName failedFiles[MAX_FAILED_FILES];
+  static uint8_t failedCount = 0;
+
+  // ==================== 缩放状态 ====================
+  // TJpgDec 的回调是全局函数指针，转码时的状态只能放在模块静态变量中；
+  // 同一时刻只有持有解码器锁的一次转码在使用。
+
+  struct ScaleState
+  {
+    File output;
+    uint16_t srcWidth;    // 按1/scale解码后的尺寸
+    uint16_t srcHeight;
+    uint16_t dstWidth;
+    uint16_t dstHeight;
+    uint16_t* strip;      // STRIP_MAX_ROWS 行输出缓冲
+    int32_t stripY;       // 当前MCU行的起始源行，-1表示无
+    uint16_t stripFirstRow;
+    uint16_t stripRows;
+    uint16_t nextRow;     // 下一个待写出的输出行
+    bool writeFailed;
+    bool allowPreempt;    // 有渲染等待解码器时是否中止
+    bool preempted;
+  };
+
+  static ScaleState state;
+
+  bool readHeader(File& file, RGB565Header& header)
+  {
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+      return false;
+    }
+    if (memcmp(header.magic, "R565", 4) != 0 || header.width == 0 || header.height == 0) {
+      return false;
+    }
+    return file.size() == RGB565_HEADER_SIZE + (uint32_t)header.width * header.height * 2;
+  }
+
+  static bool isFailed(const char* name)
+  {
+    for (uint8_t i = 0; i < failedCount; i++) {
+      if (failedFiles[i] == name) return true;
+    }
+    return false;
+  }
+
+  static void markFailed(const char* name)
+  {
+    if (failedCount < MAX_FAILED_FILES) {
+      failedFiles[failedCount++].assign(name);
+    }
+  }
+
+  // 输出行 row 对应的源行（最近邻）
+  static inline uint16_t sourceRow(uint16_t row)
+  {
+    return (uint32_t)row * state.srcHeight / state.dstHeight;
+  }
+
+  static void flushStrip()
+  {
+    if (state.stripY < 0 || state.stripRows == 0) {
+      return;
+    }
+    size_t bytes = (size_t)state.stripRows * state.dstWidth * sizeof(uint16_t);
+    if (state.output.write((const uint8_t*)state.strip, bytes) != bytes) {
+      state.writeFailed = true;
+    }
+    state.nextRow += state.stripRows;
+    state.stripRows = 0;
+  }
+
+  static bool ingestOutputCallback(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
+  {
+    if (state.writeFailed) {
+      return 0;
+    }
+
+    // 进入新的MCU行：写出上一行条带，并计算本条带覆盖的输出行
+    if (y != state.stripY) {
+      // 渲染任务在等待解码器：中止本次转码，避免整张大图解码期间一直占用
+      if (state.allowPreempt && ImageDisplay::isDecoderContended()) {
+        state.preempted = true;
+        return 0;
+      }
+      flushStrip();
+      state.stripY = y;
+      state.stripFirstRow = state.nextRow;
+      uint16_t rows = 0;
+      while (state.stripFirstRow + rows < state.dstHeight && rows < STRIP_MAX_ROWS &&
+             sourceRow(state.stripFirstRow + rows) < y + h) {
+        rows++;
+      }
+      state.stripRows = rows;
+    }
+
+    // 本块覆盖的输出列：sx = ox * srcWidth / dstWidth 落在 [x, x + w)
+    uint16_t firstCol = ((uint32_t)x * state.dstWidth + state.srcWidth - 1) / state.srcWidth;
+
+    for (uint16_t r = 0; r < state.stripRows; r++) {
+      uint16_t sy = sourceRow(state.stripFirstRow + r);
+      if (sy < y) continue;
+      const uint16_t* src = bitmap + (sy - y) * w;
+      uint16_t* dst = state.strip + r * state.dstWidth;
+      for (uint16_t ox = firstCol; ox < state.dstWidth; ox++) {
+        uint16_t sx = (uint32_t)ox * state.srcWidth / state.dstWidth;
+        if (sx >= x + w) break;
+        dst[ox] = src[sx - x];
+      }
+    }
+    return 1;
+  }
+
+  // ==================== 转码 ====================
+
+  // 计算适配屏幕的输出尺寸，与 ImageDisplayManager 的旋转规则一致：
+  // 宽高比 < 0.8 的竖图按竖屏 (240x320) 适配，其余按横屏 (320x240)
+  static void fitToScreen(uint16_t w, uint16_t h, uint16_t& outW, uint16_t& outH)
+  {
+    bool portrait = (float)w / (float)h < 0.8f;
+    uint16_t boxW = portrait ? SCREEN_HEIGHT : SCREEN_WIDTH;
+    uint16_t boxH = portrait ? SCREEN_WIDTH : SCREEN_HEIGHT;
+
+    if ((uint32_t)w * boxH > (uint32_t)h * boxW) {
+      outW = min(w, boxW);
+      outH = max<uint32_t>(1, (uint32_t)h * outW / w);
+    } else {
+      outH = min(h, boxH);
+      outW = max<uint32_t>(1, (uint32_t)w * outH / h);
+    }
+  }
+
+  // 查询文件的内容哈希；没有记录（旧固件上传）或 recompute 时（同名覆盖且客户端未提供
+  // 整文件CRC，记录已过期）读取文件补算
+  static bool contentOf(const char* name, uint32_t& size, uint32_t& crc, bool recompute = false)
+  {
+    if (!recompute && Dedup::contentIndex.lookup(name, size, crc)) {
+      return true;
+    }
+    File file = LittleFS.open(makeImagePath(name).c_str(), "r");
+    if (!file) {
+      return false;
+    }
+    size = file.size();
+    crc = Dedup::computeFileCrc(file);
+    file.close();
+    Dedup::contentIndex.addFile(name, size, crc);
+    return true;
+  }
+
+  // ==================== 内容去重 ====================
+  // 上传处理运行在 async_tcp 任务中，只记录流式算出的大小和CRC；
+  // 查重需要的补算哈希和逐字节比较（最多2MB）放到这里执行。
+
+  struct QueuedUpload
+  {
+    ImageName name;
+    bool hashKnown;   // 上传时已记录大小和CRC
+  };
+
+  static QueuedUpload uploadQueue[INGEST_UPLOAD_QUEUE_SIZE];
+  static uint8_t uploadQueued = 0;
+  static SemaphoreHandle_t queueMutex = nullptr;
+
+  static void lockQueue()
+  {
+    if (queueMutex) {
+      xSemaphoreTake(queueMutex, portMAX_DELAY);
+    }
+  }
+
+  static void unlockQueue()
+  {
+    if (queueMutex) {
+      xSemaphoreGive(queueMutex);
+    }
+  }
+
+  static bool takeUpload(QueuedUpload& upload)
+  {
+    lockQueue();
+    bool ok = uploadQueued > 0;
+    if (ok) {
+      upload = uploadQueue[0];
+      uploadQueued--;
+      for (uint8_t i = 0; i < uploadQueued; i++) {
+        uploadQueue[i] = uploadQueue[i + 1];
+      }
+    }
+    unlockQueue();
+    return ok;
+  }
+
+  // 与已有文件内容相同的新上传改为别名并删除数据，返回合并的数量
+  static uint16_t deduplicateUploads()
+  {
+    uint16_t merged = 0;
+    QueuedUpload upload;
+    while (takeUpload(upload)) {
+      const ImageName& name = upload.name;
+      uint32_t size, crc;
+      if (!contentOf(name.c_str(), size, crc, !upload.hashKnown)) {
+        continue;
+      }
+      ImagePath path = makeImagePath(name.c_str());
+      ImageName target;
+      if (Dedup::contentIndex.findDuplicate(path.c_str(), size, crc, target) &&
+          Dedup::contentIndex.convertToAlias(name.c_str(), target.c_str())) {
+        LittleFS.remove(path.c_str());
+        Serial.printf("Ingest: %s duplicates %s, stored as alias\n", name.c_str(), target.c_str());
+        merged++;
+      }
+    }
+    return merged;
+  }
+
+  // ==================== 转码任务 ====================
+
+  enum class TranscodeResult : uint8_t
+  {
+    OK,
+    FAILED,
+    PREEMPTED   // 渲染任务在等待解码器，本次已中止，稍后重试
+  };
+
+  static void makeCachePath(uint32_t size, uint32_t crc, ImagePath& path)
+  {
+    path.assign(INGEST_CACHE_PREFIX);
+    path.appendf("%08lx_%lx", (unsigned long)crc, (unsigned long)size);
+  }
+
+  // 确定 name 的转码目标路径；已转码过或无法转码时返回false
+  static bool resolveTarget(const char* name, ImagePath& targetPath)
+  {
+#if INGEST_KEEP_ORIGINAL
+    uint32_t size, crc;
+    if (!contentOf(name, size, crc)) {
+      return false;
+    }
+    makeCachePath(size, crc, targetPath);
+    return !LittleFS.exists(targetPath.c_str());
+#else
+    const char* dot = strrchr(name, '.');
+    targetPath = makeImagePath(name);
+    targetPath.truncate(targetPath.length() - strlen(dot));
+    targetPath.append(".r565");
+
+    // ".jpg" 换成 ".r565" 多一个字符，超出图片列表的文件名容量时保留原图
+    if (targetPath.length() - 1 > ImageName::capacity()) {
+      Serial.printf("Ingest: name too long for %s, skipping\n", name);
+      return false;
+    }
+    if (LittleFS.exists(targetPath.c_str())) {
+      Serial.printf("Ingest: %s already exists, skipping\n", targetPath.c_str());
+      return false;
+    }
+    return true;
+#endif
+  }
+
+  static TranscodeResult transcode(const char* name, const ImagePath& targetPath, bool allowPreempt)
+  {
+    ImagePath sourcePath = makeImagePath(name);
+
+    ImagePath tempPath;
+    tempPath.appendf(UPLOAD_TEMP_PREFIX "%08lx.r565", (unsigned long)esp_random());
+
+    uint16_t* strip = (uint16_t*)malloc((size_t)STRIP_MAX_ROWS * max(SCREEN_WIDTH, SCREEN_HEIGHT) * sizeof(uint16_t));
+    if (!strip) {
+      Serial.println("Ingest: failed to allocate strip buffer");
+      return TranscodeResult::FAILED;
+    }
+
+    unsigned long start = millis();
+    bool ok = false;
+    state.output = File();
+    state.preempted = false;
+
+    ImageDisplay::lockDecoder();
+
+    uint16_t w = 0, h = 0;
+    if (TJpgDec.getFsJpgSize(&w, &h, sourcePath.c_str(), LittleFS) == JDR_OK && w > 0 && h > 0) {
+      uint16_t dstW, dstH;
+      fitToScreen(w, h, dstW, dstH);
+
+      // 解码阶段尽量用TJpgDec的1/2/4/8缩放，剩余部分用最近邻缩小
+      uint8_t scale = 1;
+      while (scale < 8 && w / (scale * 2) >= dstW && h / (scale * 2) >= dstH) {
+        scale *= 2;
+      }
+
+      // 临时文件和目标同时存在，至少留出两份的空间
+      size_t outputBytes = RGB565_HEADER_SIZE + (size_t)dstW * dstH * sizeof(uint16_t);
+      if (LittleFS.totalBytes() - LittleFS.usedBytes() < outputBytes * 2) {
+        Serial.printf("Ingest: not enough free space for %s\n", name);
+      } else {
+        state.output = LittleFS.open(tempPath.c_str(), "w");
+      }
+      if (state.output) {
+        RGB565Header header;
+        memcpy(header.magic, "R565", 4);
+        header.width = dstW;
+        header.height = dstH;
+        state.output.write((const uint8_t*)&header, sizeof(header));
+
+        state.srcWidth = w / scale;
+        state.srcHeight = h / scale;
+        state.dstWidth = dstW;
+        state.dstHeight = dstH;
+        state.strip = strip;
+        state.stripY = -1;
+        state.stripRows = 0;
+        state.nextRow = 0;
+        state.writeFailed = false;
+        state.allowPreempt = allowPreempt;
+
+        TJpgDec.setJpgScale(scale);
+        TJpgDec.setCallback(ingestOutputCallback);
+        uint16_t result = TJpgDec.drawFsJpg(0, 0, sourcePath.c_str(), LittleFS);
+        if (!state.preempted) {
+          flushStrip();
+        }
+        TJpgDec.setCallback(ImageDisplay::ImageDisplayManager::jpegOutputCallback);
+        TJpgDec.setJpgScale(1);
+
+        ok = result == JDR_OK && !state.writeFailed && state.nextRow == dstH;
+        state.output.close();
+
+        if (state.preempted) {
+          Serial.printf("Ingest: %s yielded to render after %lu ms\n", name, millis() - start);
+        } else {
+          Serial.printf("Ingest: %s %ux%u -> %ux%u (1/%u), %s in %lu ms\n", name, w, h, dstW, dstH,
+                        scale, ok ? "ok" : "failed", millis() - start);
+        }
+      }
+    }
+
+    ImageDisplay::unlockDecoder();
+    free(strip);
+
+    if (!ok) {
+      LittleFS.remove(tempPath.c_str());
+      return state.preempted ? TranscodeResult::PREEMPTED : TranscodeResult::FAILED;
+    }
+
+    // 先把完整的新文件重命名到位，再处理原图；中途断电最多留下两份，不会丢图
+    if (!LittleFS.rename(tempPath.c_str(), targetPath.c_str())) {
+      LittleFS.remove(tempPath.c_str());
+      return TranscodeResult::FAILED;
+    }
+
+#if !INGEST_KEEP_ORIGINAL
+    LittleFS.remove(sourcePath.c_str());
+    // 保留上传内容的哈希，重复上传同一原图仍会被识别为别名
+    Dedup::contentIndex.renameFile(name, targetPath.c_str() + 1);
+    Playlist::playlistManager.renameImage(name, targetPath.c_str() + 1);
+#endif
+    return TranscodeResult::OK;
+  }
+
+  // 删除不再被任何图片引用的显示缓存（原图已删除，或已关闭 INGEST_KEEP_ORIGINAL）
+  static void removeOrphanCaches(const ImageName* caches, uint16_t count)
+  {
+    for (uint16_t i = 0; i < count; i++) {
+      unsigned long crc = 0, size = 0;
+      bool referenced = INGEST_KEEP_ORIGINAL &&
+                        sscanf(caches[i].c_str() + strlen(INGEST_CACHE_PREFIX) - 1, "%8lx_%lx", &crc, &size) == 2 &&
+                        Dedup::contentIndex.hasContent(size, crc);
+      if (!referenced) {
+        LittleFS.remove(makeImagePath(caches[i].c_str()).c_str());
+        Serial.printf("Ingest: removed unused cache %s\n", caches[i].c_str());
+      }
+    }
+  }
+
+  // 扫描根目录，返回本轮转码的文件数
+  static uint16_t processPending()
+  {
+    ImageName pending[MAX_IMAGES];
+    uint16_t pendingCount = 0;
+    ImageName caches[MAX_IMAGES];
+    uint16_t cacheCount = 0;
+
+    File root = LittleFS.open("/");
+    if (!root) {
+      return 0;
+    }
+    File file = root.openNextFile();
+    while (file) {
+      const char* fileName = file.name();
+      if (isHiddenFile(fileName)) {
+        if (cacheCount < MAX_IMAGES && strncmp(fileName, INGEST_CACHE_PREFIX + 1, strlen(INGEST_CACHE_PREFIX) - 1) == 0) {
+          caches[cacheCount++].assign(fileName);
+        }
+      } else if (pendingCount < MAX_IMAGES && strlen(fileName) <= ImageName::capacity() &&
+                 file.size() > INGEST_MIN_FILE_SIZE &&
+                 ImageDisplay::getImageFormat(fileName) == ImageDisplay::ImageFormat::JPEG &&
+                 !isFailed(fileName)) {
+        pending[pendingCount++].assign(fileName);
+      }
+      file = root.openNextFile();
+    }
+    root.close();
+
+    removeOrphanCaches(caches, cacheCount);
+
+    uint16_t converted = 0;
+    uint16_t i = 0;
+    uint8_t preemptions = 0;
+    while (i < pendingCount) {
+      ImagePath targetPath;
+      if (!resolveTarget(pending[i].c_str(), targetPath)) {
+        i++;
+        continue;
+      }
+
+      TranscodeResult result = transcode(pending[i].c_str(), targetPath, preemptions < INGEST_MAX_PREEMPTIONS);
+      if (result == TranscodeResult::PREEMPTED) {
+        // 等渲染任务拿到解码器并画完，再从头转码这张图
+        preemptions++;
+        vTaskDelay(pdMS_TO_TICKS(100));
+        continue;
+      }
+
+      if (result == TranscodeResult::OK) {
+        converted++;
+      } else {
+        markFailed(pending[i].c_str());
+      }
+      preemptions = 0;
+      i++;
+      // 两张图之间释放CPU，等待中的渲染可以先拿到解码器
+      vTaskDelay(1);
+    }
+    return converted;
+  }
+
+  static void ingestTaskMain(void*)
+  {
+    for (;;) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      busy = true;
+      // 先合并重复上传，重复的图片不必再转码
+      uint16_t merged = deduplicateUploads();
+      uint16_t converted = INGEST_ENABLED ? processPending() : 0;
+      busy = false;
+
+      if (merged > 0) {
+        WebServerManager::scanImages();
+      }
+
+      if (converted > 0) {
+        transcodedCount += converted;
+        Serial.printf("Ingest: %u image(s) transcoded\n", converted);
+#if !INGEST_KEEP_ORIGINAL
+        // 文件名已从 .jpg 变为 .r565
+        WebServerManager::scanImages();
+#endif
+      }
+    }
+  }
+
+  // ==================== 公共接口 ====================
+
+  bool findDisplayCache(const char* name, ImagePath& path)
+  {
+#if INGEST_ENABLED && INGEST_KEEP_ORIGINAL
+    uint32_t size, crc;
+    if (!name || !Dedup::contentIndex.lookup(name[0] == '/' ? name + 1 : name, size, crc)) {
+      return false;
+    }
+    makeCachePath(size, crc, path);
+    return LittleFS.exists(path.c_str());
+#else
+    return false;
+#endif
+  }
+
+  void begin()
+  {
+    // 去重也由本任务执行，关闭转码时任务仍然启动
+    if (ingestTask) {
+      return;
+    }
+    if (!queueMutex) {
+      queueMutex = xSemaphoreCreateMutex();
+    }
+    if (xTaskCreate(ingestTaskMain, "ingest", INGEST_TASK_STACK_SIZE, nullptr,
+                    INGEST_TASK_PRIORITY, &ingestTask) != pdPASS) {
+      Serial.println("Failed to start ingest task");
+      ingestTask = nullptr;
+      return;
+    }
+    // 启动时处理一次：旧固件上传的大图也会被转码，残留的无主缓存也会被清理
+    notify();
+  }
+
+  void notify()
+  {
+    if (ingestTask) {
+      xTaskNotifyGive(ingestTask);
+    }
+  }
+
+  void notifyUploaded(const char* name, bool hashKnown)
+  {
+    lockQueue();
+    if (uploadQueued < INGEST_UPLOAD_QUEUE_SIZE) {
+      QueuedUpload& upload = uploadQueue[uploadQueued++];
+      upload.name.assign(name[0] == '/' ? name + 1 : name);
+      upload.hashKnown = hashKnown;
+    } else {
+      Serial.printf("Ingest: upload queue full, %s not checked for duplicates\n", name);
+    }
+    unlockQueue();
+    notify();
+  }
+
+  bool isBusy()
+  {
+    return busy;
+  }
+
+  uint16_t getTranscodedCount()
+  {
+    return transcodedCount;
+  }
+}
@@ -0,0 +1,470 @@
+#include "PipelineBenchmark.h"
+#include "DisplayDriver.h"
+#include "DisplayPipeline.h"
+#include "ImageDisplay.h"
+#include "DecodeArena.h"
+#include "WebServer.h"
+#include "ImageCatalog.h"
+#include "ColorConvert.h"
+#include <LittleFS.h>
+#include <esp_rom_crc.h>
+
+namespace Benchmark
+{
+  using ImageDisplay::DisplayMode;
+
+  static const DisplayMode BENCH_MODES[] = {
+    DisplayMode::AUTO_ROTATE,
+    DisplayMode::SMART_SCALE,
+    DisplayMode::CENTER_CROP,
+    DisplayMode::FIT_SCREEN
+  };
+
+  static const char* modeName(DisplayMode mode)
+  {
+    switch (mode) {
+      case DisplayMode::AUTO_ROTATE: return "AUTO_ROTATE";
+      case DisplayMode::SMART_SCALE: return "SMART_SCALE";
+      case DisplayMode::CENTER_CROP: return "CENTER_CROP";
+      case DisplayMode::FIT_SCREEN:  return "FIT_SCREEN";
+    }
+    return "UNKNOWN";
+  }
+
+  // 语料文件列表（静态分配，不占用栈）
+  static ImageName corpus[MAX_IMAGES];
+
+  // 收集根目录下的图片并按文件名排序，保证每次运行的顺序一致
+  static uint16_t collectCorpus()
+  {
+    uint16_t count = 0;
+    File root = LittleFS.open("/");
+    if (!root) {
+      return 0;
+    }
+
+    File file = root.openNextFile();
+    while (file && count < MAX_IMAGES) {
+      if (!file.isDirectory() && !isHiddenFile(file.name()) &&
+          ImageDisplay::isValidImageFile(file.name())) {
+        corpus[count++].assign(file.name());
+      }
+      file = root.openNextFile();
+    }
+
+    for (uint16_t i = 1; i < count; i++) {
+      ImageName key = corpus[i];
+      int16_t j = i - 1;
+      while (j >= 0 && strcmp(corpus[j].c_str(), key.c_str()) > 0) {
+        corpus[j + 1] = corpus[j];
+        j--;
+      }
+      corpus[j + 1] = key;
+    }
+    return count;
+  }
+
+  // 文件内容CRC32，用于跨提交匹配同一张语料图片（上传时文件名可能被改写）
+  static uint32_t fileCrc32(const char* filename, uint32_t& size)
+  {
+    ImagePath path = makeImagePath(filename);
+    File file = LittleFS.open(path.c_str(), "r");
+    size = 0;
+    if (!file) {
+      return 0;
+    }
+
+    uint8_t buffer[256];
+    uint32_t crc = 0;
+    size_t n;
+    while ((n = file.read(buffer, sizeof(buffer))) > 0) {
+      crc = esp_rom_crc32_le(crc, buffer, n);
+      size += n;
+    }
+    file.close();
+    return crc;
+  }
+
+  static PipelineCaseResult runCase(const char* filename, DisplayMode mode, uint8_t rounds)
+  {
+    PipelineCaseResult result = {};
+    result.ok = true;
+    result.stable = true;
+    result.wallMinMicros = UINT32_MAX;
+
+    uint64_t wallTotal = 0;
+    ImageDisplay::imageDisplayManager.setOrientationMode(mode);
+
+    for (uint8_t round = 0; round < rounds; round++) {
+      // 先把之前的日志发完，避免串口阻塞计入本轮耗时
+      Serial.flush();
+
+      Display::displayManager.resetTransferStats(true);
+      uint32_t heapBefore = Display::displayManager.getTransferStats().minFreeHeap;
+
+      unsigned long start = micros();
+      bool ok = ImageDisplay::displayImage(filename);
+      uint32_t wall = micros() - start;
+
+      Display::TransferStats stats = Display::displayManager.getTransferStats();
+
+      result.ok = result.ok && ok;
+      wallTotal += wall;
+      if (wall < result.wallMinMicros) {
+        result.wallMinMicros = wall;
+      }
+
+      if (round == 0) {
+        result.bytes = stats.bytes;
+        result.transactions = stats.transactions;
+        result.windows = stats.windows;
+        result.checksum = stats.checksum;
+      } else if (stats.checksum != result.checksum) {
+        result.stable = false;
+      }
+
+      uint32_t used = heapBefore - stats.minFreeHeap;
+      if (used > result.peakHeapUsed) {
+        result.peakHeapUsed = used;
+      }
+    }
+
+    result.wallAvgMicros = rounds > 0 ? (uint32_t)(wallTotal / rounds) : 0;
+    return result;
+  }
+
+  uint16_t runPipelineBenchmark(uint8_t rounds)
+  {
+    if (rounds == 0) {
+      rounds = 1;
+    }
+
+    uint16_t fileCount = collectCorpus();
+    if (fileCount == 0) {
+      Serial.println("Pipeline benchmark: no images in LittleFS, upload a corpus first");
+      return 0;
+    }
+
+    Serial.printf("BENCH_BEGIN {\"driver\":\"%s\",\"spi_frequency\":%lu,\"rounds\":%u,\"files\":%u,\"arena_size\":%u}\n",
+                  Display::displayManager.getCurrentDriverName(),
+                  (unsigned long)Display::displayManager.getSPIFrequency(),
+                  rounds, fileCount, (unsigned)Memory::decodeArena.capacity());
+
+    uint16_t cases = 0;
+    uint16_t failures = 0;
+    uint64_t totalMicros = 0;
+
+    for (uint16_t i = 0; i < fileCount; i++) {
+      const char* filename = corpus[i].c_str();
+      uint32_t fileSize = 0;
+      uint32_t crc = fileCrc32(filename, fileSize);
+
+      for (DisplayMode mode : BENCH_MODES) {
+        PipelineCaseResult r = runCase(filename, mode, rounds);
+
+        Serial.printf("BENCH {\"file\":\"%s\",\"file_crc\":\"%08lx\",\"file_size\":%lu,\"mode\":\"%s\","
+                      "\"ok\":%s,\"wall_min_us\":%lu,\"wall_avg_us\":%lu,\"bytes\":%lu,"
+                      "\"transactions\":%lu,\"windows\":%lu,\"peak_heap\":%lu,"
+                      "\"checksum\":\"%08lx\",\"stable\":%s}\n",
+                      filename, (unsigned long)crc, (unsigned long)fileSize, modeName(mode),
+                      r.ok ? "true" : "false",
+                      (unsigned long)r.wallMinMicros, (unsigned long)r.wallAvgMicros,
+                      (unsigned long)r.bytes, (unsigned long)r.transactions,
+                      (unsigned long)r.windows, (unsigned long)r.peakHeapUsed,
+                      (unsigned long)r.checksum, r.stable ? "true" : "false");
+
+        cases++;
+        totalMicros += r.wallMinMicros;
+        if (!r.ok) failures++;
+      }
+    }
+
+    // 恢复默认显示模式并关闭逐像素统计
+    ImageDisplay::imageDisplayManager.setOrientationMode(DisplayMode::SMART_SCALE);
+    Display::displayManager.resetTransferStats(false);
+
+    Memory::HeapStats heap = Memory::getHeapStats();
+    Serial.printf("BENCH_END {\"cases\":%u,\"failures\":%u,\"total_min_us\":%lu,"
+                  "\"arena_high_water\":%u,\"min_free_heap\":%lu}\n",
+                  cases, failures, (unsigned long)totalMicros,
+                  (unsigned)Memory::decodeArena.highWater(), (unsigned long)heap.minFreeHeap);
+    return cases;
+  }
+
+  // ==================== 颜色转换基准测试 ====================
+
+  template <class Src>
+  static uint32_t timeConversion(void (*convert)(const Src*, uint16_t*, size_t),
+                                 const Src* src, uint16_t* dst, uint16_t rounds)
+  {
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < rounds; i++) {
+      convert(src, dst, COLOR_BENCHMARK_PIXELS);
+    }
+    return micros() - start;
+  }
+
+  template <class Src>
+  static void runColorCase(const char* name, void (*kernel)(const Src*, uint16_t*, size_t),
+                           void (*reference)(const Src*, uint16_t*, size_t),
+                           const Src* src, uint16_t* out, uint16_t* expected, uint16_t rounds)
+  {
+    uint32_t scalarMicros = timeConversion(reference, src, expected, rounds);
+    uint32_t kernelMicros = timeConversion(kernel, src, out, rounds);
+    bool match = memcmp(out, expected, COLOR_BENCHMARK_PIXELS * sizeof(uint16_t)) == 0;
+
+    float pixels = (float)COLOR_BENCHMARK_PIXELS * rounds;
+    Serial.printf("BENCH_COLOR {\"conversion\":\"%s\",\"kernel\":\"%s\",\"pixels\":%lu,"
+                  "\"scalar_mpps\":%.2f,\"kernel_mpps\":%.2f,\"match\":%s}\n",
+                  name, Color::kernelName(), (unsigned long)pixels,
+                  scalarMicros ? pixels / scalarMicros : 0.0f,
+                  kernelMicros ? pixels / kernelMicros : 0.0f,
+                  match ? "true" : "false");
+  }
+
+  void runColorBenchmark(uint16_t rounds)
+  {
+    if (rounds == 0) {
+      rounds = 1;
+    }
+
+    // 源数据按最大的32位像素分配，24位和16位用例复用同一块缓冲区
+    Memory::ArenaScope scratch(Memory::decodeArena);
+    uint32_t* src = (uint32_t*)scratch.allocate(COLOR_BENCHMARK_PIXELS * sizeof(uint32_t));
+    uint16_t* out = (uint16_t*)scratch.allocate(COLOR_BENCHMARK_PIXELS * sizeof(uint16_t));
+    uint16_t* expected = (uint16_t*)scratch.allocate(COLOR_BENCHMARK_PIXELS * sizeof(uint16_t));
+    if (!src || !out || !expected) {
+      Serial.println("Color benchmark skipped: decode arena too small");
+      return;
+    }
+
+    uint32_t seed = 0x12345678u;
+    for (uint16_t i = 0; i < COLOR_BENCHMARK_PIXELS; i++) {
+      seed = seed * 1664525u + 1013904223u;
+      src[i] = seed;
+    }
+
+    runColorCase<uint8_t>("bgr888_rgb565", Color::bgr888ToRgb565, Color::Scalar::bgr888ToRgb565,
+                          (const uint8_t*)src, out, expected, rounds);
+    runColorCase<uint32_t>("xrgb8888_rgb565", Color::xrgb8888ToRgb565, Color::Scalar::xrgb8888ToRgb565,
+                           src, out, expected, rounds);
+    runColorCase<uint16_t>("swap_rgb565", Color::swapBytes565, Color::Scalar::swapBytes565,
+                           (const uint16_t*)src, out, expected, rounds);
+  }
+
+  // ==================== 设备端基准测试任务 ====================
+
+  static volatile BenchJobState jobState = BenchJobState::IDLE;
+  static BenchSource jobSource = BenchSource::CATALOG;
+  static uint8_t jobIterations = 1;
+  static bool jobStaticPipeline = true;
+  static BenchJobResult jobResult = {};
+
+  // 单帧样本（静态分配）
+  static uint32_t decodeSamples[BENCH_JOB_MAX_SAMPLES];
+  static uint32_t transferSamples[BENCH_JOB_MAX_SAMPLES];
+  static uint32_t totalSamples[BENCH_JOB_MAX_SAMPLES];
+
+  bool queueBenchJob(BenchSource source, uint8_t iterations, bool staticPipeline)
+  {
+    if (jobState == BenchJobState::QUEUED || jobState == BenchJobState::RUNNING) {
+      return false;
+    }
+
+    if (iterations < 1) iterations = 1;
+    if (iterations > BENCH_JOB_MAX_ITERATIONS) iterations = BENCH_JOB_MAX_ITERATIONS;
+
+    jobSource = source;
+    jobIterations = iterations;
+    jobStaticPipeline = staticPipeline;
+    jobState = BenchJobState::QUEUED;
+    return true;
+  }
+
+  BenchJobState getBenchJobState()
+  {
+    return jobState;
+  }
+
+  const BenchJobResult& getBenchJobResult()
+  {
+    return jobResult;
+  }
+
+  static void sortSamples(uint32_t* samples, uint16_t count)
+  {
+    for (uint16_t i = 1; i < count; i++) {
+      uint32_t key = samples[i];
+      int16_t j = i - 1;
+      while (j >= 0 && samples[j] > key) {
+        samples[j + 1] = samples[j];
+        j--;
+      }
+      samples[j + 1] = key;
+    }
+  }
+
+  static TimingSummary summarize(uint32_t* samples, uint16_t count)
+  {
+    TimingSummary summary = {};
+    if (count == 0) {
+      return summary;
+    }
+
+    sortSamples(samples, count);
+    summary.min = samples[0];
+    summary.median = samples[count / 2];
+    summary.p99 = samples[(count * 99 + 99) / 100 - 1];
+    return summary;
+  }
+
+  // 内置测试图案：按条带生成后整帧写入，"解码"时间即图案生成时间
+  template <class Sink>
+  static bool renderSyntheticPattern(uint8_t pattern)
+  {
+    const int16_t width = Sink::width();
+    const int16_t height = Sink::height();
+    const uint16_t stripRows = 16;
+
+    Memory::ArenaScope scratch(Memory::decodeArena);
+    uint16_t* strip = (uint16_t*)scratch.allocate((uint32_t)width * stripRows * sizeof(uint16_t));
+    if (!strip) {
+      return false;
+    }
+
+    uint32_t seed = 0x12345678u + pattern;
+    Sink::beginFrame();
+    for (int16_t y0 = 0; y0 < height; y0 += stripRows) {
+      uint16_t rows = (height - y0 < stripRows) ? (height - y0) : stripRows;
+
+      for (uint16_t r = 0; r < rows; r++) {
+        uint16_t* line = strip + r * width;
+        int16_t y = y0 + r;
+        for (int16_t x = 0; x < width; x++) {
+          switch (pattern) {
+            case 0: // 渐变
+              line[x] = ((x * 31 / width) << 11) | ((y * 63 / height) << 5) | (31 - x * 31 / width);
+              break;
+            case 1: // 棋盘格
+              line[x] = (((x >> 3) ^ (y >> 3)) & 1) ? 0xFFFF : 0x0000;
+              break;
+            case 2: // 彩条
+              {
+                static const uint16_t bars[] = { 0xFFFF, 0xFFE0, 0x07FF, 0x07E0, 0xF81F, 0xF800, 0x001F, 0x0000 };
+                line[x] = bars[x * 8 / width];
+              }
+              break;
+            default: // 噪声（线性同余）
+              seed = seed * 1664525u + 1013904223u;
+              line[x] = seed >> 16;
+              break;
+          }
+        }
+      }
+
+      Sink::pushImage(0, y0, width, rows, strip);
+    }
+    Sink::endFrame();
+    return true;
+  }
+
+  static void runBenchJob(BenchSource source, uint8_t iterations)
+  {
+    BenchJobResult result = {};
+    result.source = source;
+    result.iterations = iterations;
+    result.spiFrequency = Display::displayManager.getSPIFrequency();
+    result.heapLowWater = UINT32_MAX;
+
+    // 图片渲染（displayImage）同样按此开关选择像素写入路径，测试结束后恢复
+    Display::displayManager.setStaticPipelineEnabled(jobStaticPipeline);
+    result.staticPipeline = Display::staticPipelineActive();
+
+    const uint8_t SYNTHETIC_PATTERNS = 4;
+    uint16_t frameCount = source == BenchSource::SYNTHETIC
+      ? SYNTHETIC_PATTERNS
+      : (uint16_t)::WebServerManager::getImageCount();
+
+    uint16_t samples = 0;
+    uint64_t totalTransferMicros = 0;
+    unsigned long jobStart = millis();
+
+    Serial.printf("Bench job: %s, %u frame(s) x %u\n",
+                  source == BenchSource::SYNTHETIC ? "synthetic" : "catalog", frameCount, iterations);
+
+    for (uint8_t iter = 0; iter < iterations; iter++) {
+      for (uint16_t i = 0; i < frameCount; i++) {
+        Display::displayManager.resetTransferStats(true);
+
+        unsigned long start = micros();
+        bool ok;
+        if (source == BenchSource::SYNTHETIC) {
+          ok = result.staticPipeline ? renderSyntheticPattern<Display::StaticSink>(i)
+                                     : renderSyntheticPattern<Display::ManagerSink>(i);
+        } else {
+          // 从当前快照复制文件名，渲染期间列表可能被重新扫描
+          ImageName name;
+          {
+            Catalog::SnapshotRef snapshot;
+            if (i < snapshot->count) {
+              name = snapshot->names[i];
+            }
+          }
+          ok = !name.isEmpty() && ImageDisplay::displayImage(name.c_str());
+        }
+        uint32_t total = micros() - start;
+
+        Display::TransferStats stats = Display::displayManager.getTransferStats();
+        uint32_t transfer = stats.transferMicros < total ? stats.transferMicros : total;
+
+        result.frames++;
+        if (!ok) result.failures++;
+        result.bytes += stats.bytes;
+        totalTransferMicros += transfer;
+        if (stats.minFreeHeap < result.heapLowWater) {
+          result.heapLowWater = stats.minFreeHeap;
+        }
+
+        if (samples < BENCH_JOB_MAX_SAMPLES) {
+          decodeSamples[samples] = total - transfer;
+          transferSamples[samples] = transfer;
+          totalSamples[samples] = total;
+          samples++;
+        }
+
+        // 让出CPU，避免长时间占用导致空闲任务看门狗超时
+        delay(1);
+      }
+    }
+
+    Display::displayManager.resetTransferStats(false);
+    Display::displayManager.setStaticPipelineEnabled(true);
+
+    result.decode = summarize(decodeSamples, samples);
+    result.transfer = summarize(transferSamples, samples);
+    result.total = summarize(totalSamples, samples);
+    result.spiMBps = totalTransferMicros > 0 ? (float)result.bytes / totalTransferMicros : 0.0f;
+    result.elapsedMillis = millis() - jobStart;
+    if (result.heapLowWater == UINT32_MAX) {
+      result.heapLowWater = Memory::getHeapStats().freeHeap;
+    }
+
+    jobResult = result;
+
+    Serial.printf("Bench job done (%s pipeline): %u frames, total median %lu us, SPI %.2f MB/s\n",
+                  result.staticPipeline ? "static" : "runtime",
+                  result.frames, (unsigned long)result.total.median, result.spiMBps);
+  }
+
+  bool serviceBenchJob()
+  {
+    if (jobState != BenchJobState::QUEUED) {
+      return false;
+    }
+
+    jobState = BenchJobState::RUNNING;
+    runBenchJob(jobSource, jobIterations);
+    jobState = BenchJobState::DONE;
+    return true;
+  }
+}
@@ -0,0 +1,466 @@
+#include "Playlist.h"
+#include <ArduinoJson.h>
+
+namespace Playlist
+{
+  PlaylistManager playlistManager;
+
+  // ==================== 文件格式 ====================
+  // 文件头 + 每个播放列表（列表头 + itemCount 条条目），名称按定长存放
+
+  static const uint32_t PLAYLIST_MAGIC = 0x54534C50; // "PLST"
+  static const uint8_t PLAYLIST_VERSION = 2;
+
+  struct FileHeader
+  {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t count;
+    int8_t active;
+    uint8_t reserved;
+  } __attribute__((packed));
+
+  struct StoredPlaylist
+  {
+    char name[16];
+    uint8_t shuffle;
+    uint8_t reserved;
+    uint16_t cursor;
+    uint16_t itemCount;
+    uint32_t seed;
+  } __attribute__((packed));
+
+  // 版本1的列表头（游标和条目数为 uint8_t），读取后按当前版本保存
+  struct StoredPlaylistV1
+  {
+    char name[16];
+    uint8_t shuffle;
+    uint8_t cursor;
+    uint8_t itemCount;
+    uint8_t reserved;
+    uint32_t seed;
+  } __attribute__((packed));
+
+  struct StoredItem
+  {
+    char name[MAX_FILENAME_LENGTH];
+    uint16_t dwellSeconds;
+  } __attribute__((packed));
+
+  template <size_t N>
+  static void copyName(char* dst, size_t size, const StaticString<N>& name)
+  {
+    memset(dst, 0, size);
+    memcpy(dst, name.c_str(), min(name.length(), size - 1));
+  }
+
+  // xorshift32：种子相同则序列相同
+  static inline uint32_t nextRandom(uint32_t& state)
+  {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  // [0, bound) 内均匀分布的随机数：2^32 不能被 bound 整除时，
+  // 丢弃落在最低 2^32 mod bound 个值上的结果，直接取模会偏向较小的下标
+  static inline uint32_t boundedRandom(uint32_t& state, uint32_t bound)
+  {
+    uint32_t threshold = (0u - bound) % bound;
+    uint32_t value;
+    do {
+      value = nextRandom(state);
+    } while (value < threshold);
+    return value % bound;
+  }
+
+  void PlaylistData::buildOrder()
+  {
+    for (uint16_t i = 0; i < itemCount; i++) {
+      order[i] = i;
+    }
+    if (!shuffle || itemCount < 2) {
+      return;
+    }
+
+    uint32_t state = seed ? seed : 0x9E3779B9;
+    for (uint16_t i = itemCount - 1; i > 0; i--) {
+      uint16_t j = boundedRandom(state, i + 1);
+      uint16_t tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+  }
+
+  // ==================== PlaylistManager 实现 ====================
+
+  void PlaylistManager::lock()
+  {
+    if (mutex) {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+  }
+
+  void PlaylistManager::unlock()
+  {
+    if (mutex) {
+      xSemaphoreGive(mutex);
+    }
+  }
+
+  void PlaylistManager::begin()
+  {
+    if (!mutex) {
+      mutex = xSemaphoreCreateMutex();
+    }
+
+    lock();
+    count = 0;
+    active = -1;
+    if (load()) {
+      Serial.printf("Loaded %u playlist(s), active: %s\n", count, active >= 0 ? playlists[active].name.c_str() : "none");
+    }
+    unlock();
+  }
+
+  bool PlaylistManager::load()
+  {
+    File file = LittleFS.open(PLAYLIST_PATH, "r");
+    if (!file) {
+      return false;
+    }
+
+    FileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != PLAYLIST_MAGIC || (header.version != PLAYLIST_VERSION && header.version != 1) ||
+        header.count > PLAYLIST_MAX) {
+      Serial.println("Playlist file corrupt, ignoring");
+      file.close();
+      return false;
+    }
+
+    bool ok = true;
+    for (uint8_t p = 0; ok && p < header.count; p++) {
+      StoredPlaylist stored;
+      if (header.version == 1) {
+        StoredPlaylistV1 old;
+        ok = file.read((uint8_t*)&old, sizeof(old)) == sizeof(old);
+        memcpy(stored.name, old.name, sizeof(stored.name));
+        stored.shuffle = old.shuffle;
+        stored.cursor = old.cursor;
+        stored.itemCount = old.itemCount;
+        stored.seed = old.seed;
+      } else {
+        ok = file.read((uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+      }
+      ok = ok && stored.itemCount <= PLAYLIST_MAX_ITEMS;
+      if (!ok) break;
+
+      PlaylistData& playlist = playlists[count];
+      playlist.name.assign(stored.name, strnlen(stored.name, sizeof(stored.name)));
+      playlist.shuffle = stored.shuffle;
+      playlist.seed = stored.seed;
+      playlist.itemCount = 0;
+
+      for (uint16_t i = 0; ok && i < stored.itemCount; i++) {
+        StoredItem item;
+        ok = file.read((uint8_t*)&item, sizeof(item)) == sizeof(item);
+        if (!ok) break;
+        PlaylistItem& target = playlist.items[playlist.itemCount];
+        target.name.assign(item.name, strnlen(item.name, sizeof(item.name)));
+        target.dwellSeconds = item.dwellSeconds;
+        playlist.resolved[playlist.itemCount] = -1;
+        playlist.itemCount++;
+      }
+      if (!ok) break;
+
+      playlist.buildOrder();
+      playlist.cursor = stored.cursor < playlist.itemCount ? stored.cursor : 0;
+      count++;
+    }
+    file.close();
+
+    active = (ok && header.active < (int8_t)count) ? header.active : -1;
+    return ok;
+  }
+
+  bool PlaylistManager::saveFile()
+  {
+    // 先写临时文件再重命名，断电时保留旧文件
+    static const char* tempPath = PLAYLIST_PATH ".tmp";
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) {
+      Serial.println("Failed to write playlists");
+      return false;
+    }
+
+    FileHeader header = {PLAYLIST_MAGIC, PLAYLIST_VERSION, count, active, 0};
+    bool ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+    for (uint8_t p = 0; ok && p < count; p++) {
+      const PlaylistData& playlist = playlists[p];
+      StoredPlaylist stored;
+      copyName(stored.name, sizeof(stored.name), playlist.name);
+      stored.shuffle = playlist.shuffle;
+      stored.reserved = 0;
+      stored.cursor = playlist.cursor;
+      stored.itemCount = playlist.itemCount;
+      stored.seed = playlist.seed;
+      ok = file.write((const uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+
+      for (uint16_t i = 0; ok && i < playlist.itemCount; i++) {
+        StoredItem item;
+        copyName(item.name, sizeof(item.name), playlist.items[i].name);
+        item.dwellSeconds = playlist.items[i].dwellSeconds;
+        ok = file.write((const uint8_t*)&item, sizeof(item)) == sizeof(item);
+      }
+    }
+    file.close();
+
+    if (!ok || !LittleFS.rename(tempPath, PLAYLIST_PATH)) {
+      Serial.println("Failed to write playlists");
+      LittleFS.remove(tempPath);
+      return false;
+    }
+    return true;
+  }
+
+  int PlaylistManager::find(const char* name) const
+  {
+    for (uint8_t i = 0; i < count; i++) {
+      if (playlists[i].name == name) return i;
+    }
+    return -1;
+  }
+
+  bool PlaylistManager::save(const char* name, const PlaylistItem* items, uint16_t itemCount, bool shuffle, uint32_t seed)
+  {
+    if (!name || !name[0] || strlen(name) > PlaylistName::capacity() || itemCount > PLAYLIST_MAX_ITEMS) {
+      return false;
+    }
+
+    lock();
+    int index = find(name);
+    if (index < 0 && count < PLAYLIST_MAX) {
+      index = count++;
+    }
+    bool ok = index >= 0;
+    if (ok) {
+      PlaylistData& playlist = playlists[index];
+      playlist.name.assign(name);
+      playlist.shuffle = shuffle;
+      playlist.seed = seed;
+      playlist.itemCount = itemCount;
+      for (uint16_t i = 0; i < itemCount; i++) {
+        playlist.items[i] = items[i];
+        playlist.resolved[i] = -1;
+      }
+      playlist.cursor = 0;
+      playlist.buildOrder();
+      ok = saveFile();
+    }
+    unlock();
+    return ok;
+  }
+
+  bool PlaylistManager::remove(const char* name)
+  {
+    lock();
+    int index = find(name);
+    if (index >= 0) {
+      for (uint8_t i = index; i + 1 < count; i++) {
+        playlists[i] = playlists[i + 1];
+      }
+      count--;
+      if (active == index) {
+        active = -1;
+      } else if (active > index) {
+        active--;
+      }
+      saveFile();
+    }
+    unlock();
+    return index >= 0;
+  }
+
+  bool PlaylistManager::activate(const char* name)
+  {
+    lock();
+    int index = (name && name[0]) ? find(name) : -1;
+    bool ok = index >= 0 || !(name && name[0]);
+    if (ok) {
+      active = index;
+      saveFile();
+    }
+    unlock();
+    return ok;
+  }
+
+  const char* PlaylistManager::activeName() const
+  {
+    return active >= 0 ? playlists[active].name.c_str() : "";
+  }
+
+  void PlaylistManager::resolve(const ImageName* images, int imageCount)
+  {
+    lock();
+    for (uint8_t p = 0; p < count; p++) {
+      PlaylistData& playlist = playlists[p];
+      for (uint16_t i = 0; i < playlist.itemCount; i++) {
+        playlist.resolved[i] = -1;
+        for (int j = 0; j < imageCount; j++) {
+          if (images[j] == playlist.items[i].name) {
+            playlist.resolved[i] = j;
+            break;
+          }
+        }
+      }
+    }
+    unlock();
+  }
+
+  void PlaylistManager::renameImage(const char* from, const char* to)
+  {
+    lock();
+    bool changed = false;
+    for (uint8_t p = 0; p < count; p++) {
+      for (uint16_t i = 0; i < playlists[p].itemCount; i++) {
+        if (playlists[p].items[i].name == from) {
+          playlists[p].items[i].name.assign(to);
+          changed = true;
+        }
+      }
+    }
+    if (changed) {
+      saveFile();
+    }
+    unlock();
+  }
+
+  int PlaylistManager::step(int direction)
+  {
+    if (active < 0) {
+      return -1;
+    }
+    PlaylistData& playlist = playlists[active];
+
+    // 跳过已被删除的条目，最多走一整轮
+    for (uint16_t tries = 0; tries < playlist.itemCount; tries++) {
+      if (direction > 0) {
+        if (++playlist.cursor >= playlist.itemCount) {
+          playlist.cursor = 0;
+          // 随机播放每轮换一个排列
+          if (playlist.shuffle) {
+            playlist.seed++;
+            playlist.buildOrder();
+          }
+        }
+      } else {
+        playlist.cursor = playlist.cursor ? playlist.cursor - 1 : playlist.itemCount - 1;
+      }
+
+      int index = playlist.resolved[playlist.order[playlist.cursor]];
+      if (index >= 0) {
+        return index;
+      }
+    }
+    return -1;
+  }
+
+  int PlaylistManager::next()
+  {
+    lock();
+    int index = step(1);
+    unlock();
+    return index;
+  }
+
+  int PlaylistManager::previous()
+  {
+    lock();
+    int index = step(-1);
+    unlock();
+    return index;
+  }
+
+  int PlaylistManager::peekNext()
+  {
+    lock();
+    int index = -1;
+    if (active >= 0) {
+      PlaylistData& playlist = playlists[active];
+      uint16_t cursor = playlist.cursor;
+      uint32_t seed = playlist.seed;
+      index = step(1);
+      // 走过一轮末尾时 step 会换种子重排，恢复原来的排列
+      playlist.cursor = cursor;
+      if (playlist.seed != seed) {
+        playlist.seed = seed;
+        playlist.buildOrder();
+      }
+    }
+    unlock();
+    return index;
+  }
+
+  int PlaylistManager::current()
+  {
+    lock();
+    int index = -1;
+    if (active >= 0 && playlists[active].itemCount > 0) {
+      PlaylistData& playlist = playlists[active];
+      index = playlist.resolved[playlist.order[playlist.cursor]];
+      if (index < 0) {
+        index = step(1);
+      }
+    }
+    unlock();
+    return index;
+  }
+
+  unsigned long PlaylistManager::currentDwell(unsigned long defaultInterval)
+  {
+    lock();
+    unsigned long dwell = defaultInterval;
+    if (active >= 0 && playlists[active].itemCount > 0) {
+      const PlaylistData& playlist = playlists[active];
+      uint16_t seconds = playlist.items[playlist.order[playlist.cursor]].dwellSeconds;
+      if (seconds > 0) {
+        dwell = seconds * 1000UL;
+      }
+    }
+    unlock();
+    return dwell;
+  }
+
+  String PlaylistManager::toJson()
+  {
+    JsonDocument doc;
+
+    lock();
+    doc["status"] = "ok";
+    doc["active"] = activeName();
+    JsonArray list = doc["playlists"].to<JsonArray>();
+    for (uint8_t p = 0; p < count; p++) {
+      const PlaylistData& playlist = playlists[p];
+      JsonObject entry = list.add<JsonObject>();
+      entry["name"] = playlist.name.c_str();
+      entry["shuffle"] = playlist.shuffle;
+      entry["seed"] = playlist.seed;
+      entry["cursor"] = playlist.cursor;
+      JsonArray items = entry["items"].to<JsonArray>();
+      for (uint16_t i = 0; i < playlist.itemCount; i++) {
+        JsonObject item = items.add<JsonObject>();
+        item["name"] = playlist.items[i].name.c_str();
+        item["dwell"] = playlist.items[i].dwellSeconds;
+        item["missing"] = playlist.resolved[i] < 0;
+      }
+    }
+    unlock();
+
+    String result;
+    serializeJson(doc, result);
+    return result;
+  }
+}
@@ -0,0 +1,473 @@
+#include "ResumableUpload.h"
+#include <esp_rom_crc.h>
+
+namespace Upload
+{
+  // 全局断点续传管理器实例
+  ResumableUploadManager resumableUploads;
+
+  const char* resultMessage(UploadResult result)
+  {
+    switch (result) {
+      case UploadResult::OK:           return "ok";
+      case UploadResult::NOT_FOUND:    return "Upload session not found or expired";
+      case UploadResult::INVALID:      return "Invalid file name, size or image content";
+      case UploadResult::TOO_LARGE:    return "File too large";
+      case UploadResult::NO_SLOT:      return "Too many uploads in progress";
+      case UploadResult::BAD_OFFSET:   return "Offset must be a multiple of chunk_size and inside the file";
+      case UploadResult::BAD_LENGTH:   return "Chunk length does not match chunk_size";
+      case UploadResult::CRC_MISMATCH: return "CRC32 mismatch";
+      case UploadResult::INCOMPLETE:   return "Not all chunks received";
+      case UploadResult::BUSY:         return "Another chunk of this upload is in progress";
+      case UploadResult::IO_ERROR:     return "File system error";
+    }
+    return "unknown";
+  }
+
+  // ==================== UploadSession 实现 ====================
+
+  uint32_t UploadSession::receivedBytes() const
+  {
+    uint32_t total = 0;
+    uint16_t count = chunkCount();
+    for (uint16_t i = 0; i < count; i++) {
+      if (hasChunk(i)) {
+        uint32_t start = (uint32_t)i * UPLOAD_CHUNK_SIZE;
+        total += (size - start < UPLOAD_CHUNK_SIZE) ? size - start : UPLOAD_CHUNK_SIZE;
+      }
+    }
+    return total;
+  }
+
+  bool UploadSession::isComplete() const
+  {
+    uint16_t count = chunkCount();
+    for (uint16_t i = 0; i < count; i++) {
+      if (!hasChunk(i)) return false;
+    }
+    return true;
+  }
+
+  bool UploadSession::isChunkBusy(const void* owner) const
+  {
+    return chunkInFlight && chunkOwner != owner && millis() - lastActivity < UPLOAD_CHUNK_STALL_MS;
+  }
+
+  uint8_t UploadSession::getRanges(ByteRange* ranges, uint8_t maxRanges) const
+  {
+    uint8_t n = 0;
+    uint16_t count = chunkCount();
+    uint16_t i = 0;
+
+    while (i < count && n < maxRanges) {
+      if (!hasChunk(i)) {
+        i++;
+        continue;
+      }
+      uint16_t first = i;
+      while (i < count && hasChunk(i)) i++;
+
+      ranges[n].start = (uint32_t)first * UPLOAD_CHUNK_SIZE;
+      ranges[n].end = (uint32_t)i * UPLOAD_CHUNK_SIZE;
+      if (ranges[n].end > size) ranges[n].end = size;
+      n++;
+    }
+    return n;
+  }
+
+  // ==================== ResumableUploadManager 实现 ====================
+
+  UploadSession* ResumableUploadManager::allocateSession()
+  {
+    unsigned long now = millis();
+    UploadSession* oldest = nullptr;
+
+    for (uint8_t i = 0; i < UPLOAD_MAX_SESSIONS; i++) {
+      UploadSession& session = sessions[i];
+      if (!session.active) {
+        return &session;
+      }
+      if (now - session.lastActivity > UPLOAD_SESSION_TIMEOUT_MS &&
+          (!oldest || session.lastActivity < oldest->lastActivity)) {
+        oldest = &session;
+      }
+    }
+
+    // 没有空槽时回收最久未活动的过期会话
+    if (oldest) {
+      Serial.printf("Upload session %08lx expired\n", (unsigned long)oldest->id);
+      releaseSession(*oldest, true);
+    }
+    return oldest;
+  }
+
+  void ResumableUploadManager::releaseSession(UploadSession& session, bool removeFile)
+  {
+    if (session.chunkFile) {
+      session.chunkFile.close();
+    }
+    if (removeFile && !session.tempPath.isEmpty()) {
+      LittleFS.remove(session.tempPath.c_str());
+    }
+    session.active = false;
+    session.tempPath.clear();
+  }
+
+  UploadResult ResumableUploadManager::init(const char* name, uint32_t size, bool hasFileCrc,
+                                            uint32_t fileCrc, uint32_t& id)
+  {
+    if (!name || !hasImageExtension(name) || size == 0) {
+      return UploadResult::INVALID;
+    }
+    if (size > MAX_FILE_SIZE) {
+      return UploadResult::TOO_LARGE;
+    }
+
+    UploadSession* session = allocateSession();
+    if (!session) {
+      return UploadResult::NO_SLOT;
+    }
+
+    // 会话ID同时用作临时文件名，避免冲突
+    do {
+      id = esp_random();
+    } while (id == 0 || find(id));
+
+    session->id = id;
+    session->name.assign(name);
+    session->size = size;
+    session->hasFileCrc = hasFileCrc;
+    session->fileCrc = fileCrc;
+    memset(session->received, 0, sizeof(session->received));
+    session->chunkLength = 0;
+    session->chunkOwner = nullptr;
+    session->chunkInFlight = false;
+    session->chunkResult = UploadResult::OK;
+    session->lastActivity = millis();
+
+    session->tempPath.clear();
+    session->tempPath.appendf(UPLOAD_TEMP_PREFIX "%08lx%s", (unsigned long)id, strrchr(name, '.'));
+
+    File file = LittleFS.open(session->tempPath.c_str(), "w");
+    if (!file) {
+      Serial.printf("Failed to create upload temp file: %s\n", session->tempPath.c_str());
+      session->tempPath.clear();
+      return UploadResult::IO_ERROR;
+    }
+    file.close();
+
+    session->active = true;
+    Serial.printf("Upload session %08lx: %s, %lu bytes, %u chunks\n",
+                  (unsigned long)id, name, (unsigned long)size, session->chunkCount());
+    return UploadResult::OK;
+  }
+
+  UploadSession* ResumableUploadManager::find(uint32_t id)
+  {
+    for (uint8_t i = 0; i < UPLOAD_MAX_SESSIONS; i++) {
+      if (sessions[i].active && sessions[i].id == id) {
+        return &sessions[i];
+      }
+    }
+    return nullptr;
+  }
+
+  UploadResult ResumableUploadManager::beginChunk(uint32_t id, const void* owner, uint32_t offset,
+                                                  uint32_t length, uint32_t crc)
+  {
+    UploadSession* session = find(id);
+    if (!session) {
+      return UploadResult::NOT_FOUND;
+    }
+    // 不能让第二个请求覆盖正在传输的分块状态
+    if (session->isChunkBusy(owner)) {
+      return UploadResult::BUSY;
+    }
+
+    // 上一个分块中途断开时，丢弃它的文件句柄
+    if (session->chunkFile) {
+      session->chunkFile.close();
+    }
+
+    session->lastActivity = millis();
+    session->chunkOwner = owner;
+    session->chunkInFlight = true;
+    session->chunkLength = 0;
+
+    if (offset % UPLOAD_CHUNK_SIZE != 0 || offset >= session->size) {
+      return session->chunkResult = UploadResult::BAD_OFFSET;
+    }
+
+    uint32_t expected = session->size - offset < UPLOAD_CHUNK_SIZE ? session->size - offset : UPLOAD_CHUNK_SIZE;
+    if (length != expected) {
+      return session->chunkResult = UploadResult::BAD_LENGTH;
+    }
+
+    // "r+" 允许在已有内容中任意位置覆盖写入，重传的分块直接覆盖旧数据
+    session->chunkFile = LittleFS.open(session->tempPath.c_str(), "r+");
+    if (!session->chunkFile || !session->chunkFile.seek(offset)) {
+      session->chunkFile.close();
+      return session->chunkResult = UploadResult::IO_ERROR;
+    }
+
+    session->chunkOffset = offset;
+    session->chunkLength = length;
+    session->chunkWritten = 0;
+    session->expectedCrc = crc;
+    session->runningCrc = 0;
+    return session->chunkResult = UploadResult::OK;
+  }
+
+  UploadResult ResumableUploadManager::writeChunk(uint32_t id, const void* owner, const uint8_t* data, size_t len)
+  {
+    UploadSession* session = find(id);
+    if (!session) {
+      return UploadResult::NOT_FOUND;
+    }
+    if (!session->chunkInFlight || session->chunkOwner != owner) {
+      return UploadResult::BUSY;
+    }
+    if (session->chunkResult != UploadResult::OK) {
+      return session->chunkResult;
+    }
+    if (!session->chunkFile) {
+      return session->chunkResult = UploadResult::IO_ERROR;
+    }
+
+    if (session->chunkWritten + len > session->chunkLength) {
+      session->chunkFile.close();
+      return session->chunkResult = UploadResult::BAD_LENGTH;
+    }
+
+    if (session->chunkFile.write(data, len) != len) {
+      session->chunkFile.close();
+      return session->chunkResult = UploadResult::IO_ERROR;
+    }
+
+    session->runningCrc = esp_rom_crc32_le(session->runningCrc, data, len);
+    session->chunkWritten += len;
+    session->lastActivity = millis();
+    return UploadResult::OK;
+  }
+
+  UploadResult ResumableUploadManager::endChunk(uint32_t id, const void* owner)
+  {
+    UploadSession* session = find(id);
+    if (!session) {
+      return UploadResult::NOT_FOUND;
+    }
+    if (!session->chunkInFlight || session->chunkOwner != owner) {
+      return UploadResult::BUSY;
+    }
+    session->chunkInFlight = false;
+    if (session->chunkFile) {
+      session->chunkFile.close();
+    }
+    if (session->chunkResult != UploadResult::OK) {
+      return session->chunkResult;
+    }
+
+    if (session->chunkWritten != session->chunkLength) {
+      return session->chunkResult = UploadResult::BAD_LENGTH;
+    }
+
+    // 校验失败的分块不标记为已接收，客户端重传时会覆盖这段数据
+    if (session->runningCrc != session->expectedCrc) {
+      Serial.printf("Upload %08lx chunk @%lu CRC mismatch: got %08lx, expected %08lx\n",
+                    (unsigned long)id, (unsigned long)session->chunkOffset,
+                    (unsigned long)session->runningCrc, (unsigned long)session->expectedCrc);
+      return session->chunkResult = UploadResult::CRC_MISMATCH;
+    }
+
+    uint16_t index = session->chunkOffset / UPLOAD_CHUNK_SIZE;
+    session->received[index >> 3] |= 1 << (index & 7);
+    session->lastActivity = millis();
+    return session->chunkResult = UploadResult::OK;
+  }
+
+  UploadResult ResumableUploadManager::chunkResult(uint32_t id, const void* owner)
+  {
+    UploadSession* session = find(id);
+    if (!session) {
+      return UploadResult::NOT_FOUND;
+    }
+    // 请求的分块被拒绝（或已被其他请求取代）时，会话中的结果不属于它
+    if (session->chunkInFlight || session->chunkOwner != owner) {
+      return UploadResult::BUSY;
+    }
+    return session->chunkResult;
+  }
+
+  UploadResult ResumableUploadManager::finalize(uint32_t id, const char* targetPath,
+                                                bool (*validate)(const char* path))
+  {
+    UploadSession* session = find(id);
+    if (!session) {
+      return UploadResult::NOT_FOUND;
+    }
+    if (session->isChunkBusy(nullptr)) {
+      return UploadResult::BUSY;
+    }
+    if (session->chunkFile) {
+      session->chunkFile.close();
+    }
+    if (!session->isComplete()) {
+      return UploadResult::INCOMPLETE;
+    }
+
+    File file = LittleFS.open(session->tempPath.c_str(), "r");
+    if (!file || file.size() != session->size) {
+      return UploadResult::IO_ERROR;
+    }
+
+    if (session->hasFileCrc) {
+      uint8_t buffer[512];
+      uint32_t crc = 0;
+      size_t n;
+      while ((n = file.read(buffer, sizeof(buffer))) > 0) {
+        crc = esp_rom_crc32_le(crc, buffer, n);
+      }
+      if (crc != session->fileCrc) {
+        file.close();
+        return UploadResult::CRC_MISMATCH;
+      }
+    }
+    file.close();
+
+    // 内容不是有效图片时直接丢弃整个会话，重传也不会变好
+    if (validate && !validate(session->tempPath.c_str())) {
+      releaseSession(*session, true);
+      return UploadResult::INVALID;
+    }
+
+    // LittleFS的rename是原子操作：要么看到完整的新文件，要么什么都没有
+    if (!LittleFS.rename(session->tempPath.c_str(), targetPath)) {
+      Serial.printf("Failed to rename %s -> %s\n", session->tempPath.c_str(), targetPath);
+      return UploadResult::IO_ERROR;
+    }
+
+    Serial.printf("Upload %08lx finalized as %s\n", (unsigned long)id, targetPath);
+    releaseSession(*session, false);
+    return UploadResult::OK;
+  }
+
+  void ResumableUploadManager::abort(uint32_t id)
+  {
+    UploadSession* session = find(id);
+    if (session) {
+      Serial.printf("Upload %08lx aborted\n", (unsigned long)id);
+      releaseSession(*session, true);
+    }
+  }
+
+  uint8_t ResumableUploadManager::activeSessions() const
+  {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < UPLOAD_MAX_SESSIONS; i++) {
+      if (sessions[i].active) count++;
+    }
+    return count;
+  }
+
+  // ==================== 上传校验 ====================
+
+  bool validateImageData(const char* filename, const uint8_t* head, size_t headLen, uint32_t size)
+  {
+    const char* ext = filename ? strrchr(filename, '.') : nullptr;
+    if (!ext || size == 0 || size > MAX_FILE_SIZE) {
+      return false;
+    }
+
+    if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0) {
+      return headLen >= 2 && head[0] == 0xFF && head[1] == 0xD8;
+    }
+
+    if (strcasecmp(ext, ".bmp") == 0) {
+      if (headLen < 6 || head[0] != 'B' || head[1] != 'M') {
+        return false;
+      }
+      // 头中声明的文件大小（部分编码器写0，此时不检查）
+      uint32_t declared = head[2] | (head[3] << 8) | (head[4] << 16) | ((uint32_t)head[5] << 24);
+      return declared == 0 || size >= declared;
+    }
+
+    // 入库转码生成的RGB565图片（从 /api/image 下载的备份可以原样传回）
+    if (strcasecmp(ext, ".r565") == 0) {
+      if (headLen < 8 || memcmp(head, "R565", 4) != 0) {
+        return false;
+      }
+      uint32_t width = head[4] | (head[5] << 8);
+      uint32_t height = head[6] | (head[7] << 8);
+      return width > 0 && height > 0 && size == 8 + width * height * 2;
+    }
+
+    return false;
+  }
+
+  void ImageStreamCheck::reset()
+  {
+    headLen = 0;
+    total = 0;
+    runningCrc = 0;
+  }
+
+  void ImageStreamCheck::update(const uint8_t* data, size_t len)
+  {
+    total += len;
+    runningCrc = esp_rom_crc32_le(runningCrc, data, len);
+
+    for (size_t i = 0; i < len && headLen < IMAGE_HEAD_BYTES; i++) {
+      head[headLen++] = data[i];
+    }
+  }
+
+  bool ImageStreamCheck::isValid(const char* filename) const
+  {
+    return validateImageData(filename, head, headLen, total);
+  }
+
+  uint16_t removeStaleTempFiles()
+  {
+    const char* prefix = UPLOAD_TEMP_PREFIX + 1; // 去掉前导'/'
+    size_t prefixLen = strlen(prefix);
+    uint16_t removed = 0;
+
+    File root = LittleFS.open("/");
+    if (!root) {
+      return 0;
+    }
+
+    // 先收集再删除，避免边遍历边修改目录
+    ImagePath stale[8];
+    uint8_t count;
+    do {
+      count = 0;
+      root.rewindDirectory();
+      File file = root.openNextFile();
+      while (file && count < 8) {
+        const char* slash = strrchr(file.name(), '/');
+        const char* base = slash ? slash + 1 : file.name();
+        if (strncmp(base, prefix, prefixLen) == 0) {
+          stale[count++] = makeImagePath(base);
+        }
+        file = root.openNextFile();
+      }
+
+      uint8_t removedThisPass = 0;
+      for (uint8_t i = 0; i < count; i++) {
+        if (LittleFS.remove(stale[i].c_str())) {
+          Serial.printf("Removed stale upload: %s\n", stale[i].c_str());
+          removedThisPass++;
+        }
+      }
+      removed += removedThisPass;
+
+      // 删除失败时停止，避免反复遍历同一批文件
+      if (removedThisPass < count) {
+        break;
+      }
+    } while (count == 8);
+
+    return removed;
+  }
+}
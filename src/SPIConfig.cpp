@@ -0,0 +1,107 @@
+#include "SPIConfig.h"
+#include <Preferences.h>
+
+namespace Display
+{
+  // SPI时钟由80MHz APB时钟整数分频得到，只有这些档位是真正可达的
+  static const uint32_t SPI_SOURCE_CLOCK = 80000000;
+  static const char *SPI_PREFS_NAMESPACE = "spi";
+
+  // ==================== SPICalibrator 类实现 ====================
+
+  uint32_t SPICalibrator::calibrate(Adafruit_SPITFT &tft, const SPIBusConfig &config, SPIReadbackFn readback)
+  {
+    Serial.println("Calibrating SPI clock...");
+
+    // 在基准时钟下采集RDDID作为参考值
+    tft.setSPISpeed(config.safeFrequency);
+    uint8_t reference[3];
+    bool allZero = true;
+    bool allOnes = true;
+    for (uint8_t i = 0; i < 3; i++) {
+      reference[i] = readback(tft, i + 1);
+      allZero = allZero && reference[i] == 0x00;
+      allOnes = allOnes && reference[i] == 0xFF;
+    }
+
+    // MISO悬空时读回全0或全1，无法验证
+    if (allZero || allOnes) {
+      Serial.println("SPI calibration skipped: no readback on MISO");
+      return 0;
+    }
+
+    Serial.printf("Reference RDDID: %02X %02X %02X\n", reference[0], reference[1], reference[2]);
+
+    uint32_t bestFrequency = config.safeFrequency;
+    uint32_t divider = SPI_SOURCE_CLOCK / config.safeFrequency;
+
+    while (divider > 1) {
+      divider--;
+      uint32_t frequency = SPI_SOURCE_CLOCK / divider;
+      if (frequency > config.maxFrequency) {
+        break;
+      }
+
+      tft.setSPISpeed(frequency);
+
+      bool stable = true;
+      for (uint8_t round = 0; round < config.readbackRounds && stable; round++) {
+        // 写入测试图案，让总线在该时钟下承受真实负载
+        tft.fillRect(0, 0, 32, 32, (round & 1) ? 0xFFFF : 0x0000);
+
+        for (uint8_t i = 0; i < 3; i++) {
+          if (readback(tft, i + 1) != reference[i]) {
+            stable = false;
+            break;
+          }
+        }
+      }
+
+      if (!stable) {
+        Serial.printf("SPI unstable at %lu Hz\n", (unsigned long)frequency);
+        break;
+      }
+
+      bestFrequency = frequency;
+    }
+
+    tft.setSPISpeed(bestFrequency);
+    Serial.printf("SPI calibration result: %lu Hz\n", (unsigned long)bestFrequency);
+    return bestFrequency;
+  }
+
+  bool SPICalibrator::loadFrequency(const char *driverName, uint32_t &frequency)
+  {
+    Preferences prefs;
+    if (!prefs.begin(SPI_PREFS_NAMESPACE, true)) {
+      return false;
+    }
+
+    frequency = prefs.getULong(driverName, 0);
+    prefs.end();
+    return frequency != 0;
+  }
+
+  void SPICalibrator::saveFrequency(const char *driverName, uint32_t frequency)
+  {
+    Preferences prefs;
+    if (!prefs.begin(SPI_PREFS_NAMESPACE, false)) {
+      Serial.println("Failed to open NVS for SPI calibration");
+      return;
+    }
+
+    prefs.putULong(driverName, frequency);
+    prefs.end();
+  }
+
+  void SPICalibrator::clearFrequency(const char *driverName)
+  {
+    Preferences prefs;
+    if (!prefs.begin(SPI_PREFS_NAMESPACE, false)) {
+      return;
+    }
+
+    prefs.remove(driverName);
+    prefs.end();
+  }
+}
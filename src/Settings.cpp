@@ -0,0 +1,215 @@
+#include "Settings.h"
+#include <Preferences.h>
+
+namespace Settings
+{
+  SettingsStore settingsStore;
+
+  static const char *SETTINGS_PREFS_NAMESPACE = "settings";
+  static const char *SETTINGS_KEY = "state";
+
+  static const uint8_t FLAG_SLIDESHOW_ACTIVE = 0x01;
+  static const uint8_t FLAG_AUTO_ROTATION = 0x02;
+
+  // ==================== NVS记录格式 ====================
+  // 旧版本的记录较短：只复制已有的前缀，后续字段保持默认值
+
+  struct StoredSettings
+  {
+    uint8_t version;
+    uint8_t flags;
+    uint8_t orientationMode;
+    uint8_t displayDriver;
+    uint32_t slideshowInterval;
+    uint16_t currentIndex;
+    char currentImage[MAX_FILENAME_LENGTH];
+  } __attribute__((packed));
+
+  // 上次写入NVS的内容，没有变化时跳过写入
+  static StoredSettings lastStored;
+
+  static void encode(const RuntimeSettings &settings, StoredSettings &stored)
+  {
+    memset(&stored, 0, sizeof(stored));
+    stored.version = SETTINGS_VERSION;
+    stored.flags = (settings.slideshowActive ? FLAG_SLIDESHOW_ACTIVE : 0) |
+                   (settings.autoRotation ? FLAG_AUTO_ROTATION : 0);
+    stored.orientationMode = settings.orientationMode;
+    stored.displayDriver = settings.displayDriver;
+    stored.slideshowInterval = settings.slideshowInterval;
+    stored.currentIndex = settings.currentIndex;
+    memcpy(stored.currentImage, settings.currentImage.c_str(), settings.currentImage.length());
+  }
+
+  static void decode(const StoredSettings &stored, RuntimeSettings &settings)
+  {
+    settings.slideshowActive = stored.flags & FLAG_SLIDESHOW_ACTIVE;
+    settings.autoRotation = stored.flags & FLAG_AUTO_ROTATION;
+    settings.orientationMode = stored.orientationMode;
+    settings.displayDriver = stored.displayDriver;
+    settings.slideshowInterval = stored.slideshowInterval;
+    settings.currentIndex = stored.currentIndex;
+    settings.currentImage.assign(stored.currentImage, strnlen(stored.currentImage, MAX_FILENAME_LENGTH));
+  }
+
+  // ==================== SettingsStore 实现 ====================
+
+  void SettingsStore::lock()
+  {
+    if (mutex) {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+    }
+  }
+
+  void SettingsStore::unlock()
+  {
+    if (mutex) {
+      xSemaphoreGive(mutex);
+    }
+  }
+
+  bool SettingsStore::begin()
+  {
+    if (!mutex) {
+      mutex = xSemaphoreCreateMutex();
+    }
+
+    unsigned long start = micros();
+    encode(settings, lastStored);
+
+    bool loaded = false;
+    Preferences prefs;
+    if (prefs.begin(SETTINGS_PREFS_NAMESPACE, true)) {
+      StoredSettings stored;
+      encode(settings, stored);  // 默认值，旧版本记录缺少的字段保持不变
+      size_t length = prefs.getBytes(SETTINGS_KEY, &stored, sizeof(stored));
+      prefs.end();
+
+      // 比当前固件更新的记录（降级）无法可靠解析，使用默认值
+      if (length >= 1 && stored.version >= 1 && stored.version <= SETTINGS_VERSION) {
+        decode(stored, settings);
+        lastStored = stored;
+        loaded = true;
+      }
+    }
+    loadMicros = micros() - start;
+
+    if (loaded) {
+      Serial.printf("Settings restored in %lu us: slideshow %s (%lu ms), mode %u, image %s\n",
+                    (unsigned long)loadMicros, settings.slideshowActive ? "on" : "off",
+                    (unsigned long)settings.slideshowInterval, settings.orientationMode,
+                    settings.currentImage.isEmpty() ? "-" : settings.currentImage.c_str());
+    } else {
+      Serial.println("No saved settings, using defaults");
+    }
+    return loaded;
+  }
+
+  RuntimeSettings SettingsStore::get()
+  {
+    lock();
+    RuntimeSettings copy = settings;
+    unlock();
+    return copy;
+  }
+
+  void SettingsStore::markDirty(bool isConfig)
+  {
+    dirty = true;
+    urgent = urgent || isConfig;
+    lastChange = millis();
+  }
+
+  void SettingsStore::setSlideshow(bool active, uint32_t interval)
+  {
+    lock();
+    if (settings.slideshowActive != active || settings.slideshowInterval != interval) {
+      settings.slideshowActive = active;
+      settings.slideshowInterval = interval;
+      markDirty(true);
+    }
+    unlock();
+  }
+
+  void SettingsStore::setOrientation(uint8_t mode, bool autoRotation)
+  {
+    lock();
+    if (settings.orientationMode != mode || settings.autoRotation != autoRotation) {
+      settings.orientationMode = mode;
+      settings.autoRotation = autoRotation;
+      markDirty(true);
+    }
+    unlock();
+  }
+
+  void SettingsStore::setDisplayDriver(uint8_t driver)
+  {
+    lock();
+    if (settings.displayDriver != driver) {
+      settings.displayDriver = driver;
+      markDirty(true);
+    }
+    unlock();
+  }
+
+  void SettingsStore::setCurrentImage(const char *name, uint16_t index)
+  {
+    lock();
+    if (settings.currentIndex != index || settings.currentImage != name) {
+      settings.currentIndex = index;
+      settings.currentImage.assign(name);
+      markDirty(false);
+    }
+    unlock();
+  }
+
+  void SettingsStore::service()
+  {
+    if (!dirty) {
+      return;
+    }
+
+    unsigned long now = millis();
+    bool due = (urgent && now - lastChange >= SETTINGS_DEBOUNCE_MS) ||
+               now - lastWrite >= SETTINGS_MIN_WRITE_INTERVAL_MS;
+    if (due) {
+      write();
+    }
+  }
+
+  void SettingsStore::flush()
+  {
+    if (dirty) {
+      write();
+    }
+  }
+
+  void SettingsStore::write()
+  {
+    lock();
+    StoredSettings stored;
+    encode(settings, stored);
+    dirty = false;
+    urgent = false;
+    unlock();
+
+    lastWrite = millis();
+
+    // 例如幻灯片转了一圈回到同一张图片：内容没变就不写
+    if (memcmp(&stored, &lastStored, sizeof(stored)) == 0) {
+      return;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(SETTINGS_PREFS_NAMESPACE, false)) {
+      Serial.println("Failed to open NVS for settings");
+      return;
+    }
+    if (prefs.putBytes(SETTINGS_KEY, &stored, sizeof(stored)) == sizeof(stored)) {
+      lastStored = stored;
+    } else {
+      Serial.println("Failed to save settings");
+    }
+    prefs.end();
+  }
+}
@@ -0,0 +1,267 @@
+#include "TextRenderer.h"
+#include "DisplayDriver.h"
+
+// Adafruit_GFX内置的经典5x7字体（文件内为static数组，这里引入一份副本）
+#include <glcdfont.c>
+
+namespace Display
+{
+  // 全局文本渲染器实例
+  TextRenderer textRenderer;
+
+  // 读取经典字体中 (gx, gy) 处的像素，字形外部视为空白
+  static inline uint8_t glyphBit(uint8_t ch, int16_t gx, int16_t gy)
+  {
+    if (gx < 0 || gx >= 5 || gy < 0 || gy >= GLYPH_CELL_HEIGHT) {
+      return 0;
+    }
+    return (pgm_read_byte(&font[ch * 5 + gx]) >> gy) & 0x01;
+  }
+
+  // ==================== TextRenderer 类实现 ====================
+
+  TextRenderer::TextRenderer()
+    : useCounter(0), antiAlias(TEXT_ANTI_ALIAS)
+  {
+    clearCache();
+  }
+
+  void TextRenderer::setAntiAlias(bool enable)
+  {
+    if (antiAlias != enable) {
+      antiAlias = enable;
+      clearCache();
+    }
+  }
+
+  void TextRenderer::clearCache()
+  {
+    for (uint8_t i = 0; i < TEXT_GLYPH_CACHE_SLOTS; i++) {
+      cache[i].valid = false;
+      cache[i].lastUse = 0;
+    }
+  }
+
+  uint16_t TextRenderer::measure(const char *text, size_t len, uint8_t size)
+  {
+    size_t count = 0;
+    while (count < len && text[count] != '\0' && text[count] != '\n') {
+      count++;
+    }
+    return count * GLYPH_CELL_WIDTH * size;
+  }
+
+  const TextRenderer::GlyphSlot &TextRenderer::getGlyph(uint8_t ch, uint8_t size)
+  {
+    useCounter++;
+
+    GlyphSlot *victim = &cache[0];
+    for (uint8_t i = 0; i < TEXT_GLYPH_CACHE_SLOTS; i++) {
+      GlyphSlot &slot = cache[i];
+      if (slot.valid && slot.ch == ch && slot.size == size && slot.antiAlias == antiAlias) {
+        slot.lastUse = useCounter;
+        return slot;
+      }
+      // 优先复用空槽，否则淘汰最久未使用的槽
+      if (!slot.valid) {
+        if (victim->valid) victim = &slot;
+      } else if (victim->valid && slot.lastUse < victim->lastUse) {
+        victim = &slot;
+      }
+    }
+
+    victim->ch = ch;
+    victim->size = size;
+    victim->antiAlias = antiAlias;
+    victim->valid = true;
+    victim->lastUse = useCounter;
+    rasterize(*victim);
+    return *victim;
+  }
+
+  void TextRenderer::rasterize(GlyphSlot &slot)
+  {
+    const uint8_t size = slot.size;
+    const uint16_t cellW = GLYPH_CELL_WIDTH * size;
+    const uint16_t cellH = GLYPH_CELL_HEIGHT * size;
+    const bool smooth = slot.antiAlias && size > 1;
+
+    memset(slot.coverage, 0, sizeof(slot.coverage));
+
+    for (uint16_t oy = 0; oy < cellH; oy++) {
+      for (uint16_t ox = 0; ox < cellW; ox++) {
+        uint8_t level;
+
+        if (!smooth) {
+          level = glyphBit(slot.ch, ox / size, oy / size) ? 15 : 0;
+        } else {
+          // 双线性采样放大后的字形，采样点为输出像素中心（8位定点，+256避免负数取整）
+          int32_t u = ((2 * ox + 1) * 128) / size - 128 + 256;
+          int32_t v = ((2 * oy + 1) * 128) / size - 128 + 256;
+          int16_t gx = (u >> 8) - 1;
+          int16_t gy = (v >> 8) - 1;
+          int32_t fx = u & 0xFF;
+          int32_t fy = v & 0xFF;
+
+          int32_t top = glyphBit(slot.ch, gx, gy) * (256 - fx) + glyphBit(slot.ch, gx + 1, gy) * fx;
+          int32_t bottom = glyphBit(slot.ch, gx, gy + 1) * (256 - fx) + glyphBit(slot.ch, gx + 1, gy + 1) * fx;
+          int32_t value = top * (256 - fy) + bottom * fy; // 0..65536
+
+          level = (value * 15 + 32768) >> 16;
+        }
+
+        uint16_t index = oy * cellW + ox;
+        slot.coverage[index >> 1] |= level << ((index & 1) * 4);
+      }
+    }
+  }
+
+  void TextRenderer::buildPalette(uint16_t fg, uint16_t bg)
+  {
+    int16_t rf = (fg >> 11) & 0x1F, gf = (fg >> 5) & 0x3F, bf = fg & 0x1F;
+    int16_t rb = (bg >> 11) & 0x1F, gb = (bg >> 5) & 0x3F, bb = bg & 0x1F;
+
+    for (uint8_t i = 0; i < 16; i++) {
+      uint16_t r = (rf * i + rb * (15 - i) + 7) / 15;
+      uint16_t g = (gf * i + gb * (15 - i) + 7) / 15;
+      uint16_t b = (bf * i + bb * (15 - i) + 7) / 15;
+      palette[i] = (r << 11) | (g << 5) | b;
+    }
+  }
+
+  void TextRenderer::drawText(DisplayDriverBase &driver, const char *text, int16_t x, int16_t y,
+                              uint16_t fg, uint8_t size)
+  {
+    drawLines(driver, text, x, y, fg, 0, size, false);
+  }
+
+  void TextRenderer::drawText(DisplayDriverBase &driver, const char *text, int16_t x, int16_t y,
+                              uint16_t fg, uint16_t bg, uint8_t size)
+  {
+    drawLines(driver, text, x, y, fg, bg, size, true);
+  }
+
+  void TextRenderer::drawLines(DisplayDriverBase &driver, const char *text, int16_t x, int16_t y,
+                               uint16_t fg, uint16_t bg, uint8_t size, bool opaque)
+  {
+    if (!text) {
+      return;
+    }
+
+    const char *lineStart = text;
+    int16_t lineY = y;
+
+    while (true) {
+      const char *lineEnd = strchr(lineStart, '\n');
+      size_t len = lineEnd ? (size_t)(lineEnd - lineStart) : strlen(lineStart);
+
+      if (opaque) {
+        drawRun(driver, lineStart, len, x, lineY, fg, bg, size);
+      } else {
+        drawRunTransparent(driver, lineStart, len, x, lineY, fg, size);
+      }
+
+      if (!lineEnd) {
+        break;
+      }
+      lineStart = lineEnd + 1;
+      lineY += GLYPH_CELL_HEIGHT * size;
+    }
+  }
+
+  void TextRenderer::drawRun(DisplayDriverBase &driver, const char *text, size_t len, int16_t x, int16_t y,
+                             uint16_t fg, uint16_t bg, uint8_t size)
+  {
+    if (!supportsSize(size)) {
+      return;
+    }
+    len = clipRun(driver, len, x, size);
+    if (len == 0) {
+      return;
+    }
+
+    const uint16_t cellW = GLYPH_CELL_WIDTH * size;
+    const uint16_t cellH = GLYPH_CELL_HEIGHT * size;
+
+    // 条带缓冲区至少要能容纳一行像素
+    if (len * cellW > TEXT_STRIP_PIXELS) {
+      len = TEXT_STRIP_PIXELS / cellW;
+    }
+
+    const uint16_t runW = len * cellW;
+    const uint16_t rowsPerStrip = TEXT_STRIP_PIXELS / runW;
+
+    buildPalette(fg, bg);
+
+    for (uint16_t row0 = 0; row0 < cellH; row0 += rowsPerStrip) {
+      uint16_t rows = (cellH - row0 < rowsPerStrip) ? (cellH - row0) : rowsPerStrip;
+
+      for (size_t i = 0; i < len; i++) {
+        const GlyphSlot &glyph = getGlyph((uint8_t)text[i], size);
+
+        for (uint16_t r = 0; r < rows; r++) {
+          uint16_t *dst = strip + r * runW + i * cellW;
+          uint16_t index = (row0 + r) * cellW;
+
+          for (uint16_t c = 0; c < cellW; c++, index++) {
+            uint8_t level = (glyph.coverage[index >> 1] >> ((index & 1) * 4)) & 0x0F;
+            dst[c] = palette[level];
+          }
+        }
+      }
+
+      driver.pushImage(x, y + row0, runW, rows, strip);
+    }
+  }
+
+  // 丢弃完全落在屏幕右侧之外的字符，返回剩余字符数
+  size_t TextRenderer::clipRun(DisplayDriverBase &driver, size_t len, int16_t x, uint8_t size) const
+  {
+    const uint16_t cellW = GLYPH_CELL_WIDTH * size;
+    int16_t screenW = driver.getGFX().width();
+    if (x >= screenW) {
+      return 0;
+    }
+    size_t visibleChars = (screenW - x + cellW - 1) / cellW;
+    return len > visibleChars ? visibleChars : len;
+  }
+
+  void TextRenderer::drawRunTransparent(DisplayDriverBase &driver, const char *text, size_t len, int16_t x, int16_t y,
+                                        uint16_t fg, uint8_t size)
+  {
+    if (!supportsSize(size)) {
+      return;
+    }
+    len = clipRun(driver, len, x, size);
+    if (len == 0) {
+      return;
+    }
+
+    const uint16_t cellW = GLYPH_CELL_WIDTH * size;
+    const uint16_t cellH = GLYPH_CELL_HEIGHT * size;
+
+    // 整段文本在一个SPI事务内写完，每段连续像素只设置一次地址窗口
+    Adafruit_GFX &gfx = driver.getGFX();
+    gfx.startWrite();
+    for (size_t i = 0; i < len; i++) {
+      const GlyphSlot &glyph = getGlyph((uint8_t)text[i], size);
+      int16_t cellX = x + i * cellW;
+
+      for (uint16_t r = 0; r < cellH; r++) {
+        uint16_t index = r * cellW;
+        int16_t spanStart = -1;
+
+        for (uint16_t c = 0; c <= cellW; c++, index++) {
+          bool on = c < cellW && ((glyph.coverage[index >> 1] >> ((index & 1) * 4)) & 0x0F) >= 8;
+          if (on && spanStart < 0) {
+            spanStart = c;
+          } else if (!on && spanStart >= 0) {
+            gfx.writeFastHLine(cellX + spanStart, y + r, c - spanStart, fg);
+            spanStart = -1;
+          }
+        }
+      }
+    }
+    gfx.endWrite();
+  }
+}
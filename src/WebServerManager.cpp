@@ -1,17 +1,22 @@
 #include "WebServer.h"
 #include "DisplayDriver.h"
 #include "ImageDisplay.h"
+#include "DecodeArena.h"
+#include "PipelineBenchmark.h"
+#include "ResumableUpload.h"
+#include "ImageIngest.h"
+#include "ContentIndex.h"
+#include "Playlist.h"
+#include "Settings.h"
+#include "BootTiming.h"
+#include "WiFiLink.h"
+#include "ImageCatalog.h"
 
 namespace WebServerManager
 {
   // 全局Web服务器控制器实例
   WebServerController webServerController;
   
-  // 向后兼容的全局变量
-  int currentImageIndex = 0;
-  String imageList[MAX_IMAGES];
-  int imageCount = 0;
-  
   // ==================== WebServerController 类实现 ====================
   
   bool WebServerController::begin()
@@ -25,7 +30,13 @@ namespace WebServerManager
     currentImageIndex = 0;
     slideshowActive = false;
     slideshowInterval = 3000; // 默认3秒间隔
-    lastSlideshowChange = 0;
+    slideDeadline = 0;
+    slideSwitchPending = false;
+    slideSwitchTime = 0;
+    slideSwitchVersion = 0;
+    slideSwitchTimeValid = false;
+    slideJitter = SlideJitterStats();
+    Catalog::catalog.begin();
 
     // 初始化文件系统
     if (!initFileSystem()) {
@@ -33,16 +44,40 @@ namespace WebServerManager
       return false;
     }
     
-    // 连接WiFi
-    if (!connectWiFi(WIFI_SSID, WIFI_PASSWORD)) {
-      Serial.println("Failed to connect to WiFi");
-      return false;
-    }
-    
+    // 扫描会更新当前图片设置，先取出上次保存的状态
+    Settings::RuntimeSettings saved = Settings::settingsStore.get();
+
     // 扫描现有图片
     scanImages();
+
+    // 恢复上次的幻灯片状态和当前图片（断电重启后从原来的位置继续）
+    setSlideshowInterval(saved.slideshowInterval);
+    int savedIndex = -1;
+    for (int i = 0; i < imageCount; i++) {
+      if (imageList[i] == saved.currentImage.c_str()) {
+        savedIndex = i;
+        break;
+      }
+    }
+    if (savedIndex < 0 && saved.currentIndex < imageCount) {
+      savedIndex = saved.currentIndex;
+    }
+    if (savedIndex >= 0) {
+      setCurrentImage(savedIndex);
+    }
+    if (saved.slideshowActive) {
+      startSlideshow();
+    }
+
+    return true;
+  }
+
+  bool WebServerController::startNetwork()
+  {
+    // 发起WiFi连接后立即返回，连接在后台完成
+    connectWiFi(WIFI_SSID, WIFI_PASSWORD);
     
-    // 初始化Web服务器
+    // 初始化Web服务器（WiFi连上后即可访问）
     server = new AsyncWebServer(WEB_SERVER_PORT);
     if (!server)
     {
@@ -56,7 +91,6 @@ namespace WebServerManager
     serverRunning = true;
     
     Serial.println("Web server started successfully");
-    Serial.printf("Server running on: http://%s\n", getIPAddress().c_str());
     
     return true;
   }
@@ -72,26 +106,8 @@ namespace WebServerManager
 
   bool WebServerController::connectWiFi(const char* ssid, const char* password)
   {
-    Serial.printf("Connecting to WiFi: %s\n", ssid);
-    
-    WiFi.begin(ssid, password);
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30) {
-      delay(1000);
-      Serial.print(".");
-      attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.println();
-      Serial.printf("WiFi connected! IP address: %s\n", WiFi.localIP().toString().c_str());
-      return true;
-    } else {
-      Serial.println();
-      Serial.println("Failed to connect to WiFi");
-      return false;
-    }
+    // 不在这里等待连接：连接、断线重连由 Net::wifiLink 在主循环中推进
+    return Net::wifiLink.begin(ssid, password);
   }
   
   bool WebServerController::initFileSystem()
@@ -104,146 +120,244 @@ namespace WebServerManager
     
     Serial.println("LittleFS mounted successfully");
     fileSystemReady = true;
+
+    // 清理上次断电或断线遗留的上传临时文件
+    uint16_t removed = Upload::removeStaleTempFiles();
+    if (removed > 0) {
+      Serial.printf("Removed %u stale upload file(s)\n", removed);
+    }
+
+    // 加载内容去重索引和播放列表
+    Dedup::contentIndex.begin();
+    Playlist::playlistManager.begin();
+    Catalog::imageMeta.begin();
     return true;
   }
   
   void WebServerController::scanImages()
   {
+    // 在工作副本上扫描，完成后一次性发布；扫描期间读者看到的仍是上一个完整版本
+    Catalog::WriterLock writer;
+
+    // 重新扫描后尽量保持当前显示的图片
+    ImageName current(workingCurrentName());
     imageCount = 0;
     currentImageIndex = 0;
     
     if (!fileSystemReady) {
       Serial.println("File system not ready for scanning");
+      Catalog::catalog.publish(imageList, imageCount, currentImageIndex);
       return;
     }
     
     File root = LittleFS.open("/");
     if (!root) {
       Serial.println("Failed to open root directory");
+      Catalog::catalog.publish(imageList, imageCount, currentImageIndex);
       return;
     }
     
     File file = root.openNextFile();
     while (file && imageCount < MAX_IMAGES) {
-      String fileName = file.name();
+      const char* fileName = file.name();
       
       if (isValidImageFile(fileName)) {
-        imageList[imageCount] = fileName;
-        imageCount++;
-        Serial.printf("Found image: %s\n", fileName.c_str());
+        // 超长的名称存不进图片列表，截断后会指向不存在的文件，跳过
+        if (strlen(fileName) > ImageName::capacity()) {
+          Serial.printf("Skipping image with over-long name: %s\n", fileName);
+        } else {
+          imageList[imageCount].assign(fileName);
+          imageCount++;
+          Serial.printf("Found image: %s\n", fileName);
+        }
       }
       
       file = root.openNextFile();
     }
     
     Serial.printf("Total images found: %d\n", imageCount);
-    
-    // 更新全局变量（向后兼容）
-    ::WebServerManager::imageCount = imageCount;
-    ::WebServerManager::currentImageIndex = currentImageIndex;
+
+    applyImageOrder();
     for (int i = 0; i < imageCount; i++) {
-      ::WebServerManager::imageList[i] = imageList[i];
+      if (imageList[i] == current) {
+        currentImageIndex = i;
+        break;
+      }
+    }
+    publishImageList();
+  }
+
+  void WebServerController::applyImageOrder()
+  {
+    // 按 /api/batch 保存的顺序排列：顺序文件中的图片在前，其余（新上传的）保持目录顺序排在后面
+    File file = LittleFS.open(IMAGE_ORDER_PATH, "r");
+    if (!file) {
+      return;
+    }
+
+    int placed = 0;
+    char line[MAX_FILENAME_LENGTH + 2];
+    while (file.available() && placed < imageCount) {
+      size_t n = file.readBytesUntil('\n', line, sizeof(line) - 1);
+      line[n] = '\0';
+      for (int i = placed; i < imageCount; i++) {
+        if (imageList[i] == line) {
+          // 后移 [placed, i) 保持其余图片的相对顺序
+          ImageName moved = imageList[i];
+          for (int j = i; j > placed; j--) {
+            imageList[j] = imageList[j - 1];
+          }
+          imageList[placed++] = moved;
+          break;
+        }
+      }
+    }
+    file.close();
+  }
+
+  void WebServerController::publishImageList()
+  {
+    // 播放列表按文件名保存，列表变化后重新换算索引
+    Playlist::playlistManager.resolve(imageList, imageCount);
+    Catalog::imageMeta.prune(imageList, imageCount);
+    publishCurrentImage();
+  }
+
+  void WebServerController::publishCurrentImage()
+  {
+    Settings::settingsStore.setCurrentImage(workingCurrentName(), currentImageIndex);
+    Catalog::catalog.publish(imageList, imageCount, currentImageIndex);
+  }
+
+  const char* WebServerController::workingCurrentName() const
+  {
+    if (imageCount > 0 && currentImageIndex >= 0 && currentImageIndex < imageCount) {
+      return imageList[currentImageIndex].c_str();
     }
+    return "";
   }
   
-  bool WebServerController::isValidImageFile(const String& filename) const
+  bool WebServerController::isValidImageFile(const char* filename) const
   {
-    String ext = filename.substring(filename.lastIndexOf('.'));
-    ext.toLowerCase();
-    return (ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".png");
+    return !isHiddenFile(filename) && hasImageExtension(filename);
   }
 
-  String WebServerController::generateSafeFilename(const String &originalName) const
+  ImageName WebServerController::generateSafeFilename(const char* originalName) const
   {
     // 获取文件扩展名
-    int lastDotIndex = originalName.lastIndexOf('.');
-    String extension = (lastDotIndex > -1) ? originalName.substring(lastDotIndex) : "";
-    String nameWithoutExt = (lastDotIndex > -1) ? originalName.substring(0, lastDotIndex) : originalName;
-
-    // 清理文件名：只保留字母、数字、下划线和连字符
-    String cleanName = "";
-    for (int i = 0; i < nameWithoutExt.length(); i++)
+    const char* dot = strrchr(originalName, '.');
+    const char* extension = dot ? dot : "";
+    size_t baseLength = dot ? (size_t)(dot - originalName) : strlen(originalName);
+    int extensionLength = strlen(extension);
+
+    // 清理文件名：只保留字母、数字、下划线和连字符，
+    // 同一趟内合并连续的下划线并跳过开头的下划线
+    ImageName cleanName;
+    for (size_t i = 0; i < baseLength; i++)
     {
-      char c = nameWithoutExt.charAt(i);
-      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-          (c >= '0' && c <= '9') || c == '_' || c == '-')
+      char c = originalName[i];
+      if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') || c == '_' || c == '-'))
       {
-        cleanName += c;
+        c = '_';
       }
-      else
+
+      if (c == '_' && (cleanName.isEmpty() || cleanName[cleanName.length() - 1] == '_'))
       {
-        cleanName += '_';
+        continue;
       }
+      cleanName.append(c);
     }
 
-    // 移除连续的下划线
-    while (cleanName.indexOf("__") >= 0)
-    {
-      cleanName.replace("__", "_");
-    }
-
-    // 移除开头和结尾的下划线
-    while (cleanName.startsWith("_"))
+    // 移除结尾的下划线
+    if (!cleanName.isEmpty() && cleanName[cleanName.length() - 1] == '_')
     {
-      cleanName = cleanName.substring(1);
-    }
-    while (cleanName.endsWith("_"))
-    {
-      cleanName = cleanName.substring(0, cleanName.length() - 1);
+      cleanName.truncate(cleanName.length() - 1);
     }
 
     // 如果清理后的名称为空，使用默认名称
-    if (cleanName.length() == 0)
+    if (cleanName.isEmpty())
     {
-      cleanName = "image";
+      cleanName.assign("image");
     }
 
     // 计算最大允许的名称长度（总长度限制25 - 扩展名长度 - 时间戳长度）
-    int maxNameLength = 25 - extension.length() - 7; // 7 = '_' + 6位时间戳
-
-    // 如果名称太长，截断
-    if (cleanName.length() > maxNameLength)
-    {
-      cleanName = cleanName.substring(0, maxNameLength);
-    }
+    int maxNameLength = 25 - extensionLength - 7; // 7 = '_' + 6位时间戳
 
     // 添加时间戳确保唯一性
     unsigned long timestamp = millis() % 1000000; // 取6位数字
-    String finalName = cleanName + "_" + String(timestamp) + extension;
-
-    // 最终检查长度
-    if (finalName.length() > 25)
+    ImageName finalName;
+    if (maxNameLength > 0)
     {
-      int availableLength = 25 - extension.length() - 7;
-      if (availableLength > 0)
-      {
-        cleanName = cleanName.substring(0, availableLength);
-        finalName = cleanName + "_" + String(timestamp) + extension;
-      }
-      else
-      {
-        finalName = "img_" + String(timestamp) + extension;
-      }
+      cleanName.truncate(maxNameLength);
+      finalName.appendf("%s_%lu%s", cleanName.c_str(), timestamp, extension);
+    }
+    else
+    {
+      finalName.appendf("img_%lu%s", timestamp, extension);
     }
 
     return finalName;
   }
 
+  int WebServerController::getImageCount() const
+  {
+    Catalog::SnapshotRef snapshot;
+    return snapshot->count;
+  }
+
   String WebServerController::getCurrentImageName() const
   {
-    if (imageCount > 0 && currentImageIndex >= 0 && currentImageIndex < imageCount) {
-      return imageList[currentImageIndex];
+    Catalog::SnapshotRef snapshot;
+    if (snapshot->count > 0) {
+      return String(snapshot->currentName());
     }
     return "No image";
   }
+
+  ImageName WebServerController::getCurrentImage() const
+  {
+    Catalog::SnapshotRef snapshot;
+    return ImageName(snapshot->currentName());
+  }
+
+  int WebServerController::getCurrentImageIndex() const
+  {
+    Catalog::SnapshotRef snapshot;
+    return snapshot->current;
+  }
   
+  int WebServerController::stepImageIndex(int direction)
+  {
+    // 跳过被隔离（反复渲染失败）的图片；全部被隔离时照常移动一步
+    int first = -1;
+    int index = currentImageIndex;
+    for (int tries = 0; tries < imageCount; tries++) {
+      // 激活播放列表时按播放列表顺序移动
+      int next = -1;
+      if (Playlist::playlistManager.isActive()) {
+        next = direction > 0 ? Playlist::playlistManager.next() : Playlist::playlistManager.previous();
+      }
+      index = next >= 0 ? next : (index + direction + imageCount) % imageCount;
+      if (first < 0) {
+        first = index;
+      }
+      if (!Catalog::imageMeta.isQuarantined(imageList[index].c_str())) {
+        return index;
+      }
+    }
+    return first;
+  }
+
   bool WebServerController::nextImage()
   {
+    Catalog::WriterLock writer;
     if (imageCount > 0) {
-      currentImageIndex = (currentImageIndex + 1) % imageCount;
-      ::WebServerManager::currentImageIndex = currentImageIndex; // 更新全局变量
+      currentImageIndex = stepImageIndex(1);
+      publishCurrentImage();
+      ImageDisplay::requestRender(); // 中止正在绘制的旧图片
       Serial.printf("Switched to next image: %s (index: %d)\n", 
-                   getCurrentImageName().c_str(), currentImageIndex);
+                   workingCurrentName(), currentImageIndex);
       return true;
     }
     return false;
@@ -251,11 +365,13 @@ namespace WebServerManager
   
   bool WebServerController::previousImage()
   {
+    Catalog::WriterLock writer;
     if (imageCount > 0) {
-      currentImageIndex = (currentImageIndex - 1 + imageCount) % imageCount;
-      ::WebServerManager::currentImageIndex = currentImageIndex; // 更新全局变量
+      currentImageIndex = stepImageIndex(-1);
+      publishCurrentImage();
+      ImageDisplay::requestRender(); // 中止正在绘制的旧图片
       Serial.printf("Switched to previous image: %s (index: %d)\n", 
-                   getCurrentImageName().c_str(), currentImageIndex);
+                   workingCurrentName(), currentImageIndex);
       return true;
     }
     return false;
@@ -263,11 +379,13 @@ namespace WebServerManager
   
   bool WebServerController::setCurrentImage(int index)
   {
+    Catalog::WriterLock writer;
     if (index >= 0 && index < imageCount) {
       currentImageIndex = index;
-      ::WebServerManager::currentImageIndex = currentImageIndex; // 更新全局变量
+      publishCurrentImage();
+      ImageDisplay::requestRender(); // 中止正在绘制的旧图片
       Serial.printf("Set current image: %s (index: %d)\n", 
-                   getCurrentImageName().c_str(), currentImageIndex);
+                   workingCurrentName(), currentImageIndex);
       return true;
     }
     return false;
@@ -278,12 +396,18 @@ namespace WebServerManager
     JsonDocument doc;
     JsonArray images = doc["images"].to<JsonArray>();
 
-    for (int i = 0; i < imageCount; i++) {
-      images.add(imageList[i]);
+    // 与 images 一一对应的引用计数（重复上传只保存一份，计为多个引用）
+    JsonArray refs = doc["refs"].to<JsonArray>();
+
+    // 列表、当前索引和总数取自同一个版本
+    Catalog::SnapshotRef snapshot;
+    for (int i = 0; i < snapshot->count; i++) {
+      images.add(snapshot->names[i].c_str());
+      refs.add(max<uint8_t>(1, Dedup::contentIndex.refCount(snapshot->names[i].c_str())));
     }
     
-    doc["current"] = currentImageIndex;
-    doc["total"] = imageCount;
+    doc["current"] = snapshot->current;
+    doc["total"] = snapshot->count;
     doc["status"] = "ok";
     
     String result;
@@ -305,9 +429,12 @@ namespace WebServerManager
     doc["storage"] = String(usedBytes / 1024) + "KB / " + String(totalBytes / 1024) + "KB";
 
     // 图片统计
-    doc["imageCount"] = imageCount;
-    doc["currentImage"] = getCurrentImageName();
-    doc["currentIndex"] = currentImageIndex;
+    {
+      Catalog::SnapshotRef snapshot;
+      doc["imageCount"] = snapshot->count;
+      doc["currentImage"] = snapshot->currentName();
+      doc["currentIndex"] = snapshot->current;
+    }
 
     String result;
     serializeJson(doc, result);
@@ -355,12 +482,34 @@ namespace WebServerManager
     server->on("/api/slideshow", HTTP_GET, [this](AsyncWebServerRequest *request)
                { handleSlideshowStatusAPI(request); });
 
+    // 播放列表API（POST为JSON请求体）
+    server->on("/api/playlists", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { sendPlaylistsResponse(request, 200); });
+    server->on("/api/playlists", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handlePlaylistAPI(request); }, nullptr, handleJsonBody);
+
+    // 渲染失败台账API：列出失败/隔离的图片，解除隔离或删除
+    server->on("/api/quarantine", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { sendQuarantineResponse(request); });
+    server->on("/api/quarantine", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleQuarantineAPI(request); });
+
     // 显示驱动控制API
     server->on("/api/display-driver", HTTP_GET, [this](AsyncWebServerRequest *request)
                { handleDisplayDriverAPI(request); });
     server->on("/api/display-driver", HTTP_POST, [this](AsyncWebServerRequest *request)
                { handleSetDisplayDriverAPI(request); });
 
+    // 图片下载API（支持Range断点续传和ETag）
+    server->on("/api/image", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleImageDownloadAPI(request); });
+
+    // 设备端基准测试API
+    server->on("/api/bench", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleBenchAPI(request); });
+    server->on("/api/bench", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleBenchStatusAPI(request); });
+
     // 添加OPTIONS请求处理 (CORS预检)
     server->on("/api/orientation", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
                {
@@ -378,6 +527,22 @@ namespace WebServerManager
                  response->addHeader("Access-Control-Allow-Headers", "Content-Type");
                  request->send(response); });
 
+    server->on("/api/playlists", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
+               {
+                 AsyncWebServerResponse *response = request->beginResponse(200);
+                 response->addHeader("Access-Control-Allow-Origin", "*");
+                 response->addHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+                 response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+                 request->send(response); });
+
+    server->on("/api/quarantine", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
+               {
+                 AsyncWebServerResponse *response = request->beginResponse(200);
+                 response->addHeader("Access-Control-Allow-Origin", "*");
+                 response->addHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+                 response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+                 request->send(response); });
+
     server->on("/api/display-driver", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
                {
                  AsyncWebServerResponse *response = request->beginResponse(200);
@@ -386,6 +551,14 @@ namespace WebServerManager
                  response->addHeader("Access-Control-Allow-Headers", "Content-Type");
                  request->send(response); });
 
+    server->on("/api/bench", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
+               {
+                 AsyncWebServerResponse *response = request->beginResponse(200);
+                 response->addHeader("Access-Control-Allow-Origin", "*");
+                 response->addHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+                 response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+                 request->send(response); });
+
     server->on("/api/upload-status", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
                {
                  AsyncWebServerResponse *response = request->beginResponse(200);
@@ -394,6 +567,36 @@ namespace WebServerManager
                  response->addHeader("Access-Control-Allow-Headers", "Content-Type");
                  request->send(response); });
 
+    // 批量操作API（JSON请求体）
+    server->on("/api/batch", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleBatchAPI(request); }, nullptr, handleJsonBody);
+    server->on("/api/batch", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
+               {
+                 AsyncWebServerResponse *response = request->beginResponse(200);
+                 response->addHeader("Access-Control-Allow-Origin", "*");
+                 response->addHeader("Access-Control-Allow-Methods", "POST, OPTIONS");
+                 response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+                 request->send(response); });
+
+    // 断点续传上传：init → PUT chunk（offset + crc）→ status → finalize
+    server->on("/api/upload/init", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleUploadInitAPI(request); });
+    server->on("/api/upload/chunk", HTTP_PUT, [this](AsyncWebServerRequest *request)
+               { handleUploadChunkAPI(request); }, nullptr, handleUploadChunkBody);
+    server->on("/api/upload/status", HTTP_GET, [this](AsyncWebServerRequest *request)
+               { handleUploadSessionAPI(request); });
+    server->on("/api/upload/finalize", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleUploadFinalizeAPI(request); });
+    server->on("/api/upload/abort", HTTP_POST, [this](AsyncWebServerRequest *request)
+               { handleUploadAbortAPI(request); });
+    server->on("/api/upload/*", HTTP_OPTIONS, [](AsyncWebServerRequest *request)
+               {
+                 AsyncWebServerResponse *response = request->beginResponse(200);
+                 response->addHeader("Access-Control-Allow-Origin", "*");
+                 response->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, OPTIONS");
+                 response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+                 request->send(response); });
+
     // 文件上传
     server->on("/upload", HTTP_POST, [](AsyncWebServerRequest *request)
                { request->send(200, "text/plain", "Upload complete"); }, handleFileUpload);
@@ -439,6 +642,26 @@ namespace WebServerManager
   
 
   
+  static void sendJsonResponse(AsyncWebServerRequest *request, int code, JsonDocument &doc)
+  {
+    String response;
+    serializeJson(doc, response);
+
+    AsyncWebServerResponse *apiResponse = request->beginResponse(code, "application/json", response);
+    apiResponse->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(apiResponse);
+  }
+
+  // 图片切换类API的统一响应。文件名可能来自旧固件或直接写入文件系统，
+  // 不保证经过 generateSafeFilename 清理，由 ArduinoJson 负责转义
+  static void sendCurrentImageResponse(AsyncWebServerRequest *request, const char *name)
+  {
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["current"] = name;
+    sendJsonResponse(request, 200, doc);
+  }
+
   void WebServerController::handleImageListAPI(AsyncWebServerRequest *request)
   {
     request->send(200, "application/json", getImageListJson());
@@ -447,8 +670,7 @@ namespace WebServerManager
   void WebServerController::handleNextImageAPI(AsyncWebServerRequest *request)
   {
     if (nextImage()) {
-      request->send(200, "application/json", 
-                   "{\"status\":\"ok\",\"current\":\"" + getCurrentImageName() + "\"}");
+      sendCurrentImageResponse(request, getCurrentImage().c_str());
     } else {
       request->send(400, "application/json", 
                    "{\"status\":\"error\",\"message\":\"No images available\"}");
@@ -458,8 +680,7 @@ namespace WebServerManager
   void WebServerController::handlePreviousImageAPI(AsyncWebServerRequest *request)
   {
     if (previousImage()) {
-      request->send(200, "application/json", 
-                   "{\"status\":\"ok\",\"current\":\"" + getCurrentImageName() + "\"}");
+      sendCurrentImageResponse(request, getCurrentImage().c_str());
     } else {
       request->send(400, "application/json", 
                    "{\"status\":\"error\",\"message\":\"No images available\"}");
@@ -471,8 +692,7 @@ namespace WebServerManager
     if (request->hasParam("index", true)) {
       int index = request->getParam("index", true)->value().toInt();
       if (setCurrentImage(index)) {
-        request->send(200, "application/json",
-                     "{\"status\":\"ok\",\"current\":\"" + getCurrentImageName() + "\"}");
+        sendCurrentImageResponse(request, getCurrentImage().c_str());
       } else {
         request->send(400, "application/json",
                      "{\"status\":\"error\",\"message\":\"Invalid image index\"}");
@@ -487,7 +707,10 @@ namespace WebServerManager
   {
     if (request->hasParam("filename", true)) {
       String filename = request->getParam("filename", true)->value();
-      if (deleteImage(filename)) {
+      // all=true 时连同重复上传产生的别名一起删除，否则只减少一个引用
+      bool allReferences = request->hasParam("all", true) &&
+                           request->getParam("all", true)->value() == "true";
+      if (deleteImage(filename, allReferences)) {
         request->send(200, "application/json", "{\"status\":\"ok\"}");
       } else {
         request->send(500, "application/json",
@@ -508,20 +731,61 @@ namespace WebServerManager
     doc["mdns"] = String(MDNS_HOSTNAME) + ".local";
     doc["uptime"] = millis() / 1000; // 运行时间（秒）
 
+    // WiFi连接与重连统计
+    Net::wifiLink.addToJson(doc["wifi_link"].to<JsonObject>());
+
     // 获取存储信息
     size_t totalBytes = LittleFS.totalBytes();
     size_t usedBytes = LittleFS.usedBytes();
     doc["storage"] = String(usedBytes / 1024) + "KB / " + String(totalBytes / 1024) + "KB";
 
     // 图片统计
-    doc["imageCount"] = imageCount;
-    doc["currentImage"] = getCurrentImageName();
-    doc["currentIndex"] = currentImageIndex;
+    {
+      Catalog::SnapshotRef snapshot;
+      doc["imageCount"] = snapshot->count;
+      doc["currentImage"] = snapshot->currentName();
+      doc["currentIndex"] = snapshot->current;
+    }
+    Catalog::catalog.addToJson(doc["catalog"].to<JsonObject>());
 
     // 幻灯片状态
     doc["slideshow_active"] = slideshowActive;
     doc["slideshow_interval"] = slideshowInterval / 1000; // 转换为秒
 
+    // 显示总线
+    doc["spi_frequency"] = Display::displayManager.getSPIFrequency();
+
+    // 内存与碎片（长时间运行稳定性）
+    Memory::HeapStats heap = Memory::getHeapStats();
+    JsonObject memory = doc["memory"].to<JsonObject>();
+    memory["free_heap"] = heap.freeHeap;
+    memory["min_free_heap"] = heap.minFreeHeap;
+    memory["largest_free_block"] = heap.largestFreeBlock;
+    memory["fragmentation"] = heap.fragmentation;
+    memory["arena_size"] = Memory::decodeArena.capacity();
+    memory["arena_high_water"] = Memory::decodeArena.highWater();
+    memory["arena_failures"] = Memory::decodeArena.failedAllocations();
+
+    // 内容去重统计
+    JsonObject dedup = doc["dedup"].to<JsonObject>();
+    dedup["aliases"] = Dedup::contentIndex.aliasCount();
+    dedup["saved_bytes"] = Dedup::contentIndex.savedBytes();
+
+    // 入库转码状态
+    JsonObject ingest = doc["ingest"].to<JsonObject>();
+    ingest["busy"] = Ingest::isBusy();
+    ingest["transcoded"] = Ingest::getTranscodedCount();
+
+    // 被更新请求中止的渲染次数
+    JsonObject render = doc["render"].to<JsonObject>();
+    render["cancelled"] = ImageDisplay::getCancelledRenderCount();
+    render["slices"] = ImageDisplay::getRenderSliceCount();
+    render["max_slice_us"] = ImageDisplay::getMaxRenderSliceMicros();
+    render["quarantined"] = Catalog::imageMeta.quarantinedCount();
+
+    // 启动各阶段完成时间（距上电毫秒数）
+    Boot::addToJson(doc["boot"].to<JsonObject>());
+
     String result;
     serializeJson(doc, result);
     request->send(200, "application/json", result);
@@ -557,6 +821,9 @@ namespace WebServerManager
     Serial.println("Color test API completed");
   }
 
+  // 下标与 ImageDisplay::DisplayMode 的取值一致
+  static const char *ORIENTATION_MODE_NAMES[] = {"AUTO_ROTATE", "SMART_SCALE", "CENTER_CROP", "FIT_SCREEN"};
+
   void WebServerController::handleOrientationAPI(AsyncWebServerRequest *request)
   {
     Serial.printf("Processing orientation API request: %s %s\n",
@@ -564,14 +831,14 @@ namespace WebServerManager
     JsonDocument doc;
 
     // 获取当前方向设置
-    doc["auto_rotation"] = true;         // 从ImageDisplayManager获取
-    doc["current_mode"] = "SMART_SCALE"; // 从ImageDisplayManager获取
-    doc["current_rotation"] = 1;         // 从ImageDisplayManager获取
-    doc["available_modes"] = JsonArray();
-    doc["available_modes"].add("AUTO_ROTATE");
-    doc["available_modes"].add("SMART_SCALE");
-    doc["available_modes"].add("CENTER_CROP");
-    doc["available_modes"].add("FIT_SCREEN");
+    ImageDisplay::ImageDisplayManager &manager = ImageDisplay::imageDisplayManager;
+    doc["auto_rotation"] = manager.isAutoRotationEnabled();
+    doc["current_mode"] = ORIENTATION_MODE_NAMES[(int)manager.getOrientationMode()];
+    doc["current_rotation"] = manager.getCurrentRotation();
+    JsonArray modes = doc["available_modes"].to<JsonArray>();
+    for (const char *name : ORIENTATION_MODE_NAMES) {
+      modes.add(name);
+    }
 
     String response;
     serializeJson(doc, response);
@@ -586,14 +853,29 @@ namespace WebServerManager
   {
     Serial.printf("Processing set orientation API request: %s %s\n",
                   request->methodToString(), request->url().c_str());
+    ImageDisplay::ImageDisplayManager &manager = ImageDisplay::imageDisplayManager;
+
     // 处理POST参数
     if (request->hasParam("mode", true))
     {
       String mode = request->getParam("mode", true)->value();
       Serial.printf("Setting orientation mode to: %s\n", mode.c_str());
 
-      // 这里需要调用ImageDisplayManager的方法
-      // imageDisplayManager.setOrientationMode(mode);
+      int modeIndex = -1;
+      for (size_t i = 0; i < sizeof(ORIENTATION_MODE_NAMES) / sizeof(ORIENTATION_MODE_NAMES[0]); i++) {
+        if (mode == ORIENTATION_MODE_NAMES[i]) {
+          modeIndex = i;
+          break;
+        }
+      }
+      if (modeIndex < 0) {
+        AsyncWebServerResponse *errorResponse = request->beginResponse(400, "application/json",
+                                                                       "{\"status\":\"error\",\"message\":\"Unknown orientation mode\"}");
+        errorResponse->addHeader("Access-Control-Allow-Origin", "*");
+        request->send(errorResponse);
+        return;
+      }
+      manager.setOrientationMode((ImageDisplay::DisplayMode)modeIndex);
     }
 
     if (request->hasParam("auto_rotation", true))
@@ -601,11 +883,11 @@ namespace WebServerManager
       String autoRotation = request->getParam("auto_rotation", true)->value();
       bool enable = (autoRotation == "true");
       Serial.printf("Setting auto rotation to: %s\n", enable ? "enabled" : "disabled");
-
-      // 这里需要调用ImageDisplayManager的方法
-      // imageDisplayManager.setAutoRotation(enable);
+      manager.setAutoRotation(enable);
     }
 
+    Settings::settingsStore.setOrientation((uint8_t)manager.getOrientationMode(), manager.isAutoRotationEnabled());
+
     JsonDocument doc;
     doc["status"] = "success";
     doc["message"] = "Orientation settings updated";
@@ -619,13 +901,183 @@ namespace WebServerManager
     request->send(apiResponse);
   }
 
+  // ==================== 图片下载 ====================
+
+  // 每次从LittleFS读取的最大字节数（一个闪存扇区）
+  static const size_t DOWNLOAD_CHUNK_SIZE = 4096;
+
+  // ETag：内容索引里有上传时流式算出的CRC32且大小一致时，作为强ETag；
+  // 否则（旧固件上传、被入库转码替换）用大小+修改时间作弱ETag，请求处理中不读取整个文件。
+  // 返回是否为强ETag（只有强ETag可用于 If-Range）
+  static bool makeETag(const char *name, File& file, char *etag, size_t etagSize)
+  {
+    uint32_t size = file.size();
+    uint32_t recordedSize, crc;
+    if (Dedup::contentIndex.lookup(name, recordedSize, crc) && recordedSize == size) {
+      snprintf(etag, etagSize, "\"%08lx\"", (unsigned long)crc);
+      return true;
+    }
+    snprintf(etag, etagSize, "W/\"%lx-%lx\"", (unsigned long)size, (unsigned long)file.getLastWrite());
+    return false;
+  }
+
+  static const char *imageContentType(const char *name)
+  {
+    const char *dot = strrchr(name, '.');
+    if (dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0)) return "image/jpeg";
+    if (dot && strcasecmp(dot, ".bmp") == 0) return "image/bmp";
+    if (dot && strcasecmp(dot, ".png") == 0) return "image/png";
+    return "application/octet-stream";
+  }
+
+  // 解析单个 "bytes=start-end" 区间；多区间或格式错误时返回false（按完整文件响应）
+  // 区间不可满足时 satisfiable 置为false
+  static bool parseRange(const char *header, uint32_t size, uint32_t &start, uint32_t &end, bool &satisfiable)
+  {
+    satisfiable = true;
+    if (strncmp(header, "bytes=", 6) != 0 || strchr(header, ',')) {
+      return false;
+    }
+
+    const char *spec = header + 6;
+    const char *dash = strchr(spec, '-');
+    if (!dash) {
+      return false;
+    }
+
+    char *parseEnd;
+    if (dash == spec) {
+      // 后缀区间: bytes=-N 表示最后N个字节
+      unsigned long suffix = strtoul(dash + 1, &parseEnd, 10);
+      if (parseEnd == dash + 1 || *parseEnd != '\0') return false;
+      if (suffix == 0 || size == 0) {
+        satisfiable = false;
+        return true;
+      }
+      start = suffix >= size ? 0 : size - suffix;
+      end = size - 1;
+      return true;
+    }
+
+    unsigned long first = strtoul(spec, &parseEnd, 10);
+    if (parseEnd != dash) return false;
+
+    unsigned long last = size > 0 ? size - 1 : 0;
+    if (dash[1] != '\0') {
+      last = strtoul(dash + 1, &parseEnd, 10);
+      if (*parseEnd != '\0' || last < first) return false;
+      if (last >= size) last = size - 1;
+    }
+
+    if (first >= size) {
+      satisfiable = false;
+      return true;
+    }
+
+    start = first;
+    end = last;
+    return true;
+  }
+
+  void WebServerController::handleImageDownloadAPI(AsyncWebServerRequest *request)
+  {
+    if (!request->hasParam("name")) {
+      request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Missing name parameter\"}");
+      return;
+    }
+
+    // 只允许访问根目录下的图片文件，不能借此读取Web资源或其他内部文件
+    const String &nameParam = request->getParam("name")->value();
+    const char *name = nameParam.c_str();
+    if (name[0] == '/') name++;
+    if (strchr(name, '/') || strlen(name) > ImageName::capacity() || !isValidImageFile(name)) {
+      request->send(400, "application/json", "{\"status\":\"error\",\"message\":\"Invalid image name\"}");
+      return;
+    }
+
+    ImagePath path = makeImagePath(name);
+    File file = LittleFS.open(path.c_str(), "r");
+    if (!file || file.isDirectory()) {
+      request->send(404, "application/json", "{\"status\":\"error\",\"message\":\"Image not found\"}");
+      return;
+    }
+
+    uint32_t size = file.size();
+    char etag[24];
+    bool strongETag = makeETag(name, file, etag, sizeof(etag));
+
+    // 条件请求：内容未变化时直接返回304
+    if (request->hasHeader("If-None-Match") &&
+        strstr(request->header("If-None-Match").c_str(), etag) != nullptr) {
+      AsyncWebServerResponse *response = request->beginResponse(304);
+      response->addHeader("ETag", etag);
+      request->send(response);
+      return;
+    }
+
+    uint32_t start = 0;
+    uint32_t end = size > 0 ? size - 1 : 0;
+    bool partial = false;
+
+    // If-Range 与当前ETag不一致（或只有弱ETag）时忽略Range，返回完整文件
+    bool rangeAllowed = !request->hasHeader("If-Range") || (strongETag && request->header("If-Range") == etag);
+    if (rangeAllowed && request->hasHeader("Range")) {
+      bool satisfiable;
+      partial = parseRange(request->header("Range").c_str(), size, start, end, satisfiable);
+      if (partial && !satisfiable) {
+        char contentRange[24];
+        snprintf(contentRange, sizeof(contentRange), "bytes */%lu", (unsigned long)size);
+        AsyncWebServerResponse *response = request->beginResponse(416);
+        response->addHeader("Content-Range", contentRange);
+        request->send(response);
+        return;
+      }
+    }
+
+    size_t length = size > 0 ? end - start + 1 : 0;
+
+    // 由网络层按发送窗口回调读取，每次最多读一个扇区，直接写入发送缓冲区
+    AsyncWebServerResponse *response = request->beginResponse(
+        imageContentType(name), length,
+        [file, start, length](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+          if (index >= length) return 0;
+          if (maxLen > length - index) maxLen = length - index;
+          if (maxLen > DOWNLOAD_CHUNK_SIZE) maxLen = DOWNLOAD_CHUNK_SIZE;
+          if (file.position() != start + index) {
+            file.seek(start + index);
+          }
+          return file.read(buffer, maxLen);
+        });
+
+    if (partial) {
+      char contentRange[48];
+      snprintf(contentRange, sizeof(contentRange), "bytes %lu-%lu/%lu",
+               (unsigned long)start, (unsigned long)end, (unsigned long)size);
+      response->setCode(206);
+      response->addHeader("Content-Range", contentRange);
+    }
+
+    char disposition[64];
+    snprintf(disposition, sizeof(disposition), "inline; filename=\"%s\"", name);
+    response->addHeader("Accept-Ranges", "bytes");
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    response->addHeader("Content-Disposition", disposition);
+    response->addHeader("Access-Control-Allow-Origin", "*");
+    response->addHeader("Access-Control-Expose-Headers", "ETag, Content-Range, Accept-Ranges");
+    request->send(response);
+  }
+
   void WebServerController::handleUploadStatusAPI(AsyncWebServerRequest *request)
   {
     Serial.println("Processing upload status API request");
     JsonDocument doc;
 
     // 获取系统状态信息
-    doc["free_heap"] = ESP.getFreeHeap();
+    Memory::HeapStats heap = Memory::getHeapStats();
+    doc["free_heap"] = heap.freeHeap;
+    doc["largest_free_block"] = heap.largestFreeBlock;
+    doc["fragmentation"] = heap.fragmentation;
     doc["used_storage"] = LittleFS.usedBytes();
     doc["total_storage"] = LittleFS.totalBytes();
     doc["available_storage"] = LittleFS.totalBytes() - LittleFS.usedBytes();
@@ -640,7 +1092,7 @@ namespace WebServerManager
     doc["estimated_uploadable_images"] = estimatedImageCount;
 
     // 当前图片数量
-    doc["current_image_count"] = imageCount;
+    doc["current_image_count"] = getImageCount();
 
     // 上传建议
     if (storageUsedPercent > 90)
@@ -672,21 +1124,42 @@ namespace WebServerManager
     Serial.println("Upload status API response sent");
   }
 
-  bool WebServerController::deleteImage(const String& filename)
+  // 删除一个图片名称：有别名时只释放一个引用（fileRemoved=false），否则删除文件
+  static bool releaseImage(const char* filename, bool allReferences, bool& fileRemoved)
   {
-    String fullPath = filename;
-    if (!fullPath.startsWith("/")) {
-      fullPath = "/" + fullPath;
+    ImagePath fullPath = makeImagePath(filename);
+    const char* name = fullPath.c_str() + 1;
+    fileRemoved = false;
+
+    if (allReferences) {
+      Dedup::contentIndex.removeAll(name);
+    } else if (Dedup::contentIndex.release(name) == Dedup::ReleaseResult::ALIAS_REMOVED) {
+      // 文件仍被其他上传引用，只删除了一个别名
+      Serial.printf("Released reference: %s (%u left)\n", name, Dedup::contentIndex.refCount(name));
+      return true;
     }
 
-    if (LittleFS.remove(fullPath)) {
+    if (LittleFS.remove(fullPath.c_str())) {
       Serial.printf("Deleted image: %s\n", fullPath.c_str());
-      scanImages(); // 重新扫描图片列表
+      fileRemoved = true;
+      // 由入库任务清理不再被引用的显示缓存
+      Ingest::notify();
       return true;
-    } else {
-      Serial.printf("Failed to delete image: %s\n", fullPath.c_str());
+    }
+    Serial.printf("Failed to delete image: %s\n", fullPath.c_str());
+    return false;
+  }
+
+  bool WebServerController::deleteImage(const String& filename, bool allReferences)
+  {
+    bool fileRemoved;
+    if (!releaseImage(filename.c_str(), allReferences, fileRemoved)) {
       return false;
     }
+    if (fileRemoved) {
+      scanImages(); // 重新扫描图片列表
+    }
+    return true;
   }
   
   // ==================== 便捷函数实现 ====================
@@ -695,6 +1168,11 @@ namespace WebServerManager
   {
     return webServerController.begin();
   }
+
+  bool startNetwork()
+  {
+    return webServerController.startNetwork();
+  }
   
   bool isRunning()
   {
@@ -720,6 +1198,11 @@ namespace WebServerManager
   {
     return webServerController.getCurrentImageName();
   }
+
+  ImageName getCurrentImage()
+  {
+    return webServerController.getCurrentImage();
+  }
   
   int getCurrentImageIndex()
   {
@@ -815,161 +1298,132 @@ namespace WebServerManager
 
   // ==================== 图片验证函数 ====================
 
-  bool validateUploadedImage(const String &filename)
+  bool validateUploadedImage(const char *filename)
   {
-    // 检查文件是否存在
-    if (!LittleFS.exists(filename))
-    {
-      Serial.printf("Validation failed: file not found %s\n", filename.c_str());
-      return false;
-    }
-
-    // 获取文件大小
     File file = LittleFS.open(filename, "r");
     if (!file)
     {
-      Serial.printf("Validation failed: cannot open %s\n", filename.c_str());
+      Serial.printf("Validation failed: cannot open %s\n", filename);
       return false;
     }
 
-    size_t fileSize = file.size();
-    if (fileSize == 0)
-    {
-      Serial.printf("Validation failed: empty file %s\n", filename.c_str());
-      file.close();
-      return false;
-    }
+    // 只读取文件头判断格式
+    uint32_t fileSize = file.size();
+    uint8_t head[Upload::IMAGE_HEAD_BYTES];
+    size_t headLen = file.read(head, sizeof(head));
+    file.close();
 
-    if (fileSize > MAX_FILE_SIZE)
+    if (!Upload::validateImageData(filename, head, headLen, fileSize))
     {
-      Serial.printf("Validation failed: file too large %d bytes\n", fileSize);
-      file.close();
+      Serial.printf("Validation failed for %s (%u bytes)\n", filename, (unsigned)fileSize);
       return false;
     }
 
-    // 检查JPEG文件头
-    String ext = filename.substring(filename.lastIndexOf('.'));
-    ext.toLowerCase();
+    Serial.printf("Valid image: %s (%u bytes)\n", filename, (unsigned)fileSize);
+    return true;
+  }
 
-    if (ext == ".jpg" || ext == ".jpeg")
-    {
-      // 读取JPEG文件头
-      uint8_t header[4];
-      if (file.read(header, 4) == 4)
-      {
-        // JPEG文件应该以 FF D8 开头
-        if (header[0] == 0xFF && header[1] == 0xD8)
-        {
-          Serial.println("Valid JPEG header detected");
-          file.close();
-          return true;
-        }
-        else
-        {
-          Serial.printf("Invalid JPEG header: %02X %02X %02X %02X\n",
-                        header[0], header[1], header[2], header[3]);
-        }
-      }
-    }
-    else if (ext == ".bmp")
-    {
-      // 读取BMP文件头
-      uint8_t header[2];
-      if (file.read(header, 2) == 2)
-      {
-        // BMP文件应该以 "BM" 开头
-        if (header[0] == 'B' && header[1] == 'M')
-        {
-          Serial.println("Valid BMP header detected");
-          file.close();
-          return true;
-        }
-        else
-        {
-          Serial.printf("Invalid BMP header: %c%c\n", header[0], header[1]);
-        }
-      }
-    }
-
-    file.close();
-    Serial.printf("Validation failed for %s\n", filename.c_str());
-    return false;
-  }
 
   // ==================== 静态函数实现 ====================
 
   void WebServerController::handleFileUpload(AsyncWebServerRequest *request, String filename,
                                             size_t index, uint8_t *data, size_t len, bool final)
   {
+    // 先写入隐藏的临时文件，校验通过后再原子重命名为正式文件名，
+    // 上传过程中扫描图片列表或意外重启都不会让半截文件进入图片列表
     static File uploadFile;
-    static String safeFilename;
+    static ImagePath tempFilename;
+    static ImagePath safeFilename;
+    static Upload::ImageStreamCheck streamCheck;
+    static bool uploadFailed = false;
 
     if (!index) {
       // 开始上传
       Serial.printf("Upload start: %s\n", filename.c_str());
 
-      // 生成安全的文件名
-      safeFilename = webServerController.generateSafeFilename(filename);
+      // 上一次上传中途断开时遗留的临时文件
+      if (uploadFile) {
+        uploadFile.close();
+        LittleFS.remove(tempFilename.c_str());
+      }
+
+      // 生成安全的文件名（确保以斜杠开头）
+      safeFilename = makeImagePath(webServerController.generateSafeFilename(filename.c_str()).c_str());
       Serial.printf("Safe filename: %s\n", safeFilename.c_str());
 
-      // 确保文件名以斜杠开头
-      if (!safeFilename.startsWith("/"))
-      {
-        safeFilename = "/" + safeFilename;
-      }
+      uploadFailed = false;
+      streamCheck.reset();
 
       // 检查文件扩展名
-      String ext = safeFilename.substring(safeFilename.lastIndexOf('.'));
-      ext.toLowerCase();
-      if (ext != ".jpg" && ext != ".jpeg" && ext != ".bmp" && ext != ".png")
+      if (!hasImageExtension(safeFilename.c_str()))
       {
         Serial.println("Unsupported file format");
+        uploadFailed = true;
         return;
       }
 
-      // 检查文件大小限制
-      if (len > MAX_FILE_SIZE)
-      {
-        Serial.printf("File too large: %d bytes (max: %d)\n", len, MAX_FILE_SIZE);
-        return;
-      }
+      tempFilename.clear();
+      tempFilename.appendf(UPLOAD_TEMP_PREFIX "%08lx%s", (unsigned long)esp_random(), strrchr(safeFilename.c_str(), '.'));
 
-      uploadFile = LittleFS.open(safeFilename, "w");
+      uploadFile = LittleFS.open(tempFilename.c_str(), "w");
       if (!uploadFile) {
-        Serial.printf("Failed to open file for writing: %s\n", safeFilename.c_str());
+        Serial.printf("Failed to open file for writing: %s\n", tempFilename.c_str());
         Serial.printf("Used: %d, Total: %d\n", LittleFS.usedBytes(), LittleFS.totalBytes());
-        Serial.printf("Filename length: %d\n", safeFilename.length());
+        uploadFailed = true;
         return;
       }
     }
 
-    if (uploadFile) {
-      // 写入数据
-      uploadFile.write(data, len);
+    if (uploadFile && !uploadFailed) {
+      // 检查文件大小限制（按累计大小，而不只是第一个数据块）
+      if (index + len > MAX_FILE_SIZE)
+      {
+        Serial.printf("File too large: more than %d bytes\n", MAX_FILE_SIZE);
+        uploadFailed = true;
+      }
+      else if (uploadFile.write(data, len) != len)
+      {
+        Serial.println("Write failed, storage may be full");
+        uploadFailed = true;
+      }
+      else
+      {
+        streamCheck.update(data, len);
+      }
     }
 
     if (final) {
-      // 上传完成
-      if (uploadFile) {
-        uploadFile.close();
-        Serial.printf("Upload complete: %s (%d bytes)\n", safeFilename.c_str(), index + len);
+      if (!uploadFile) {
+        return;
+      }
 
-        // 验证上传的图片文件
-        if (validateUploadedImage(safeFilename))
-        {
-          Serial.println("Image validation successful");
-          // 重新扫描图片列表
-          webServerController.scanImages();
-        }
-        else
-        {
-          Serial.println("Image validation failed, removing file");
-          LittleFS.remove(safeFilename);
-        }
+      // close 会把LittleFS缓存中的数据和元数据写入闪存（相当于fsync）
+      uploadFile.flush();
+      uploadFile.close();
+      Serial.printf("Upload complete: %s (%u bytes)\n", safeFilename.c_str(), (unsigned)(index + len));
+
+      // 用上传过程中收集的文件头校验，不需要重新读回文件
+      bool valid = !uploadFailed && streamCheck.isValid(safeFilename.c_str());
+      if (valid && LittleFS.rename(tempFilename.c_str(), safeFilename.c_str()))
+      {
+        Dedup::contentIndex.addFile(safeFilename.c_str() + 1, streamCheck.size(), streamCheck.crc());
+        // 同名文件被替换：旧内容的失败记录不再适用
+        Catalog::imageMeta.clearFailures(safeFilename.c_str() + 1);
+        Serial.println("Image validation successful");
+        // 重新扫描图片列表
+        webServerController.scanImages();
+        // 查重（逐字节比较）和大图转码交给后台任务，不阻塞 async_tcp
+        Ingest::notifyUploaded(safeFilename.c_str());
+      }
+      else
+      {
+        Serial.println("Image validation failed, removing file");
+        LittleFS.remove(tempFilename.c_str());
       }
     }
   }
 
+
   // ==================== 幻灯片控制函数实现 ====================
 
   bool WebServerController::toggleSlideshow()
@@ -986,14 +1440,16 @@ namespace WebServerManager
 
   bool WebServerController::startSlideshow()
   {
-    if (imageCount <= 1)
+    if (getImageCount() <= 1)
     {
       Serial.println("Cannot start slideshow: need at least 2 images");
       return false;
     }
 
     slideshowActive = true;
-    lastSlideshowChange = millis();
+    slideSwitchPending = false;
+    armSlideDeadline(millis());
+    Settings::settingsStore.setSlideshow(slideshowActive, slideshowInterval);
     Serial.printf("Slideshow started with %lu ms interval\n", slideshowInterval);
     return true;
   }
@@ -1001,6 +1457,7 @@ namespace WebServerManager
   bool WebServerController::stopSlideshow()
   {
     slideshowActive = false;
+    Settings::settingsStore.setSlideshow(slideshowActive, slideshowInterval);
     Serial.println("Slideshow stopped");
     return true;
   }
@@ -1014,23 +1471,119 @@ namespace WebServerManager
       interval = 600000;
 
     slideshowInterval = interval;
+    Settings::settingsStore.setSlideshow(slideshowActive, slideshowInterval);
     Serial.printf("Slideshow interval set to %lu ms\n", slideshowInterval);
   }
 
+  void WebServerController::armSlideDeadline(unsigned long from)
+  {
+    slideDeadline = from + Playlist::playlistManager.currentDwell(slideshowInterval);
+    slideSwitchTimeValid = false;
+  }
+
+  unsigned long WebServerController::getSlideSwitchTime()
+  {
+    // 主循环每轮都会调用：下一张及其耗时只在截止时间重新设定或图片列表变化后算一次，
+    // 避免每轮都经 peekNext 移动再恢复播放列表游标（洗牌时还要重排）
+    uint32_t version = Catalog::catalog.version();
+    if (slideSwitchTimeValid && slideSwitchVersion == version) {
+      return slideSwitchTime;
+    }
+
+    Catalog::SnapshotRef snapshot;
+    slideSwitchTime = slideDeadline;
+    if (snapshot->count > 1) {
+      int next = Playlist::playlistManager.isActive() ? Playlist::playlistManager.peekNext() : -1;
+      if (next < 0 || next >= snapshot->count) {
+        next = (snapshot->current + 1) % snapshot->count;
+      }
+      // 下一张的预计渲染耗时从截止时间中扣除，提前开始解码
+      slideSwitchTime -= Catalog::imageMeta.expectedRenderCost(snapshot->names[next].c_str());
+    }
+    slideSwitchVersion = version;
+    slideSwitchTimeValid = true;
+    return slideSwitchTime;
+  }
+
   void WebServerController::updateSlideshow()
   {
-    if (!slideshowActive || imageCount <= 1)
+    // 上一次切换的图片还没画完时不推进，截止时间在画完后更新
+    if (!slideshowActive || slideSwitchPending || getImageCount() <= 1)
     {
       return;
     }
 
-    unsigned long currentTime = millis();
-    if (currentTime - lastSlideshowChange >= slideshowInterval)
+    if ((long)(millis() - getSlideSwitchTime()) >= 0)
     {
+      int previous = getCurrentImageIndex();
+      slideSwitchPending = true;
       nextImage();
-      lastSlideshowChange = currentTime;
-      Serial.printf("Slideshow auto-switched to: %s\n", getCurrentImageName().c_str());
+      if (getCurrentImageIndex() == previous) {
+        // 只有一项的播放列表、其余图片都被隔离时会停在原地：不会重画，
+        // 也就等不到 onFrameRendered，这里直接开始下一个间隔
+        onSwitchSettled(millis());
+        return;
+      }
+      Serial.printf("Slideshow auto-switched to: %s\n", getCurrentImage().c_str());
+    }
+  }
+
+  unsigned long WebServerController::getMillisUntilSlideSwitch()
+  {
+    if (!slideshowActive || slideSwitchPending || getImageCount() <= 1) {
+      return UINT32_MAX;
     }
+    long remaining = (long)(getSlideSwitchTime() - millis());
+    return remaining > 0 ? remaining : 0;
+  }
+
+  void WebServerController::onFrameRendered(const char *name, bool success, unsigned long startMs, unsigned long endMs)
+  {
+    if (success) {
+      Catalog::imageMeta.recordRenderCost(name, endMs - startMs);
+    } else {
+      // 记入失败台账；内存不足是暂时性的，不算图片本身的问题
+      ImageDisplay::RenderError error = ImageDisplay::getLastRenderError();
+      if (error != ImageDisplay::RenderError::NONE && error != ImageDisplay::RenderError::NO_MEMORY &&
+          Catalog::imageMeta.recordFailure(name, (uint8_t)error, ImageDisplay::getLastRenderDetail())) {
+        Serial.printf("Quarantined %s after repeated %s errors\n", name, ImageDisplay::renderErrorName(error));
+      }
+    }
+
+    if (!slideSwitchPending) {
+      return;
+    }
+    slideSwitchPending = false;
+
+    // 偏差 = 实际画完的时间 - 截止时间（正数为迟到）
+    long jitter = (long)(endMs - slideDeadline);
+    uint32_t magnitude = jitter < 0 ? -jitter : jitter;
+    slideJitter.frames++;
+    slideJitter.lastMs = jitter;
+    slideJitter.totalAbsMs += magnitude;
+    if (magnitude > slideJitter.maxAbsMs) {
+      slideJitter.maxAbsMs = magnitude;
+    }
+
+    // 下一个截止时间从本次截止时间起算，渲染耗时不累积成漂移；
+    // 落后超过一个间隔（例如Flash繁忙）时从当前时间重新对齐
+    unsigned long dwell = Playlist::playlistManager.currentDwell(slideshowInterval);
+    slideDeadline += dwell;
+    if ((long)(endMs - slideDeadline) >= 0) {
+      slideDeadline = endMs + dwell;
+      slideJitter.resyncs++;
+    }
+    slideSwitchTimeValid = false;
+  }
+
+  void WebServerController::onSwitchSettled(unsigned long nowMs)
+  {
+    // 不结束等待的话 updateSlideshow 会一直跳过，幻灯片停住
+    if (!slideSwitchPending) {
+      return;
+    }
+    slideSwitchPending = false;
+    armSlideDeadline(nowMs);
   }
 
   void WebServerController::handleSlideshowAPI(AsyncWebServerRequest *request)
@@ -1092,8 +1645,20 @@ namespace WebServerManager
     JsonDocument doc;
     doc["slideshow_active"] = slideshowActive;
     doc["interval"] = slideshowInterval / 1000; // 转换为秒
-    doc["image_count"] = imageCount;
-    doc["current_image"] = getCurrentImageName();
+    {
+      Catalog::SnapshotRef snapshot;
+      doc["image_count"] = snapshot->count;
+      doc["current_image"] = snapshot->currentName();
+    }
+    doc["playlist"] = Playlist::playlistManager.activeName();
+
+    // 实际换图时间与设定节拍的偏差（毫秒）
+    JsonObject jitter = doc["jitter"].to<JsonObject>();
+    jitter["frames"] = slideJitter.frames;
+    jitter["last_ms"] = slideJitter.lastMs;
+    jitter["mean_abs_ms"] = slideJitter.frames ? slideJitter.totalAbsMs / slideJitter.frames : 0;
+    jitter["max_abs_ms"] = slideJitter.maxAbsMs;
+    jitter["resyncs"] = slideJitter.resyncs;
     doc["status"] = "ok";
 
     String response;
@@ -1159,6 +1724,7 @@ namespace WebServerManager
       {
         if (Display::switchDriver(driverType))
         {
+          Settings::settingsStore.setDisplayDriver(driverType);
           doc["status"] = "ok";
           doc["current_driver"] = Display::getCurrentDriverName();
           doc["current_driver_type"] = (int)Display::getCurrentDriver();
@@ -1186,4 +1752,722 @@ namespace WebServerManager
 
     Serial.println("Set display driver API response sent");
   }
+
+  static const char* benchStateName(Benchmark::BenchJobState state)
+  {
+    switch (state) {
+      case Benchmark::BenchJobState::QUEUED:  return "queued";
+      case Benchmark::BenchJobState::RUNNING: return "running";
+      case Benchmark::BenchJobState::DONE:    return "done";
+      default:                                return "idle";
+    }
+  }
+
+  static void addTimingSummary(JsonObject obj, const Benchmark::TimingSummary& timing)
+  {
+    obj["min_us"] = timing.min;
+    obj["median_us"] = timing.median;
+    obj["p99_us"] = timing.p99;
+  }
+
+  void WebServerController::handleBenchAPI(AsyncWebServerRequest *request)
+  {
+    Serial.printf("Processing bench API request: %s %s\n",
+                  request->methodToString(), request->url().c_str());
+
+    JsonDocument doc;
+    int responseCode = 202;
+
+    Benchmark::BenchSource source = Benchmark::BenchSource::CATALOG;
+    if (request->hasParam("source", true) &&
+        request->getParam("source", true)->value() == "synthetic")
+    {
+      source = Benchmark::BenchSource::SYNTHETIC;
+    }
+
+    int iterations = 3;
+    if (request->hasParam("iterations", true))
+    {
+      iterations = request->getParam("iterations", true)->value().toInt();
+    }
+
+    // pipeline=runtime 强制走经 DisplayManager 的通用像素写入路径，与默认的专用路径对比
+    bool staticPipeline = !(request->hasParam("pipeline", true) &&
+                            request->getParam("pipeline", true)->value() == "runtime");
+
+    if (source == Benchmark::BenchSource::CATALOG && getImageCount() == 0)
+    {
+      responseCode = 400;
+      doc["status"] = "error";
+      doc["message"] = "No images to benchmark, use source=synthetic";
+    }
+    else if (!Benchmark::queueBenchJob(source, iterations < 1 ? 1 : (iterations > 255 ? 255 : iterations), staticPipeline))
+    {
+      responseCode = 409;
+      doc["status"] = "error";
+      doc["message"] = "A benchmark job is already queued or running";
+    }
+    else
+    {
+      doc["status"] = "queued";
+      doc["source"] = source == Benchmark::BenchSource::SYNTHETIC ? "synthetic" : "catalog";
+      doc["pipeline"] = staticPipeline ? "static" : "runtime";
+      doc["max_iterations"] = BENCH_JOB_MAX_ITERATIONS;
+      doc["message"] = "Poll GET /api/bench for results";
+    }
+
+    String response;
+    serializeJson(doc, response);
+
+    AsyncWebServerResponse *apiResponse = request->beginResponse(responseCode, "application/json", response);
+    apiResponse->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(apiResponse);
+  }
+
+  void WebServerController::handleBenchStatusAPI(AsyncWebServerRequest *request)
+  {
+    JsonDocument doc;
+    Benchmark::BenchJobState state = Benchmark::getBenchJobState();
+    doc["status"] = benchStateName(state);
+
+    if (state == Benchmark::BenchJobState::DONE)
+    {
+      const Benchmark::BenchJobResult& result = Benchmark::getBenchJobResult();
+      JsonObject obj = doc["result"].to<JsonObject>();
+      obj["source"] = result.source == Benchmark::BenchSource::SYNTHETIC ? "synthetic" : "catalog";
+      obj["iterations"] = result.iterations;
+      obj["frames"] = result.frames;
+      obj["failures"] = result.failures;
+      addTimingSummary(obj["decode"].to<JsonObject>(), result.decode);
+      addTimingSummary(obj["transfer"].to<JsonObject>(), result.transfer);
+      addTimingSummary(obj["total"].to<JsonObject>(), result.total);
+      obj["bytes"] = result.bytes;
+      obj["spi_mbps"] = result.spiMBps;
+      obj["spi_frequency"] = result.spiFrequency;
+      obj["heap_low_water"] = result.heapLowWater;
+      obj["elapsed_ms"] = result.elapsedMillis;
+      obj["driver"] = Display::displayManager.getCurrentDriverName();
+      obj["pipeline"] = result.staticPipeline ? "static" : "runtime";
+    }
+
+    String response;
+    serializeJson(doc, response);
+
+    AsyncWebServerResponse *apiResponse = request->beginResponse(200, "application/json", response);
+    apiResponse->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(apiResponse);
+  }
+
+  // ==================== 断点续传上传 ====================
+
+  static int uploadResultStatus(Upload::UploadResult result)
+  {
+    switch (result) {
+      case Upload::UploadResult::OK:           return 200;
+      case Upload::UploadResult::NOT_FOUND:    return 404;
+      case Upload::UploadResult::TOO_LARGE:    return 413;
+      case Upload::UploadResult::NO_SLOT:      return 503;
+      case Upload::UploadResult::CRC_MISMATCH: return 422;
+      case Upload::UploadResult::INCOMPLETE:   return 409;
+      case Upload::UploadResult::BUSY:         return 409;
+      case Upload::UploadResult::IO_ERROR:     return 500;
+      default:                                 return 400;
+    }
+  }
+
+  static void sendUploadError(AsyncWebServerRequest *request, Upload::UploadResult result)
+  {
+    JsonDocument doc;
+    doc["status"] = "error";
+    doc["message"] = Upload::resultMessage(result);
+    sendJsonResponse(request, uploadResultStatus(result), doc);
+  }
+
+  // 会话ID以8位十六进制字符串传递
+  static Upload::UploadSession *findUploadSession(AsyncWebServerRequest *request, bool post, uint32_t &id)
+  {
+    if (!request->hasParam("id", post)) {
+      return nullptr;
+    }
+    id = strtoul(request->getParam("id", post)->value().c_str(), nullptr, 16);
+    return Upload::resumableUploads.find(id);
+  }
+
+  static void addUploadProgress(JsonDocument &doc, const Upload::UploadSession &session)
+  {
+    char idText[9];
+    snprintf(idText, sizeof(idText), "%08lx", (unsigned long)session.id);
+    doc["upload_id"] = idText;
+    doc["name"] = session.name.c_str();
+    doc["size"] = session.size;
+    doc["chunk_size"] = UPLOAD_CHUNK_SIZE;
+    doc["received_bytes"] = session.receivedBytes();
+    doc["complete"] = session.isComplete();
+
+    Upload::ByteRange ranges[16];
+    uint8_t count = session.getRanges(ranges, 16);
+    JsonArray rangeArray = doc["ranges"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+      JsonArray range = rangeArray.add<JsonArray>();
+      range.add(ranges[i].start);
+      range.add(ranges[i].end);
+    }
+  }
+
+  void WebServerController::handleUploadInitAPI(AsyncWebServerRequest *request)
+  {
+    if (!request->hasParam("name", true) || !request->hasParam("size", true)) {
+      sendUploadError(request, Upload::UploadResult::INVALID);
+      return;
+    }
+
+    const String &name = request->getParam("name", true)->value();
+    uint32_t size = strtoul(request->getParam("size", true)->value().c_str(), nullptr, 10);
+
+    // 可选：整个文件的CRC32（十六进制），finalize时校验
+    bool hasFileCrc = request->hasParam("crc", true);
+    uint32_t fileCrc = hasFileCrc ? strtoul(request->getParam("crc", true)->value().c_str(), nullptr, 16) : 0;
+
+    // 预留空间检查，避免传到一半才发现存储已满
+    if (size > LittleFS.totalBytes() - LittleFS.usedBytes()) {
+      JsonDocument doc;
+      doc["status"] = "error";
+      doc["message"] = "Insufficient storage space";
+      sendJsonResponse(request, 507, doc);
+      return;
+    }
+
+    uint32_t id;
+    Upload::UploadResult result = Upload::resumableUploads.init(name.c_str(), size, hasFileCrc, fileCrc, id);
+    if (result != Upload::UploadResult::OK) {
+      sendUploadError(request, result);
+      return;
+    }
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    addUploadProgress(doc, *Upload::resumableUploads.find(id));
+    sendJsonResponse(request, 200, doc);
+  }
+
+  void WebServerController::handleUploadChunkBody(AsyncWebServerRequest *request, uint8_t *data,
+                                                  size_t len, size_t index, size_t total)
+  {
+    uint32_t id;
+    if (!findUploadSession(request, false, id)) {
+      return;
+    }
+
+    if (index == 0) {
+      uint32_t offset = request->hasParam("offset") ? strtoul(request->getParam("offset")->value().c_str(), nullptr, 10) : UINT32_MAX;
+      uint32_t crc = request->hasParam("crc") ? strtoul(request->getParam("crc")->value().c_str(), nullptr, 16) : 0;
+      if (Upload::resumableUploads.beginChunk(id, request, offset, total, crc) != Upload::UploadResult::OK) {
+        return;
+      }
+    }
+
+    // 分块属于其他请求时 writeChunk/endChunk 不会改动会话
+    Upload::resumableUploads.writeChunk(id, request, data, len);
+
+    if (index + len == total) {
+      Upload::resumableUploads.endChunk(id, request);
+    }
+  }
+
+  void WebServerController::handleUploadChunkAPI(AsyncWebServerRequest *request)
+  {
+    uint32_t id;
+    Upload::UploadSession *session = findUploadSession(request, false, id);
+    if (!session) {
+      sendUploadError(request, Upload::UploadResult::NOT_FOUND);
+      return;
+    }
+
+    // 空请求体不会触发body回调，不能沿用上一个分块的结果；
+    // 同一会话的另一个分块正在传输时返回409
+    Upload::UploadResult result = request->contentLength() == 0
+      ? Upload::UploadResult::BAD_LENGTH
+      : Upload::resumableUploads.chunkResult(id, request);
+    if (result != Upload::UploadResult::OK) {
+      sendUploadError(request, result);
+      return;
+    }
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["received_bytes"] = session->receivedBytes();
+    doc["complete"] = session->isComplete();
+    sendJsonResponse(request, 200, doc);
+  }
+
+  void WebServerController::handleUploadSessionAPI(AsyncWebServerRequest *request)
+  {
+    uint32_t id;
+    Upload::UploadSession *session = findUploadSession(request, false, id);
+    if (!session) {
+      sendUploadError(request, Upload::UploadResult::NOT_FOUND);
+      return;
+    }
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    addUploadProgress(doc, *session);
+    sendJsonResponse(request, 200, doc);
+  }
+
+  void WebServerController::handleUploadFinalizeAPI(AsyncWebServerRequest *request)
+  {
+    uint32_t id;
+    Upload::UploadSession *session = findUploadSession(request, true, id);
+    if (!session) {
+      sendUploadError(request, Upload::UploadResult::NOT_FOUND);
+      return;
+    }
+
+    ImageName finalName = generateSafeFilename(session->name.c_str());
+    ImagePath finalPath = makeImagePath(finalName.c_str());
+
+    uint32_t size = session->size;
+    bool hasFileCrc = session->hasFileCrc;
+    uint32_t fileCrc = session->fileCrc;
+
+    Upload::UploadResult result = Upload::resumableUploads.finalize(id, finalPath.c_str(), validateUploadedImage);
+    if (result != Upload::UploadResult::OK) {
+      sendUploadError(request, result);
+      return;
+    }
+
+    // 分块可能乱序到达，客户端没有提供整文件CRC时不在这里读回文件，由后台任务补算
+    if (hasFileCrc) {
+      Dedup::contentIndex.addFile(finalName.c_str(), size, fileCrc);
+    }
+    Catalog::imageMeta.clearFailures(finalName.c_str());
+    scanImages();
+    Ingest::notifyUploaded(finalName.c_str(), hasFileCrc);
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["filename"] = finalName.c_str();
+    doc["image_count"] = getImageCount();
+    sendJsonResponse(request, 200, doc);
+  }
+
+  void WebServerController::handleUploadAbortAPI(AsyncWebServerRequest *request)
+  {
+    uint32_t id;
+    if (!findUploadSession(request, true, id)) {
+      sendUploadError(request, Upload::UploadResult::NOT_FOUND);
+      return;
+    }
+
+    Upload::resumableUploads.abort(id);
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    sendJsonResponse(request, 200, doc);
+  }
+
+  // ==================== 批量操作 ====================
+  // 请求体：{"ops":[{"op":"delete","name":"a.jpg","all":false},
+  //                 {"op":"rename","name":"b.jpg","to":"c.jpg"},
+  //                 {"op":"reorder","order":["c.jpg","d.jpg"]}]}
+  // 先在图片列表副本上按顺序模拟全部操作，任何一步不合法则整批不执行；
+  // 执行时逐个修改文件，最后一次性更新图片列表，不再逐个重新扫描目录。
+
+  static int findImageIndex(const ImageName *list, int count, const char *name)
+  {
+    for (int i = 0; i < count; i++) {
+      if (list[i] == name) return i;
+    }
+    return -1;
+  }
+
+  // 重命名目标：只允许字母、数字、'_'、'-'，扩展名必须与原文件相同（图片格式不变）
+  static bool isValidRenameTarget(const char *from, const char *to)
+  {
+    const char *fromExt = strrchr(from, '.');
+    const char *toExt = strrchr(to, '.');
+    size_t length = strlen(to);
+    if (!fromExt || !toExt || toExt == to || length > ImageName::capacity() ||
+        strcasecmp(fromExt, toExt) != 0) {
+      return false;
+    }
+    for (const char *c = to; c < toExt; c++) {
+      if (!isalnum((unsigned char)*c) && *c != '_' && *c != '-') {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static bool saveImageOrder(const ImageName *list, int count)
+  {
+    static const char *tempPath = IMAGE_ORDER_PATH ".tmp";
+    File file = LittleFS.open(tempPath, "w");
+    if (!file) {
+      return false;
+    }
+    bool ok = true;
+    for (int i = 0; ok && i < count; i++) {
+      ok = file.print(list[i].c_str()) == list[i].length() && file.print('\n') == 1;
+    }
+    file.close();
+    if (!ok || !LittleFS.rename(tempPath, IMAGE_ORDER_PATH)) {
+      LittleFS.remove(tempPath);
+      return false;
+    }
+    return true;
+  }
+
+  void WebServerController::handleJsonBody(AsyncWebServerRequest *request, uint8_t *data,
+                                            size_t len, size_t index, size_t total)
+  {
+    // JSON请求体缓存到 _tempObject（/api/batch、/api/playlists），随请求一起释放；
+    // 超过上限的请求体不缓存，处理函数返回413
+    if (total > BATCH_MAX_BODY_SIZE) {
+      return;
+    }
+    if (index == 0) {
+      request->_tempObject = malloc(total + 1);
+    }
+    char *buffer = (char *)request->_tempObject;
+    if (!buffer || index + len > total) {
+      return;
+    }
+    memcpy(buffer + index, data, len);
+    buffer[index + len] = '\0';
+  }
+
+  // op >= 0 时附带出错的操作序号
+  static void sendJsonError(AsyncWebServerRequest *request, int code, const char *message, int op = -1)
+  {
+    JsonDocument doc;
+    doc["status"] = "error";
+    if (op >= 0) {
+      doc["op"] = op;
+    }
+    doc["message"] = message;
+    sendJsonResponse(request, code, doc);
+  }
+
+  void WebServerController::handleBatchAPI(AsyncWebServerRequest *request)
+  {
+    if (request->contentLength() > BATCH_MAX_BODY_SIZE) {
+      sendJsonError(request, 413, "Request body too large");
+      return;
+    }
+
+    const char *body = (const char *)request->_tempObject;
+    JsonDocument batch;
+    if (!body || deserializeJson(batch, body)) {
+      sendJsonError(request, 400, "Invalid JSON body");
+      return;
+    }
+
+    JsonArrayConst ops = batch["ops"];
+    if (ops.isNull() || ops.size() == 0 || ops.size() > BATCH_MAX_OPS) {
+      sendJsonError(request, 400, "ops must be a non-empty array");
+      return;
+    }
+
+    // 1. 校验：在副本上模拟（只在Web任务中调用，用静态缓冲区避免占用任务栈）
+    // 从校验到发布持有写锁，期间其他写端（上传、入库转码、幻灯片换图）等待，读者不受影响
+    Catalog::WriterLock writer;
+    static ImageName working[MAX_IMAGES];
+    static uint8_t refs[MAX_IMAGES];
+    int workingCount = imageCount;
+    for (int i = 0; i < imageCount; i++) {
+      working[i] = imageList[i];
+      refs[i] = max<uint8_t>(1, Dedup::contentIndex.refCount(imageList[i].c_str()));
+    }
+
+    bool reordered = false;
+    int opIndex = 0;
+    for (JsonObjectConst op : ops) {
+      const char *type = op["op"] | "";
+      const char *name = op["name"] | "";
+
+      if (strcmp(type, "delete") == 0) {
+        int idx = findImageIndex(working, workingCount, name);
+        if (idx < 0) {
+          sendJsonError(request, 404, "Image not found", opIndex);
+          return;
+        }
+        // 有别名的图片删除一次只减少一个引用，仍留在列表中
+        if (!(op["all"] | false) && refs[idx] > 1) {
+          refs[idx]--;
+        } else {
+          for (int i = idx; i < workingCount - 1; i++) {
+            working[i] = working[i + 1];
+            refs[i] = refs[i + 1];
+          }
+          workingCount--;
+        }
+      } else if (strcmp(type, "rename") == 0) {
+        const char *to = op["to"] | "";
+        int idx = findImageIndex(working, workingCount, name);
+        if (idx < 0) {
+          sendJsonError(request, 404, "Image not found", opIndex);
+          return;
+        }
+        // 目标名不能与现有文件冲突（包括本批次中稍后才删除的文件）
+        if (!isValidRenameTarget(name, to) || findImageIndex(working, workingCount, to) >= 0 ||
+            LittleFS.exists(makeImagePath(to).c_str())) {
+          sendJsonError(request, 400, "Invalid rename target", opIndex);
+          return;
+        }
+        working[idx].assign(to);
+      } else if (strcmp(type, "reorder") == 0) {
+        JsonArrayConst order = op["order"];
+        if (order.isNull()) {
+          sendJsonError(request, 400, "Missing order array", opIndex);
+          return;
+        }
+        int placed = 0;
+        for (JsonVariantConst entry : order) {
+          int idx = findImageIndex(working + placed, workingCount - placed, entry | "");
+          if (idx < 0) {
+            sendJsonError(request, 400, "Unknown or duplicate name in order", opIndex);
+            return;
+          }
+          idx += placed;
+          ImageName moved = working[idx];
+          uint8_t movedRefs = refs[idx];
+          for (int j = idx; j > placed; j--) {
+            working[j] = working[j - 1];
+            refs[j] = refs[j - 1];
+          }
+          working[placed] = moved;
+          refs[placed] = movedRefs;
+          placed++;
+        }
+        reordered = true;
+      } else {
+        sendJsonError(request, 400, "Unknown op", opIndex);
+        return;
+      }
+      opIndex++;
+    }
+
+    // 2. 执行：按顺序修改文件；文件系统出错时撤销已完成的重命名（已删除的文件无法恢复）
+    int applied = 0;
+    bool failed = false;
+    for (JsonObjectConst op : ops) {
+      const char *type = op["op"] | "";
+      const char *name = op["name"] | "";
+
+      if (strcmp(type, "delete") == 0) {
+        bool fileRemoved;
+        failed = !releaseImage(name, op["all"] | false, fileRemoved);
+      } else if (strcmp(type, "rename") == 0) {
+        const char *to = op["to"] | "";
+        failed = !LittleFS.rename(makeImagePath(name).c_str(), makeImagePath(to).c_str());
+        if (!failed) {
+          Dedup::contentIndex.renameFile(name, to);
+          Playlist::playlistManager.renameImage(name, to);
+          Catalog::imageMeta.renameImage(name, to);
+        }
+      }
+      if (failed) {
+        break;
+      }
+      applied++;
+    }
+
+    if (failed) {
+      for (int i = applied - 1; i >= 0; i--) {
+        JsonObjectConst op = ops[i];
+        if (strcmp(op["op"] | "", "rename") == 0) {
+          const char *name = op["name"] | "";
+          const char *to = op["to"] | "";
+          if (LittleFS.rename(makeImagePath(to).c_str(), makeImagePath(name).c_str())) {
+            Dedup::contentIndex.renameFile(to, name);
+            Playlist::playlistManager.renameImage(to, name);
+            Catalog::imageMeta.renameImage(to, name);
+          }
+        }
+      }
+      // 列表与文件系统可能已不一致，完整重新扫描一次
+      scanImages();
+      Serial.printf("Batch failed at op %d\n", applied);
+
+      JsonDocument doc;
+      doc["status"] = "error";
+      doc["op"] = applied;
+      doc["message"] = "File system error";
+      doc["image_count"] = imageCount;
+      sendJsonResponse(request, 500, doc);
+      return;
+    }
+
+    // 3. 一次性更新图片列表，尽量保持当前显示的图片不变
+    ImageName current(workingCurrentName());
+    int currentIndex = currentImageIndex;
+    for (int i = 0; i < workingCount; i++) {
+      imageList[i] = working[i];
+    }
+    imageCount = workingCount;
+
+    int idx = findImageIndex(imageList, imageCount, current.c_str());
+    if (idx >= 0) {
+      currentImageIndex = idx;
+    } else {
+      currentImageIndex = (currentIndex < imageCount) ? currentIndex : 0;
+    }
+
+    // 排过序或已有自定义顺序时保存完整顺序（重命名后的文件保持原位置）
+    if (reordered || LittleFS.exists(IMAGE_ORDER_PATH)) {
+      saveImageOrder(imageList, imageCount);
+    }
+    publishImageList();
+
+    Serial.printf("Batch applied: %d op(s), %d image(s)\n", applied, imageCount);
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["applied"] = applied;
+    doc["image_count"] = imageCount;
+    doc["current"] = currentImageIndex;
+    sendJsonResponse(request, 200, doc);
+  }
+
+  // ==================== 播放列表 ====================
+  // 请求体：{"action":"save","name":"beach","shuffle":true,"seed":42,
+  //          "items":["a.jpg",{"name":"b.jpg","dwell":10}]}
+  //        {"action":"activate","name":"beach"}（name为空则取消播放列表）
+  //        {"action":"delete","name":"beach"}
+
+  void WebServerController::sendPlaylistsResponse(AsyncWebServerRequest *request, int code)
+  {
+    AsyncWebServerResponse *apiResponse = request->beginResponse(code, "application/json",
+                                                                 Playlist::playlistManager.toJson());
+    apiResponse->addHeader("Access-Control-Allow-Origin", "*");
+    request->send(apiResponse);
+  }
+
+  void WebServerController::handlePlaylistAPI(AsyncWebServerRequest *request)
+  {
+    if (request->contentLength() > BATCH_MAX_BODY_SIZE) {
+      sendJsonError(request, 413, "Request body too large");
+      return;
+    }
+
+    const char *body = (const char *)request->_tempObject;
+    JsonDocument doc;
+    if (!body || deserializeJson(doc, body)) {
+      sendJsonError(request, 400, "Invalid JSON body");
+      return;
+    }
+
+    const char *action = doc["action"] | "";
+    const char *name = doc["name"] | "";
+
+    if (strcmp(action, "save") == 0) {
+      JsonArrayConst entries = doc["items"];
+      if (entries.isNull() || entries.size() > PLAYLIST_MAX_ITEMS) {
+        sendJsonError(request, 400, "items must be an array");
+        return;
+      }
+
+      // 只在Web任务中调用，用静态缓冲区避免占用任务栈
+      static Playlist::PlaylistItem items[PLAYLIST_MAX_ITEMS];
+      uint16_t count = 0;
+      for (JsonVariantConst entry : entries) {
+        const char *itemName = entry.is<const char *>() ? entry.as<const char *>() : (entry["name"] | "");
+        if (!itemName[0] || strlen(itemName) > ImageName::capacity()) {
+          sendJsonError(request, 400, "Invalid item name", count);
+          return;
+        }
+        items[count].name.assign(itemName);
+        items[count].dwellSeconds = min<uint32_t>(entry["dwell"] | 0, 3600);
+        count++;
+      }
+
+      uint32_t seed = doc["seed"] | esp_random();
+      if (!Playlist::playlistManager.save(name, items, count, doc["shuffle"] | false, seed)) {
+        sendJsonError(request, 400, "Invalid name or too many playlists");
+        return;
+      }
+      Catalog::WriterLock writer;
+      Playlist::playlistManager.resolve(imageList, imageCount);
+    } else if (strcmp(action, "activate") == 0) {
+      if (!Playlist::playlistManager.activate(name)) {
+        sendJsonError(request, 404, "Playlist not found");
+        return;
+      }
+      // 从播放列表的当前位置开始显示
+      int index = Playlist::playlistManager.current();
+      if (index >= 0) {
+        setCurrentImage(index);
+        slideSwitchPending = false;
+        armSlideDeadline(millis());
+      }
+    } else if (strcmp(action, "delete") == 0) {
+      if (!Playlist::playlistManager.remove(name)) {
+        sendJsonError(request, 404, "Playlist not found");
+        return;
+      }
+    } else {
+      sendJsonError(request, 400, "Unknown action");
+      return;
+    }
+
+    sendPlaylistsResponse(request, 200);
+  }
+
+  // ==================== 隔离台账 ====================
+
+  void WebServerController::sendQuarantineResponse(AsyncWebServerRequest *request)
+  {
+    // 只在Web任务中调用，用静态缓冲区避免占用任务栈
+    static Catalog::ImageMeta failures[MAX_IMAGES];
+    uint8_t count = Catalog::imageMeta.copyFailures(failures, MAX_IMAGES);
+
+    JsonDocument doc;
+    doc["status"] = "ok";
+    doc["threshold"] = CATALOG_QUARANTINE_FAILURES;
+    JsonArray list = doc["images"].to<JsonArray>();
+    for (uint8_t i = 0; i < count; i++) {
+      JsonObject entry = list.add<JsonObject>();
+      entry["name"] = failures[i].name.c_str();
+      entry["failures"] = failures[i].failures;
+      entry["error"] = ImageDisplay::renderErrorName((ImageDisplay::RenderError)failures[i].lastError);
+      entry["code"] = failures[i].lastDetail;
+      entry["quarantined"] = failures[i].quarantined;
+    }
+    sendJsonResponse(request, 200, doc);
+  }
+
+  void WebServerController::handleQuarantineAPI(AsyncWebServerRequest *request)
+  {
+    if (!request->hasParam("filename", true) || !request->hasParam("action", true)) {
+      sendJsonError(request, 400, "Missing filename or action parameter");
+      return;
+    }
+    String filename = request->getParam("filename", true)->value();
+    String action = request->getParam("action", true)->value();
+
+    if (action == "release") {
+      // 解除隔离，下次轮到时重新尝试渲染
+      if (!Catalog::imageMeta.clearFailures(filename.c_str())) {
+        sendJsonError(request, 404, "No failure record for this image");
+        return;
+      }
+    } else if (action == "delete") {
+      if (!Catalog::imageMeta.isQuarantined(filename.c_str())) {
+        sendJsonError(request, 409, "Image is not quarantined");
+        return;
+      }
+      // 损坏的文件连同别名一起删除，台账条目随列表更新清理
+      if (!deleteImage(filename, true)) {
+        sendJsonError(request, 500, "Failed to delete file");
+        return;
+      }
+    } else {
+      sendJsonError(request, 400, "Unknown action");
+      return;
+    }
+
+    sendQuarantineResponse(request);
+  }
 }
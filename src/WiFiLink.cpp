@@ -0,0 +1,264 @@
+#include "WiFiLink.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+
+namespace Net
+{
+  WiFiLinkManager wifiLink;
+
+  static const char *WIFI_PREFS_NAMESPACE = "wifilink";
+  static const char *WIFI_CACHE_KEY = "cache";
+  static const uint8_t WIFI_CACHE_VERSION = 2;
+
+  static uint32_t hashSsid(const char* ssid)
+  {
+    return esp_rom_crc32_le(0, (const uint8_t*)ssid, strlen(ssid));
+  }
+
+  const char* linkStateName(LinkState state)
+  {
+    switch (state) {
+      case LinkState::IDLE: return "idle";
+      case LinkState::FAST_CONNECTING: return "fast_connecting";
+      case LinkState::CONNECTING: return "connecting";
+      case LinkState::CONNECTED: return "connected";
+      case LinkState::BACKOFF: return "backoff";
+    }
+    return "unknown";
+  }
+
+  // ==================== 连接缓存 ====================
+
+  void WiFiLinkManager::loadCache()
+  {
+    cacheValid = false;
+    Preferences prefs;
+    if (!prefs.begin(WIFI_PREFS_NAMESPACE, true)) {
+      return;
+    }
+    size_t length = prefs.getBytes(WIFI_CACHE_KEY, &cache, sizeof(cache));
+    prefs.end();
+
+    cacheValid = length == sizeof(cache) && cache.version == WIFI_CACHE_VERSION &&
+                 cache.ssidHash == hashSsid(ssid) && cache.channel > 0;
+  }
+
+  void WiFiLinkManager::saveCache()
+  {
+    CachedLink current;
+    memset(&current, 0, sizeof(current));
+    current.version = WIFI_CACHE_VERSION;
+    current.channel = WiFi.channel();
+    const uint8_t* bssid = WiFi.BSSID();
+    if (bssid) {
+      memcpy(current.bssid, bssid, sizeof(current.bssid));
+    }
+    current.ssidHash = hashSsid(ssid);
+    if (usingCachedLease) {
+      // 地址是按缓存静态配置的，不是新租约：保留原租约，只累计复用次数
+      current.ip = cache.ip;
+      current.gateway = cache.gateway;
+      current.subnet = cache.subnet;
+      current.dns = cache.dns;
+      current.leaseReuses = cache.leaseReuses + 1;
+    } else {
+      current.ip = WiFi.localIP();
+      current.gateway = WiFi.gatewayIP();
+      current.subnet = WiFi.subnetMask();
+      current.dns = WiFi.dnsIP();
+      current.leaseReuses = 0;
+    }
+
+    // 同一个AP、同一个地址重连时不重复写NVS
+    if (cacheValid && memcmp(&current, &cache, sizeof(cache)) == 0) {
+      return;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_PREFS_NAMESPACE, false)) {
+      Serial.println("Failed to open NVS for WiFi cache");
+      return;
+    }
+    if (prefs.putBytes(WIFI_CACHE_KEY, &current, sizeof(current)) == sizeof(current)) {
+      cache = current;
+      cacheValid = true;
+    }
+    prefs.end();
+  }
+
+  // ==================== 状态机 ====================
+
+  bool WiFiLinkManager::begin(const char* ssidValue, const char* passwordValue)
+  {
+    ssid = ssidValue;
+    password = passwordValue;
+
+    // 凭据编译在固件中，不需要WiFi驱动每次连接都写NVS；重连由 service() 负责
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+
+    loadCache();
+    failedAttempts = 0;
+    disconnectedAt = 0;
+    startAttempt();
+    return true;
+  }
+
+  void WiFiLinkManager::enterState(LinkState newState)
+  {
+    state = newState;
+    stateSince = millis();
+  }
+
+  void WiFiLinkManager::startAttempt()
+  {
+    attemptStart = millis();
+    // 缓存只用于每轮的第一次尝试，失败后改为完整扫描
+    if (cacheValid && failedAttempts == 0) {
+      startFastConnect();
+    } else {
+      startFullConnect();
+    }
+  }
+
+  void WiFiLinkManager::startFastConnect()
+  {
+    Serial.printf("WiFi: fast connect to %02x:%02x:%02x:%02x:%02x:%02x on channel %u\n",
+                  cache.bssid[0], cache.bssid[1], cache.bssid[2],
+                  cache.bssid[3], cache.bssid[4], cache.bssid[5], cache.channel);
+    WiFi.disconnect();
+    usingCachedLease = WIFI_REUSE_IP_LEASE && cache.ip != 0 && cache.leaseReuses < WIFI_LEASE_MAX_REUSES;
+    if (usingCachedLease) {
+      WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    } else {
+      // 上一次直连可能配置了静态地址，恢复DHCP
+      WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+    WiFi.begin(ssid, password, cache.channel, cache.bssid);
+    enterState(LinkState::FAST_CONNECTING);
+  }
+
+  void WiFiLinkManager::startFullConnect()
+  {
+    Serial.printf("WiFi: connecting to %s\n", ssid);
+    WiFi.disconnect();
+    // 恢复DHCP
+    usingCachedLease = false;
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    WiFi.begin(ssid, password);
+    enterState(LinkState::CONNECTING);
+  }
+
+  void WiFiLinkManager::onConnected()
+  {
+    unsigned long now = millis();
+    stats.connects++;
+    stats.lastConnectMs = now - attemptStart;
+    if (state == LinkState::FAST_CONNECTING) {
+      stats.fastConnects++;
+    }
+    if (disconnectedAt) {
+      stats.reconnects++;
+      stats.lastReconnectMs = now - disconnectedAt;
+      disconnectedAt = 0;
+    }
+
+    Serial.printf("WiFi: connected (%s) in %lu ms, IP %s, RSSI %d\n",
+                  state == LinkState::FAST_CONNECTING ? "cached" : "scan",
+                  (unsigned long)stats.lastConnectMs, WiFi.localIP().toString().c_str(), WiFi.RSSI());
+
+    failedAttempts = 0;
+    backoffMs = 0;
+    enterState(LinkState::CONNECTED);
+    saveCache();
+  }
+
+  void WiFiLinkManager::onAttemptFailed()
+  {
+    stats.failures++;
+
+    // 直连失败（AP换了信道或更换了路由器）：立即完整扫描，不等待
+    if (state == LinkState::FAST_CONNECTING) {
+      Serial.println("WiFi: fast connect timed out, falling back to scan");
+      failedAttempts++;
+      startFullConnect();
+      return;
+    }
+
+    failedAttempts++;
+    backoffMs = backoffMs ? min<unsigned long>(backoffMs * 2, WIFI_BACKOFF_MAX_MS) : WIFI_BACKOFF_MIN_MS;
+    Serial.printf("WiFi: connect failed, retrying in %lu ms\n", backoffMs);
+    WiFi.disconnect();
+    enterState(LinkState::BACKOFF);
+  }
+
+  void WiFiLinkManager::service()
+  {
+    unsigned long now = millis();
+    bool linkUp = WiFi.status() == WL_CONNECTED;
+
+    switch (state) {
+      case LinkState::IDLE:
+        break;
+
+      case LinkState::FAST_CONNECTING:
+        if (linkUp) {
+          onConnected();
+        } else if (now - stateSince >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+          onAttemptFailed();
+        }
+        break;
+
+      case LinkState::CONNECTING:
+        if (linkUp) {
+          onConnected();
+        } else if (now - stateSince >= WIFI_CONNECT_TIMEOUT_MS) {
+          onAttemptFailed();
+        }
+        break;
+
+      case LinkState::CONNECTED:
+        if (!linkUp) {
+          stats.disconnects++;
+          disconnectedAt = now;
+          Serial.println("WiFi: link lost, reconnecting");
+          // 大多是AP短暂掉线，先按缓存直连
+          failedAttempts = 0;
+          startAttempt();
+        } else if (usingCachedLease && now - stateSince >= WIFI_LEASE_RENEW_MS) {
+          // 静态配置的地址不会向路由器续租：启动完成后重连一次，改用DHCP
+          Serial.println("WiFi: renewing cached address via DHCP");
+          cache.leaseReuses = WIFI_LEASE_MAX_REUSES;
+          attemptStart = now;
+          startFastConnect();
+        }
+        break;
+
+      case LinkState::BACKOFF:
+        if (now - stateSince >= backoffMs) {
+          startAttempt();
+        }
+        break;
+    }
+  }
+
+  void WiFiLinkManager::addToJson(JsonObject obj) const
+  {
+    obj["state"] = linkStateName(state);
+    obj["cached"] = cacheValid;
+    obj["connects"] = stats.connects;
+    obj["reconnects"] = stats.reconnects;
+    obj["disconnects"] = stats.disconnects;
+    obj["failures"] = stats.failures;
+    obj["fast_connects"] = stats.fastConnects;
+    obj["last_connect_ms"] = stats.lastConnectMs;
+    obj["last_reconnect_ms"] = stats.lastReconnectMs;
+    if (state == LinkState::CONNECTED) {
+      obj["rssi"] = WiFi.RSSI();
+      obj["channel"] = WiFi.channel();
+    } else if (state == LinkState::BACKOFF) {
+      obj["retry_in_ms"] = backoffMs - min<unsigned long>(backoffMs, millis() - stateSince);
+    }
+  }
+}
@@ -4,51 +4,109 @@
 #include <ESPmDNS.h>
 #include "secrets.h"
 #include "DisplayDriver.h"
+#include "DisplayPipeline.h"
 #include "WebServer.h"
 #include "ImageDisplay.h"
+#include "PipelineBenchmark.h"
+#include "ImageIngest.h"
+#include "Settings.h"
+#include "BootTiming.h"
+#include "WiFiLink.h"
+#include "ImageCatalog.h"
 
 // ==================== 全局变量 ====================
 unsigned long lastImageUpdate = 0;
-String lastDisplayedImage = "";
+ImageName lastDisplayedImage;
 int lastImageIndex = -1;
+uint32_t lastRenderGeneration = 0;
+bool wifiWasConnected = false;
+bool mdnsStarted = false;
 
 // ==================== 函数声明 ====================
 void updateDisplayedImage();
 bool hasImageChanged();
+void onWiFiConnected();
 
 // ==================== 主程序函数 ====================
 
 void setup()
 {
-  // 初始化串口
+  // 初始化串口：不等待USB串口连接，否则没有接电脑时会一直卡在这里
   Serial.begin(SERIAL_BAUD_RATE);
-  while (!Serial) {
-    delay(10);
-  }
 
   Serial.println("Starting Little Gallery ESP32...");
 
-  // 初始化显示屏 (从platformio.ini配置中读取)
-#ifndef DEFAULT_DISPLAY_DRIVER
-#define DEFAULT_DISPLAY_DRIVER DRIVER_ILI9341 // 默认备选
+  // 读取保存的运行时设置（NVS中的一条记录），后续各模块按它恢复状态
+  Settings::settingsStore.begin();
+  Boot::mark("settings");
+
+  // 初始化显示屏：优先使用上次通过 /api/driver 切换的驱动，否则从platformio.ini配置中读取
+  // （DEFAULT_DISPLAY_DRIVER 见 DisplayPipeline.h，只有这个驱动走编译期专用像素写入路径）
+  uint8_t savedDriver = Settings::settingsStore.get().displayDriver;
+  Display::setup(savedDriver <= DRIVER_ST7789 ? (DisplayDriverType)savedDriver : DEFAULT_DISPLAY_DRIVER);
+
+#ifdef RUN_FILL_BENCHMARK
+  // 纯色填充基准测试：对比CPU路径与DMA路径的全屏填充耗时
+  Display::FillBenchmarkResult fillResult;
+  if (Display::displayManager.benchmarkFill(20, fillResult)) {
+    float pixels = (float)fillResult.pixels * fillResult.iterations;
+    Serial.printf("CPU fill: %.2f MPixel/s\n", pixels / fillResult.cpuMicros);
+    if (fillResult.dmaMicros > 0) {
+      Serial.printf("DMA fill: %.2f MPixel/s\n", pixels / fillResult.dmaMicros);
+    }
+  }
 #endif
-  Display::setup(DEFAULT_DISPLAY_DRIVER);
 
   // 初始化图片显示
   ImageDisplay::setup();
+  Boot::mark("display");
+
+#ifdef RUN_PIPELINE_BENCHMARK
+  // 颜色转换基准测试：逐像素参考实现 vs 按字转换，结果以JSON行输出到串口
+  Benchmark::runColorBenchmark();
 
-  // 显示WiFi连接状态
-  Display::displayManager.showWiFiConnecting();
+  // 解码流水线基准测试：LittleFS中的语料图片按四种显示模式逐一解码，结果以JSON行输出到串口
+  if (LittleFS.begin(true)) {
+    Benchmark::runPipelineBenchmark();
+  } else {
+    Serial.println("Pipeline benchmark skipped: LittleFS mount failed");
+  }
+#endif
 
-  // 初始化Web服务器
+  // 挂载文件系统、扫描图片并恢复上次的当前图片和幻灯片状态（不依赖网络）
   if (!WebServerManager::setup()) {
-    Display::displayManager.showErrorMessage("Failed to start web server");
+    Display::displayManager.showErrorMessage("Failed to mount file system");
     return;
   }
+  Boot::mark("storage");
+
+  // 先显示上次的图片，再连接网络
+  updateDisplayedImage();
+  Boot::mark("first_image");
+
+  // 发起WiFi连接并启动Web服务器，连接在后台完成，结果在loop中处理
+  if (!WebServerManager::startNetwork()) {
+    Serial.println("Failed to start web server");
+  }
+  Boot::mark("network");
+
+  // 启动后台转码任务（会先处理一遍已有的大图）
+  Ingest::begin();
+
+  Serial.println("Setup complete. Ready to display images!");
+}
+
+// ==================== 网络就绪处理 ====================
+
+void onWiFiConnected()
+{
+  Serial.printf("WiFi connected! IP address: %s\n", WebServerManager::getIPAddress().c_str());
+  Serial.printf("Server running on: http://%s\n", WebServerManager::getIPAddress().c_str());
+
+  // mDNS只需启动一次，断线重连后继续有效
+  if (!mdnsStarted) {
+    Boot::mark("wifi");
 
-  // 显示连接成功信息
-  if (WebServerManager::isWiFiConnected()) {
-    // 初始化mDNS
     if (MDNS.begin(MDNS_HOSTNAME))
     {
       Serial.println("mDNS responder started");
@@ -64,33 +122,54 @@ void setup()
     {
       Serial.println("Error setting up mDNS responder!");
     }
+    mdnsStarted = true;
+    Boot::mark("mdns");
+    Boot::printSummary();
+  }
 
+  // 还没有图片时显示IP地址，方便上传第一张图片；有图片时不打断显示
+  if (WebServerManager::getImageCount() == 0) {
     Display::displayManager.showWiFiConnected(WebServerManager::getIPAddress());
-    delay(3000); // 显示连接信息3秒
   }
-
-  // 显示第一张图片或无图片消息
-  updateDisplayedImage();
-
-  Serial.println("Setup complete. Ready to display images!");
 }
 
 // ==================== 辅助函数 ====================
 
 void updateDisplayedImage()
 {
-  String currentImage = WebServerManager::getCurrentImageName();
-  int currentIndex = WebServerManager::getCurrentImageIndex();
-  int totalImages = WebServerManager::getImageCount();
+  lastRenderGeneration = ImageDisplay::getRequestedGeneration();
+
+  // 从同一个列表快照复制到定长缓冲区：不加锁，也不会读到扫描到一半的列表
+  ImageName currentImage;
+  int currentIndex;
+  int totalImages;
+  {
+    Catalog::SnapshotRef snapshot;
+    currentImage.assign(snapshot->currentName());
+    currentIndex = snapshot->current;
+    totalImages = snapshot->count;
+  }
 
-  if (currentImage != "No image" && !currentImage.isEmpty()) {
-    if (ImageDisplay::displayImage(currentImage.c_str())) {
+  if (!currentImage.isEmpty()) {
+    unsigned long renderStart = millis();
+    bool displayed = ImageDisplay::displayImage(currentImage.c_str());
+    if (displayed) {
       // ImageDisplay::showImageInfo(currentImage.c_str(), currentIndex, totalImages);
+      WebServerManager::webServerController.onFrameRendered(currentImage.c_str(), true, renderStart, millis());
+    } else if (ImageDisplay::isRenderCancelled()) {
+      // 绘制到一半被新请求中止：下一轮循环立即渲染最新的图片
+      // （即使切回了同一张，屏幕上也只有一部分，必须重画）
+      lastDisplayedImage.clear();
+      lastImageIndex = -1;
+      return;
     } else {
-      ImageDisplay::showErrorMessage("Failed to display: " + currentImage);
+      ImageDisplay::showErrorMessage("Failed to display: " + String(currentImage.c_str()));
+      WebServerManager::webServerController.onFrameRendered(currentImage.c_str(), false, renderStart, millis());
     }
   } else {
     ImageDisplay::showNoImageMessage();
+    // 列表已清空：等待中的幻灯片切换不会再有渲染
+    WebServerManager::webServerController.onSwitchSettled(millis());
   }
 
   lastDisplayedImage = currentImage;
@@ -99,32 +178,54 @@ void updateDisplayedImage()
 
 bool hasImageChanged()
 {
-  String currentImage = WebServerManager::getCurrentImageName();
-  int currentIndex = WebServerManager::getCurrentImageIndex();
-
-  return (currentImage != lastDisplayedImage || currentIndex != lastImageIndex);
+  // 每秒调用一次，在快照上直接比较，不复制文件名
+  Catalog::SnapshotRef snapshot;
+  return (lastDisplayedImage != snapshot->currentName() || snapshot->current != lastImageIndex);
 }
 
 void loop()
 {
   unsigned long now = millis();
 
+  // 执行 /api/bench 排队的基准测试任务，结束后恢复当前图片
+  if (Benchmark::serviceBenchJob()) {
+    updateDisplayedImage();
+  }
+
   // 更新幻灯片（如果启用）
   WebServerManager::webServerController.updateSlideshow();
 
-  // 定期检查是否需要更新显示的图片
-  if (now - lastImageUpdate >= IMAGE_UPDATE_INTERVAL) {
+  // 按防抖规则把变化的设置写入NVS
+  Settings::settingsStore.service();
+
+  // 推进WiFi连接状态机：连上（或重连）时处理一次
+  Net::wifiLink.service();
+  bool wifiConnected = WebServerManager::isWiFiConnected();
+  if (wifiConnected && !wifiWasConnected) {
+    onWiFiConnected();
+  } else if (!wifiConnected && wifiWasConnected) {
+    Serial.println("WiFi disconnected, reconnecting in background");
+  }
+  wifiWasConnected = wifiConnected;
+
+  // 定期检查是否需要更新显示的图片；有新的切换请求时立即检查
+  bool renderRequested = ImageDisplay::getRequestedGeneration() != lastRenderGeneration;
+  if (renderRequested || now - lastImageUpdate >= IMAGE_UPDATE_INTERVAL) {
     if (hasImageChanged()) {
       Serial.printf("Image changed: %s (index: %d)\n",
-                   WebServerManager::getCurrentImageName().c_str(),
+                   WebServerManager::getCurrentImage().c_str(),
                    WebServerManager::getCurrentImageIndex());
 
       updateDisplayedImage();
+    } else {
+      // 切走又切回当前图片：无需重画，等待中的幻灯片切换也就此结束
+      lastRenderGeneration = ImageDisplay::getRequestedGeneration();
+      WebServerManager::webServerController.onSwitchSettled(now);
     }
 
     lastImageUpdate = now;
   }
 
-  // 让其他任务有机会运行
-  delay(10);
+  // 让其他任务有机会运行；幻灯片快到换图时间时缩短等待，按时开始解码
+  delay(min<unsigned long>(10, WebServerManager::webServerController.getMillisUntilSlideSwitch()));
 }